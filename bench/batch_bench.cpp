@@ -0,0 +1,128 @@
+// Batch costs of the partitioner's first-fit-decreasing batching vs the previous greedy loop.
+//
+// Usage: dcc_batch_bench [num_clusters=200000] [min_batch_cost=50] [workers=64] [overhead=5] [max_nodes=5000]
+//
+// Draws a heavy-tailed clustering (most clusters tiny, a few of up to max_nodes nodes),
+// estimates each cluster's cost like the load balancer (nodes + 1 / density) and batches it
+// both ways. The greedy loop walks clusters in input order and closes a batch once it
+// reaches min_batch_cost. Reported per batcher: number of batches, batches under the target,
+// mean and standard deviation of the batch cost (over all batches, and over batches of
+// clusters under the target), and a simulated total runtime: batches go largest first to the
+// worker that frees up first, each costing its estimate plus a fixed per-batch overhead.
+#include <batch_packer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Batches = std::vector<std::vector<int32_t>>;
+
+Batches greedy_batches(const std::vector<float>& costs, double target) {
+    Batches batches;
+    double accumulated = 0;
+    for (int32_t item = 0; item < static_cast<int32_t>(costs.size()); ++item) {
+        if (accumulated == 0) batches.emplace_back();
+        batches.back().push_back(item);
+        accumulated += costs[item];
+        if (accumulated >= target) accumulated = 0;
+    }
+    return batches;
+}
+
+void report(const char* name, const Batches& batches, const std::vector<float>& costs, double target, int workers,
+            double overhead, double seconds) {
+    std::vector<double> batch_costs;
+    for (const auto& batch : batches) {
+        double cost = 0;
+        for (int32_t item : batch) cost += costs[item];
+        batch_costs.push_back(cost);
+    }
+    double sum = 0, square_sum = 0;
+    size_t under = 0;
+    for (double cost : batch_costs) {
+        sum += cost;
+        square_sum += cost * cost;
+        if (cost < target) ++under;
+    }
+    double mean = sum / batch_costs.size();
+    double stddev = std::sqrt(std::max(0.0, square_sum / batch_costs.size() - mean * mean));
+
+    // Only batches of clusters under the target are comparable; standalone clusters are the same
+    double small_sum = 0, small_square_sum = 0;
+    size_t small = 0;
+    for (size_t b = 0; b < batches.size(); ++b) {
+        if (batches[b].size() == 1 && costs[batches[b][0]] >= target) continue;
+        small_sum += batch_costs[b];
+        small_square_sum += batch_costs[b] * batch_costs[b];
+        ++small;
+    }
+    double small_mean = small ? small_sum / small : 0;
+    double small_stddev = small ? std::sqrt(std::max(0.0, small_square_sum / small - small_mean * small_mean)) : 0;
+
+    std::sort(batch_costs.begin(), batch_costs.end(), std::greater<double>());
+    std::priority_queue<double, std::vector<double>, std::greater<double>> free_at;
+    for (int w = 0; w < workers; ++w) free_at.push(0);
+    double makespan = 0;
+    for (double cost : batch_costs) {
+        double start = free_at.top();
+        free_at.pop();
+        free_at.push(start + cost + overhead);
+        makespan = std::max(makespan, start + cost + overhead);
+    }
+
+    std::printf("%-7s %8zu batches  %7zu under target  cost mean %9.1f stddev %9.1f  "
+                "packed batches mean %7.1f stddev %7.1f  runtime %10.0f  (%.3fs)\n",
+                name, batches.size(), under, mean, stddev, small_mean, small_stddev, makespan, seconds);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t num_clusters = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    double target = argc > 2 ? std::atof(argv[2]) : 50;
+    int workers = argc > 3 ? std::max(1, std::atoi(argv[3])) : 64;
+    double overhead = argc > 4 ? std::atof(argv[4]) : 5;
+    int max_nodes = argc > 5 ? std::max(2, std::atoi(argv[5])) : 5000;
+
+    // Pareto cluster sizes from 2 nodes, densities between a tree and a clique
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<float> costs(num_clusters);
+    for (float& cost : costs) {
+        int nodes = std::min(max_nodes, static_cast<int>(2 / std::pow(1 - uniform(rng), 1 / 1.3)));
+        double min_edges = nodes - 1, max_edges = 0.5 * nodes * (nodes - 1.0);
+        double edges = min_edges + uniform(rng) * std::min(max_edges - min_edges, 20.0 * nodes);
+        double density = 2.0 * edges / (static_cast<double>(nodes) * (nodes - 1));
+        cost = static_cast<float>(nodes + 1.0 / density);
+    }
+    std::printf("clusters: %zu, target %.1f, %d workers, per-batch overhead %.1f\n", num_clusters, target, workers,
+                overhead);
+
+    auto start = std::chrono::steady_clock::now();
+    Batches greedy = greedy_batches(costs, target);
+    double greedy_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    Batches ffd = pack_batches(costs, target);
+    double ffd_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report("greedy", greedy, costs, target, workers, overhead, greedy_seconds);
+    report("ffd", ffd, costs, target, workers, overhead, ffd_seconds);
+
+    // Every cluster in exactly one batch
+    std::vector<int> seen(num_clusters, 0);
+    for (const auto& batch : ffd) {
+        for (int32_t item : batch) ++seen[item];
+    }
+    if (std::any_of(seen.begin(), seen.end(), [](int count) { return count != 1; })) {
+        std::printf("MISMATCH\n");
+        return 1;
+    }
+    return 0;
+}
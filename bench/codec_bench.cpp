@@ -0,0 +1,122 @@
+// Size, write time and read time of a batch edge list as .bedgelist vs .cedgelist.
+//
+// Usage: dcc_codec_bench [num_edges=20000000] [cluster_size=200] [dir=/tmp]
+//
+// Generates clusters of cluster_size consecutive node ids with random intra-cluster edges
+// (as written by the partitioner) and reports the file sizes, the time to write each file
+// and the read throughput in decoded edges per second. The page cache is not dropped, so
+// read times measure parsing/decoding rather than the disk.
+#include <edge_codec.hpp>
+#include <mapped_file.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+namespace fs = std::filesystem;
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int64_t edge_checksum(const std::pair<int, int>* edges, size_t count) {
+    int64_t checksum = 0;
+    for (size_t i = 0; i < count; ++i) checksum += static_cast<int64_t>(edges[i].first) * 31 + edges[i].second;
+    return checksum;
+}
+
+// Same layout as write_binary_edgelist (utils.hpp), which pulls in MPI
+void write_raw_edgelist(const std::string& path, const std::vector<std::pair<int, int>>& edges) {
+    std::ofstream out(path, std::ios::binary);
+    uint64_t num_edges = edges.size();
+    out.write(reinterpret_cast<const char*>(&num_edges), sizeof(num_edges));
+    out.write(reinterpret_cast<const char*>(edges.data()), num_edges * sizeof(std::pair<int, int>));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t num_edges = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    int cluster_size = argc > 2 ? std::max(2, std::atoi(argv[2])) : 200;
+    std::string dir = argc > 3 ? argv[3] : "/tmp";
+
+    // Clusters of consecutive ids, edges in random order within each cluster
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(num_edges);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> member(0, cluster_size - 1);
+    size_t edges_per_cluster = static_cast<size_t>(cluster_size) * 4;
+    for (int base = 1000000; edges.size() < num_edges; base += cluster_size) {
+        for (size_t e = 0; e < edges_per_cluster && edges.size() < num_edges; ++e) {
+            int source = base + member(rng);
+            int target = base + member(rng);
+            if (source != target) edges.emplace_back(std::min(source, target), std::max(source, target));
+        }
+    }
+    int64_t reference = 0;
+    {
+        std::vector<std::pair<int, int>> sorted = edges;
+        std::sort(sorted.begin(), sorted.end());
+        reference = edge_checksum(sorted.data(), sorted.size());
+    }
+
+    std::string raw_path = dir + "/dcc_codec_bench.bedgelist";
+    std::string compressed_path = dir + "/dcc_codec_bench.cedgelist";
+    std::printf("edges: %zu, cluster size %d\n", edges.size(), cluster_size);
+
+    auto start = std::chrono::steady_clock::now();
+    write_raw_edgelist(raw_path, edges);
+    double raw_write = seconds_since(start);
+
+    std::vector<std::pair<int, int>> to_compress = edges;
+    start = std::chrono::steady_clock::now();
+    write_compressed_edgelist(compressed_path, to_compress);   // includes the sort
+    double compressed_write = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    int64_t raw_checksum = 0;
+    {
+        MappedFile mapped(raw_path, "edgelist");
+        uint64_t count;
+        std::memcpy(&count, mapped.data(), sizeof(count));
+        std::vector<std::pair<int, int>> read(count);
+        const char* edges = mapped.data() + sizeof(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            int32_t edge[2];
+            std::memcpy(edge, edges + i * sizeof(edge), sizeof(edge));
+            read[i] = {edge[0], edge[1]};
+        }
+        raw_checksum = edge_checksum(read.data(), read.size());
+    }
+    double raw_read = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::pair<int, int>> decoded = read_compressed_edgelist(compressed_path);
+    int64_t compressed_checksum = edge_checksum(decoded.data(), decoded.size());
+    double compressed_read = seconds_since(start);
+
+    uintmax_t raw_size = fs::file_size(raw_path);
+    uintmax_t compressed_size = fs::file_size(compressed_path);
+    std::printf("%-10s %12ju bytes  %6.2f bytes/edge  write %7.3fs  read %7.1f Medges/s\n", ".bedgelist", raw_size,
+                static_cast<double>(raw_size) / edges.size(), raw_write, edges.size() / raw_read / 1e6);
+    std::printf("%-10s %12ju bytes  %6.2f bytes/edge  write %7.3fs  read %7.1f Medges/s\n", ".cedgelist",
+                compressed_size, static_cast<double>(compressed_size) / edges.size(), compressed_write,
+                edges.size() / compressed_read / 1e6);
+    std::printf("ratio      %.2fx smaller\n", static_cast<double>(raw_size) / compressed_size);
+
+    fs::remove(raw_path);
+    fs::remove(compressed_path);
+    bool match = compressed_checksum == reference && decoded.size() == edges.size();
+    if (!match || raw_checksum != edge_checksum(edges.data(), edges.size())) {
+        std::printf("MISMATCH\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Load balancer message throughput: messages per second the LoadBalancer run loop handles
+// for N mock workers, and the CPU time its thread spends doing so.
+//
+// Usage: mpirun -np <workers + 1> dcc_lb_bench [num_clusters=200000] [work_us=0] [min_batch_cost=1] [dir=/tmp]
+//
+// Rank 0 partitions a synthetic clustering of num_clusters triangles and runs the load
+// balancer; every other rank is a mock worker that declares its node, then requests batches
+// and reports each cluster done after sleeping work_us (0: at once), until it is told there
+// is no more work. With work_us = 0 the load balancer is the bottleneck, so the rate is its
+// throughput; with work_us > 0 the loop is mostly waiting, and its CPU share shows whether it
+// idles or spins.
+#include <load_balancer.hpp>
+#include <constants.hpp>
+#include <mpi.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+namespace fs = std::filesystem;
+
+namespace {
+
+double thread_cpu_seconds() {
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void write_input(const std::string& edgelist, const std::string& clustering, int64_t num_clusters) {
+    std::ofstream edges(edgelist);
+    std::ofstream clusters(clustering);
+    edges << "source,target\n";
+    clusters << "node_id,cluster_id\n";
+    for (int64_t c = 0; c < num_clusters; ++c) {
+        int64_t u = 3 * c;
+        edges << u << "," << u + 1 << "\n" << u + 1 << "," << u + 2 << "\n" << u << "," << u + 2 << "\n";
+        for (int64_t v = u; v < u + 3; ++v) clusters << v << "," << c << "\n";
+    }
+}
+
+// Mock worker: returns the number of messages it sent to the load balancer
+int64_t run_worker(int work_us) {
+    int64_t sent = 0;
+    WorkerInfo info{};
+    std::snprintf(info.node_name, sizeof(info.node_name), "bench");
+    info.memory_budget_mb = int64_t(1) << 20;
+    MPI_Send(&info, sizeof(info), MPI_BYTE, 0, to_int(MessageType::WORKER_INFO), MPI_COMM_WORLD);
+    ++sent;
+
+    int64_t used_yield_ids = 0;     // mock clusters never yield
+    std::vector<int64_t> message;
+    while (true) {
+        MPI_Send(&used_yield_ids, 1, MPI_INT64_T, 0, to_int(MessageType::WORK_REQUEST), MPI_COMM_WORLD);
+        ++sent;
+
+        MPI_Status status;
+        MPI_Probe(0, to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD, &status);
+        int count;
+        MPI_Get_count(&status, MPI_INT64_T, &count);
+        message.resize(count);
+        MPI_Recv(message.data(), count, MPI_INT64_T, 0, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (count == 1 && message[0] == NO_MORE_JOBS) break;
+
+        for (int i = 2; i + 1 < count; i += 2) {     // after the yield ID block header
+            if (work_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(work_us));
+            WorkDone done{};
+            done.cluster_id = message[i];
+            done.wall_seconds = work_us / 1e6;
+            MPI_Send(&done, sizeof(done), MPI_BYTE, 0, to_int(MessageType::WORK_DONE), MPI_COMM_WORLD);
+            ++sent;
+        }
+    }
+
+    int aggregate_msg = to_int(MessageType::AGGREGATE_DONE);
+    MPI_Send(&aggregate_msg, 1, MPI_INT, 0, to_int(MessageType::AGGREGATE_DONE), MPI_COMM_WORLD);
+    return sent + 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size < 2) {
+        if (rank == 0) std::fprintf(stderr, "Run with at least 2 ranks (1 load balancer + mock workers)\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    int64_t num_clusters = argc > 1 ? std::strtoll(argv[1], nullptr, 10) : 200000;
+    int work_us = argc > 2 ? std::max(0, std::atoi(argv[2])) : 0;
+    float min_batch_cost = argc > 3 ? std::strtof(argv[3], nullptr) : 1.0f;
+    std::string dir = (argc > 4 ? std::string(argv[4]) : std::string("/tmp")) + "/dcc_lb_bench";
+
+    std::unique_ptr<LoadBalancer> load_balancer;
+    if (rank == 0) {
+        fs::remove_all(dir);
+        fs::create_directories(dir + "/logs");
+        write_input(dir + "/edges.csv", dir + "/clusters.csv", num_clusters);
+        load_balancer = std::make_unique<LoadBalancer>("CM", dir + "/edges.csv", dir + "/clusters.csv", dir,
+                                                       dir + "/out.csv", -1, false, "", false, min_batch_cost);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = std::chrono::steady_clock::now();
+    double cpu = 0;
+    int64_t sent = 0;
+    if (rank == 0) {
+        double cpu_start = thread_cpu_seconds();
+        load_balancer->run();
+        cpu = thread_cpu_seconds() - cpu_start;
+    } else {
+        sent = run_worker(work_us);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int64_t total_sent = 0;
+    MPI_Reduce(&sent, &total_sent, 1, MPI_INT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::printf("%d mock workers, %lld clusters, work %d us per cluster\n", size - 1,
+                    static_cast<long long>(num_clusters), work_us);
+        std::printf("%lld messages in %.3fs: %.0f messages/s, load balancer thread CPU %.3fs (%.0f%%)\n",
+                    static_cast<long long>(total_sent), seconds, total_sent / seconds, cpu, 100 * cpu / seconds);
+        load_balancer.reset();
+        fs::remove_all(dir);
+    }
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Parse throughput of the text pair parser for each kernel supported by this CPU.
+//
+// Usage: dcc_parse_bench [size_mb=256] [repetitions=5] [delimiter=,]
+//
+// Generates an in-memory edge list of random node ids and reports the best GB/s of each
+// kernel. The scalar kernel is the original byte-at-a-time loop.
+#include <parser.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    size_t size_mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    char delimiter = argc > 3 ? (argv[3][0] == 't' ? '\t' : argv[3][0]) : ',';
+
+    // Node ids with a spread of digit counts, as in real edge lists
+    std::string text = std::string("source") + delimiter + "target\n";
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> digits(1, 9);
+    while (text.size() < size_mb * 1024 * 1024) {
+        for (int field = 0; field < 2; ++field) {
+            int width = digits(rng);
+            int max_value = 1;
+            for (int i = 0; i < width; ++i) max_value *= 10;
+            text += std::to_string(std::uniform_int_distribution<int>(0, max_value - 1)(rng));
+            text += field == 0 ? delimiter : '\n';
+        }
+    }
+    const char* data = text.data();
+    const char* end = data + text.size();
+    while (*data != '\n') ++data;
+    ++data;
+
+    std::printf("input: %.1f MB, delimiter '%s'\n", text.size() / (1024.0 * 1024.0),
+                delimiter == '\t' ? "\\t" : std::string(1, delimiter).c_str());
+
+    int64_t reference = 0;
+    for (ParseKernel kernel : {ParseKernel::Scalar, ParseKernel::SSE42, ParseKernel::AVX2}) {
+        if (!parse_kernel_supported(kernel)) {
+            std::printf("%-8s unsupported\n", parse_kernel_name(kernel));
+            continue;
+        }
+
+        double best = 0;
+        int64_t checksum = 0;
+        size_t lines = 0;
+        for (int r = 0; r < repetitions; ++r) {
+            checksum = 0;
+            lines = 0;
+            auto start = std::chrono::steady_clock::now();
+            parse_pairs(data, end, delimiter, [&](int source, int target) {
+                checksum += static_cast<int64_t>(source) * 31 + target;
+                ++lines;
+            }, kernel);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::max(best, (end - data) / seconds / 1e9);
+        }
+
+        if (kernel == ParseKernel::Scalar) reference = checksum;
+        std::printf("%-8s %8.3f GB/s  %zu lines  checksum %lld%s\n", parse_kernel_name(kernel), best, lines,
+                    static_cast<long long>(checksum), checksum == reference ? "" : "  MISMATCH");
+        if (checksum != reference) return 1;
+    }
+    return 0;
+}
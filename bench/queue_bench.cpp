@@ -0,0 +1,195 @@
+// Load balancer job queue: the indexed 4-ary heap (JobQueue) vs the previous
+// std::priority_queue whose comparator recomputed both costs, with lazily deleted entries.
+//
+// Usage: dcc_queue_bench [num_entries=10000000] [erase_percent=20]
+//
+// Queues num_entries clusters of heavy-tailed size, then runs num_entries operations mixing
+// pops with pushes of small yielded sub-clusters and erases of queued sub-clusters (as when a
+// parent aborts), and finally drains the queue. Every phase is timed for both queues. Both
+// break cost ties by cluster ID, so they pop the same clusters and their checksums match.
+#include <job_queue.hpp>
+#include <cost_model.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const CostModel model;      // unfitted: the node_count + 1/density heuristic
+
+float cost_of(const ClusterInfo& cluster) {
+    return model.cost(cluster.node_count, cluster.edge_count);
+}
+
+// The previous job queue: costs recomputed on every comparison, erased entries skipped on pop
+class LazyQueue {
+private:
+    struct CostCompare {
+        bool operator()(const ClusterInfo& a, const ClusterInfo& b) const {
+            float cost_a = cost_of(a), cost_b = cost_of(b);
+            return cost_a < cost_b || (cost_a == cost_b && a.cluster_id > b.cluster_id);
+        }
+    };
+    std::priority_queue<ClusterInfo, std::vector<ClusterInfo>, CostCompare> heap;
+    std::unordered_set<int64_t> dropped;
+    size_t active = 0;
+
+public:
+    bool empty() const { return active == 0; }
+    void push(const ClusterInfo& cluster) {
+        heap.push(cluster);
+        ++active;
+    }
+    void erase(int64_t cluster_id) {
+        dropped.insert(cluster_id);
+        --active;
+    }
+    ClusterInfo pop() {
+        while (true) {
+            ClusterInfo cluster = heap.top();
+            heap.pop();
+            if (dropped.erase(cluster.cluster_id)) continue;
+            --active;
+            return cluster;
+        }
+    }
+};
+
+enum class OpType { Pop, Push, Erase };
+
+struct Op {
+    OpType type;
+    ClusterInfo cluster;    // pushed cluster, or the erase target's ID
+};
+
+ClusterInfo random_cluster(int cluster_id, std::mt19937_64& rng, double max_nodes) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    // Pareto-like sizes: most clusters tiny, a few large
+    int nodes = std::max(2, static_cast<int>(std::min(max_nodes, 2.0 / std::pow(1.0 - unit(rng), 1.2))));
+    double max_edges = 0.5 * nodes * (nodes - 1.0);
+    int64_t edges = std::max<int64_t>(nodes - 1, static_cast<int64_t>(max_edges * unit(rng) * unit(rng)));
+    return {cluster_id, nodes, edges};
+}
+
+struct Result {
+    double build = 0, mixed = 0, drain = 0;
+    double checksum = 0;    // sum of popped costs
+    size_t popped = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t num_entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    int erase_percent = argc > 2 ? std::clamp(std::atoi(argv[2]), 0, 100) : 20;
+
+    std::mt19937_64 rng(42);
+    std::vector<ClusterInfo> initial;
+    initial.reserve(num_entries);
+    for (size_t i = 0; i < num_entries; ++i) initial.push_back(random_cluster(static_cast<int>(i), rng, 50000));
+
+    // Mixed phase: pops, pushes of yielded sub-clusters, erases of earlier sub-clusters
+    std::vector<Op> ops;
+    ops.reserve(num_entries);
+    std::vector<int> children;
+    int next_id = static_cast<int>(num_entries);
+    std::uniform_int_distribution<int> percent(0, 99);
+    int push_percent = (100 - erase_percent) / 2;
+    for (size_t i = 0; i < num_entries; ++i) {
+        int draw = percent(rng);
+        if (draw < erase_percent && !children.empty()) {
+            int target = children[std::uniform_int_distribution<size_t>(0, children.size() - 1)(rng)];
+            ops.push_back({OpType::Erase, {target, 0, 0}});
+        } else if (draw < erase_percent + push_percent) {
+            ops.push_back({OpType::Push, random_cluster(next_id, rng, 500)});
+            children.push_back(next_id++);
+        } else {
+            ops.push_back({OpType::Pop, {}});
+        }
+    }
+    std::printf("%zu initial clusters, %zu mixed operations (%d%% erases)\n", initial.size(), ops.size(), erase_percent);
+
+    // Indexed heap; also records which erases hit a queued cluster, for the lazy queue
+    std::vector<char> erased(ops.size(), 0);
+    Result indexed;
+    {
+        JobQueue queue;
+        auto start = std::chrono::steady_clock::now();
+        queue.reserve(initial.size());
+        for (const ClusterInfo& cluster : initial) queue.push(cluster, cost_of(cluster));
+        indexed.build = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const Op& op = ops[i];
+            if (op.type == OpType::Push) {
+                queue.push(op.cluster, cost_of(op.cluster));
+            } else if (op.type == OpType::Erase) {
+                erased[i] = queue.erase(op.cluster.cluster_id);
+            } else if (!queue.empty()) {
+                indexed.checksum += queue.top_cost();
+                queue.pop();
+                ++indexed.popped;
+            }
+        }
+        indexed.mixed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        while (!queue.empty()) {
+            indexed.checksum += queue.top_cost();
+            queue.pop();
+            ++indexed.popped;
+        }
+        indexed.drain = seconds_since(start);
+    }
+
+    Result lazy;
+    {
+        LazyQueue queue;
+        auto start = std::chrono::steady_clock::now();
+        for (const ClusterInfo& cluster : initial) queue.push(cluster);
+        lazy.build = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < ops.size(); ++i) {
+            const Op& op = ops[i];
+            if (op.type == OpType::Push) {
+                queue.push(op.cluster);
+            } else if (op.type == OpType::Erase) {
+                if (erased[i]) queue.erase(op.cluster.cluster_id);
+            } else if (!queue.empty()) {
+                lazy.checksum += cost_of(queue.pop());
+                ++lazy.popped;
+            }
+        }
+        lazy.mixed = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        while (!queue.empty()) {
+            lazy.checksum += cost_of(queue.pop());
+            ++lazy.popped;
+        }
+        lazy.drain = seconds_since(start);
+    }
+
+    for (const auto& [name, result] : {std::pair<const char*, const Result&>{"lazy", lazy}, {"indexed", indexed}}) {
+        std::printf("%-8s build %7.3fs  mixed %7.3fs  drain %7.3fs  total %7.3fs  (%zu pops, checksum %.6e)\n", name,
+                    result.build, result.mixed, result.drain, result.build + result.mixed + result.drain, result.popped,
+                    result.checksum);
+    }
+    if (lazy.popped != indexed.popped || lazy.checksum != indexed.checksum) {
+        std::printf("MISMATCH\n");
+        return 1;
+    }
+    return 0;
+}
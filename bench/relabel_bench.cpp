@@ -0,0 +1,132 @@
+// Effect of the CSR node order (NodeOrder) on traversals of one large cluster stored as a CSR image.
+//
+// Usage: dcc_relabel_bench [side=1500] [sweeps=5]
+//
+// Builds a side x side grid cluster with a few random local shortcuts, as found in large
+// mesh-like clusters, and gives its nodes scrambled global ids, so the default local order
+// (ascending global id) has no locality. For every order it encodes the CSR image and
+// times sweeps modelled on the child's passes over it: BFS sweeps (as in mincut labelling)
+// and label-propagation sweeps (as in Leiden's local moving). The mean |u - v| over arcs
+// shows how far apart neighbors sit in memory. Relabeling is not exposed as an option
+// until the child reads CSR images itself; this measures what it would gain.
+#include <cluster_csr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Nodes reached by BFS from `sweeps` sources; the same for every order of a connected cluster
+int64_t bfs_sweeps(const CsrView& csr, int sweeps) {
+    int64_t reached = 0;
+    std::vector<int32_t> depth(csr.num_nodes);
+    std::vector<int32_t> queue(csr.num_nodes);
+    for (int sweep = 0; sweep < sweeps; ++sweep) {
+        std::fill(depth.begin(), depth.end(), -1);
+        int32_t source = static_cast<int32_t>((sweep * 7919ull) % csr.num_nodes);
+        size_t head = 0, tail = 0;
+        depth[source] = 0;
+        queue[tail++] = source;
+        while (head < tail) {
+            int32_t u = queue[head++];
+            for (int32_t v : csr.neighbors_of(u)) {
+                if (depth[v] >= 0) continue;
+                depth[v] = depth[u] + 1;
+                queue[tail++] = v;
+            }
+        }
+        reached += static_cast<int64_t>(tail);
+    }
+    return reached;
+}
+
+// Label propagation: every node takes the smallest label among itself and its neighbors.
+// Returns the number of distinct labels left, to keep the work from being optimized out.
+int64_t label_sweeps(const CsrView& csr, int sweeps) {
+    std::vector<int32_t> label(csr.num_nodes);
+    std::iota(label.begin(), label.end(), 0);
+    for (int sweep = 0; sweep < sweeps; ++sweep) {
+        for (uint64_t u = 0; u < csr.num_nodes; ++u) {
+            int32_t best = label[u];
+            for (int32_t v : csr.neighbors_of(u)) best = std::min(best, label[v]);
+            label[u] = best;
+        }
+    }
+    std::sort(label.begin(), label.end());
+    return std::unique(label.begin(), label.end()) - label.begin();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int side = argc > 1 ? std::max(2, std::atoi(argv[1])) : 1500;
+    int sweeps = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    int num_nodes = side * side;
+
+    // Scrambled global ids for the grid positions
+    std::mt19937 rng(42);
+    std::vector<int> global_id(num_nodes);
+    std::iota(global_id.begin(), global_id.end(), 1000000);
+    std::shuffle(global_id.begin(), global_id.end(), rng);
+
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::pair<int, int>> cluster_entries;
+    edges.reserve(static_cast<size_t>(num_nodes) * 2 + num_nodes / 50);
+    cluster_entries.reserve(num_nodes);
+    std::uniform_int_distribution<int> offset(-side * 3, side * 3);
+    for (int p = 0; p < num_nodes; ++p) {
+        cluster_entries.emplace_back(global_id[p], 1);
+        if (p % side + 1 < side) edges.emplace_back(global_id[p], global_id[p + 1]);
+        if (p + side < num_nodes) edges.emplace_back(global_id[p], global_id[p + side]);
+        if (p % 50 == 0) {
+            int q = std::clamp(p + offset(rng), 0, num_nodes - 1);
+            if (q != p) edges.emplace_back(global_id[p], global_id[q]);
+        }
+    }
+    std::printf("cluster: %d nodes, %zu edges, %d sweeps\n", num_nodes, edges.size(), sweeps);
+
+    struct Order {
+        const char* name;
+        NodeOrder order;
+    };
+    bool match = true;
+    for (const Order& order : {Order{"none", NodeOrder::Global}, Order{"degree", NodeOrder::Degree},
+                               Order{"rcm", NodeOrder::Rcm}}) {
+        std::vector<uint8_t> image;
+        auto start = std::chrono::steady_clock::now();
+        encode_csr(edges, cluster_entries, image, order.order);
+        double encode_time = seconds_since(start);
+        CsrView csr = view_csr(reinterpret_cast<const char*>(image.data()), image.size(), order.name);
+
+        double gap = 0;
+        for (uint64_t u = 0; u < csr.num_nodes; ++u) {
+            for (int32_t v : csr.neighbors_of(u)) gap += std::abs(static_cast<double>(v) - static_cast<double>(u));
+        }
+        gap /= 2.0 * csr.num_edges;
+
+        start = std::chrono::steady_clock::now();
+        int64_t bfs = bfs_sweeps(csr, sweeps);
+        double bfs_time = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        int64_t labels = label_sweeps(csr, sweeps);
+        double label_time = seconds_since(start);
+
+        if (bfs != static_cast<int64_t>(sweeps) * num_nodes) match = false;
+        std::printf("%-7s encode %7.3fs  mean neighbor gap %12.1f  bfs %7.3fs  label propagation %7.3fs (%lld labels)\n",
+                    order.name, encode_time, gap, bfs_time, label_time, static_cast<long long>(labels));
+    }
+    if (!match) {
+        std::printf("MISMATCH\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,285 @@
+// Load balancer yield tree: the slot-map YieldTree vs the previous unordered_map of nodes
+// with per-node children vectors, recursive erasure and hashed parent-chain walks.
+//
+// Usage: dcc_yield_bench [num_yields=5000000] [abort_permille=5] [depth_bias_percent=90]
+//
+// Simulates the load balancer's bookkeeping for num_yields YIELD_REPORTs: clusters are run,
+// yield sub-clusters, and complete or abort (abort_permille of completions), which sweeps
+// their queued children and discards later yields under them. With depth_bias_percent of
+// picks going to the newest cluster, splitting recurses into long yield chains. Both trees
+// see the same events and must agree on every count (checksum).
+#include <yield_tree.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Counts {
+    uint64_t resolved_roots = 0;
+    uint64_t discarded = 0;     // yields under an aborted ancestor
+    uint64_t swept = 0;         // queued children of aborted clusters
+    uint64_t root_sum = 0;      // sum of the root IDs of accepted yields
+
+    bool operator==(const Counts& other) const {
+        return resolved_roots == other.resolved_roots && discarded == other.discarded &&
+               swept == other.swept && root_sum == other.root_sum;
+    }
+};
+
+// The previous yield tree, as the load balancer kept it
+class MapTree {
+private:
+    struct Node {
+        int cluster_id;
+        int parent_id;
+        bool work_done = false;
+        bool aborted = false;
+        int expected_yields = 0;
+        int resolved_children = 0;
+        std::vector<int> children;
+    };
+    std::unordered_map<int, Node> tree;
+
+    void erase_subtree(int cluster_id) {
+        if (!tree.count(cluster_id)) return;
+        std::vector<int> children = tree[cluster_id].children;
+        tree.erase(cluster_id);
+        for (int child_id : children) erase_subtree(child_id);
+    }
+
+    bool is_ancestor_aborted(int cluster_id) {
+        int current = cluster_id;
+        while (tree.count(current)) {
+            if (tree[current].aborted) return true;
+            if (tree[current].parent_id == -1) break;
+            current = tree[current].parent_id;
+        }
+        return false;
+    }
+
+    void try_resolve(int cluster_id) {
+        if (!tree.count(cluster_id)) return;
+        Node& node = tree[cluster_id];
+        if (!node.work_done || node.resolved_children < node.expected_yields) return;
+        int parent_id = node.parent_id;
+        erase_subtree(cluster_id);
+        if (parent_id == -1) {
+            ++counts.resolved_roots;
+        } else if (tree.count(parent_id)) {
+            tree[parent_id].resolved_children++;
+            try_resolve(parent_id);
+        }
+    }
+
+    void sweep(int cluster_id, const std::vector<char>& started, std::vector<char>& live) {
+        Node& node = tree[cluster_id];
+        std::vector<int> children_copy = node.children;
+        for (int child_id : children_copy) {
+            if (!tree.count(child_id)) continue;
+            if (!tree[child_id].work_done && !started[child_id]) {
+                live[child_id] = 0;
+                ++counts.swept;
+                node.resolved_children++;
+                node.children.erase(std::remove(node.children.begin(), node.children.end(), child_id), node.children.end());
+                tree.erase(child_id);
+            }
+        }
+    }
+
+public:
+    Counts counts;
+
+    bool yield(int parent_id, int child_id) {
+        if (!tree.count(parent_id)) tree[parent_id] = {parent_id, -1, false, false, 0, 0, {}};
+        Node& parent = tree[parent_id];
+        if (is_ancestor_aborted(parent_id)) {
+            ++counts.discarded;
+            parent.resolved_children++;
+            try_resolve(parent_id);
+            return false;
+        }
+        tree[child_id] = {child_id, parent_id, false, false, 0, 0, {}};
+        tree[parent_id].children.push_back(child_id);
+        int root = parent_id;
+        while (tree.count(root) && tree[root].parent_id != -1) root = tree[root].parent_id;
+        counts.root_sum += root;
+        return true;
+    }
+
+    void complete(int cluster_id, int yield_count, bool aborted, const std::vector<char>& started, std::vector<char>& live) {
+        if (yield_count == 0 && !tree.count(cluster_id)) {
+            ++counts.resolved_roots;
+            return;
+        }
+        if (!tree.count(cluster_id)) tree[cluster_id] = {cluster_id, -1, false, false, 0, 0, {}};
+        Node& node = tree[cluster_id];
+        node.work_done = true;
+        node.expected_yields = yield_count;
+        node.aborted = aborted;
+        if (aborted) {
+            sweep(cluster_id, started, live);
+            int root = cluster_id;
+            while (tree.count(root) && tree[root].parent_id != -1) root = tree[root].parent_id;
+            counts.root_sum += root;
+        }
+        try_resolve(cluster_id);
+    }
+};
+
+// YieldTree driven the way LoadBalancer drives it
+class SlotTree {
+private:
+    YieldTree tree;
+
+    void try_resolve(uint32_t slot) {
+        while (slot != YieldTree::NONE) {
+            const YieldNode& node = tree.node(slot);
+            if (!node.work_done || node.resolved_children < node.expected_yields) return;
+            uint32_t parent = node.parent;
+            bool root = node.parent_id == -1;
+            tree.erase_subtree(slot);
+            if (root) {
+                ++counts.resolved_roots;
+                return;
+            }
+            tree.node(parent).resolved_children++;
+            slot = parent;
+        }
+    }
+
+public:
+    Counts counts;
+
+    bool yield(int parent_id, int child_id) {
+        uint32_t parent = tree.find_or_add_root(parent_id);
+        if (tree.node(parent).under_abort) {
+            ++counts.discarded;
+            tree.node(parent).resolved_children++;
+            try_resolve(parent);
+            return false;
+        }
+        uint32_t child = tree.add_child(parent, child_id);
+        counts.root_sum += tree.node(child).root_id;
+        return true;
+    }
+
+    void complete(int cluster_id, int yield_count, bool aborted, const std::vector<char>& started, std::vector<char>& live) {
+        if (yield_count == 0 && !tree.contains(cluster_id)) {
+            ++counts.resolved_roots;
+            return;
+        }
+        uint32_t slot = tree.find_or_add_root(cluster_id);
+        YieldNode& node = tree.node(slot);
+        node.work_done = true;
+        node.expected_yields = yield_count;
+        if (aborted) {
+            tree.mark_aborted(slot);
+            tree.for_each_child(slot, [&](uint32_t child_slot) {
+                const YieldNode& child = tree.node(child_slot);
+                if (!child.work_done && !started[child.cluster_id]) {
+                    live[child.cluster_id] = 0;
+                    ++counts.swept;
+                    tree.node(slot).resolved_children++;
+                    tree.erase_subtree(child_slot);
+                }
+            });
+            counts.root_sum += tree.node(slot).root_id;
+        }
+        try_resolve(slot);
+    }
+};
+
+struct Config {
+    size_t num_yields;
+    int abort_permille;
+    int depth_bias_percent;
+};
+
+// Run the event simulation against one tree; every random draw depends only on the
+// simulation state, so both trees see identical events
+template <typename Tree>
+double simulate(Tree& tree, const Config& config) {
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<int> percent(0, 99), permille(0, 999);
+
+    size_t num_roots = std::max<size_t>(1, config.num_yields / 8);
+    size_t max_ids = num_roots + config.num_yields;
+    std::vector<char> started(max_ids, 0), live(max_ids, 0);
+    std::vector<int> yields(max_ids, 0);
+    std::vector<int> active;        // queued or running clusters (swept ones are skipped lazily)
+    active.reserve(max_ids);
+    for (size_t i = 0; i < num_roots; ++i) {
+        active.push_back(static_cast<int>(i));
+        live[i] = 1;
+    }
+
+    int next_id = static_cast<int>(num_roots);
+    size_t yielded = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (!active.empty()) {
+        size_t pick = percent(rng) < config.depth_bias_percent
+            ? active.size() - 1
+            : std::uniform_int_distribution<size_t>(0, active.size() - 1)(rng);
+        int cluster = active[pick];
+        if (!live[cluster]) {
+            active[pick] = active.back();
+            active.pop_back();
+            continue;
+        }
+        started[cluster] = 1;
+
+        // Yield while the budget lasts (a third of picks), otherwise complete
+        if (yielded < config.num_yields && percent(rng) < 67) {
+            int child = next_id++;
+            ++yielded;
+            ++yields[cluster];
+            if (tree.yield(cluster, child)) {
+                live[child] = 1;
+                active.push_back(child);
+            }
+            continue;
+        }
+        live[cluster] = 0;
+        active[pick] = active.back();
+        active.pop_back();
+        tree.complete(cluster, yields[cluster], permille(rng) < config.abort_permille, started, live);
+    }
+    return seconds_since(start);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Config config;
+    config.num_yields = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    config.abort_permille = argc > 2 ? std::clamp(std::atoi(argv[2]), 0, 1000) : 5;
+    config.depth_bias_percent = argc > 3 ? std::clamp(std::atoi(argv[3]), 0, 100) : 90;
+    std::printf("%zu yields, %d/1000 aborts, %d%% depth bias\n", config.num_yields, config.abort_permille,
+                config.depth_bias_percent);
+
+    MapTree map_tree;
+    double map_seconds = simulate(map_tree, config);
+    SlotTree slot_tree;
+    double slot_seconds = simulate(slot_tree, config);
+
+    for (const auto& [name, seconds, counts] : {std::tuple<const char*, double, const Counts&>{"map", map_seconds, map_tree.counts},
+                                                {"slot", slot_seconds, slot_tree.counts}}) {
+        std::printf("%-5s %7.3fs  (%llu roots resolved, %llu yields discarded, %llu swept)\n", name, seconds,
+                    static_cast<unsigned long long>(counts.resolved_roots),
+                    static_cast<unsigned long long>(counts.discarded), static_cast<unsigned long long>(counts.swept));
+    }
+    if (!(map_tree.counts == slot_tree.counts)) {
+        std::printf("MISMATCH\n");
+        return 1;
+    }
+    return 0;
+}
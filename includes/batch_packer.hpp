@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Max segment tree over a fixed number of slots, used to find the first slot whose value
+ * reaches a bound in O(log n). Slots start at -infinity.
+ */
+class MaxSegmentTree {
+private:
+    size_t leaves = 1;
+    std::vector<double> tree;   // tree[1] is the root, leaves start at tree[leaves]
+
+public:
+    explicit MaxSegmentTree(size_t size);
+
+    void set(size_t slot, double value);
+    double get(size_t slot) const { return tree[leaves + slot]; }
+
+    // First slot whose value is >= bound, or -1 if there is none
+    int64_t first_at_least(double bound) const;
+};
+
+/**
+ * Group items into batches of total cost close to target, first-fit-decreasing.
+ * Items costing target or more form batches of their own. The others are placed in
+ * decreasing cost order into the first open batch they fit in without exceeding target;
+ * when none has room, into the first open batch still under target (overshooting it by
+ * less than the item's cost), and only then into a new batch. A batch closes once it
+ * reaches target, so every batch but the last few open ones costs at least target.
+ * Returns the batches as item positions, each batch in decreasing cost order (ties by
+ * position): first the standalone items, then the packed batches in the order they opened.
+ */
+std::vector<std::vector<int32_t>> pack_batches(const std::vector<float>& costs, double target);
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Binary input formats.
+ *
+ * Legacy files are a record count (uint64 for .bedgelist, uint32 for .bcluster) followed by
+ * (int32, int32) records. Versioned files written by dcc-convert --header start with a
+ * BinaryHeader instead and keep their records at data_offset (4 KiB aligned), followed by
+ * an optional remap table. Readers tell the two apart by the magic, which as a legacy
+ * count would exceed any file size.
+ */
+enum class BinaryKind : uint32_t { Edgelist = 1, Cluster = 2 };
+
+constexpr char BINARY_MAGIC[8] = {'D', 'C', 'C', 'B', 'I', 'N', '\r', '\n'};
+constexpr uint32_t BINARY_FORMAT_VERSION = 1;
+constexpr uint64_t BINARY_DATA_ALIGNMENT = 4096;
+
+struct BinaryHeader {
+    char magic[8];              // BINARY_MAGIC
+    uint32_t version;           // BINARY_FORMAT_VERSION
+    uint32_t kind;              // BinaryKind
+    uint64_t num_records;
+    uint64_t num_nodes;         // distinct node ids (both columns of an edge list, first column of a clustering)
+    uint64_t data_offset;       // byte offset of the records
+    uint64_t remap_offset;      // byte offset of num_nodes ascending int32 node ids (0 = no table)
+    uint64_t checksum;          // pair_checksum() of all records
+};
+
+// Records of a mapped binary file, with its header when it is versioned
+struct BinaryView {
+    const int32_t* pairs = nullptr;
+    uint64_t num_records = 0;
+    const BinaryHeader* header = nullptr;   // nullptr for legacy files
+
+    // Original node id of dense id i (i < header->num_nodes), when the file has a remap table
+    const int32_t* remap = nullptr;
+};
+
+/**
+ * View the records of a mapped legacy or versioned binary file of the given kind.
+ * Throws std::runtime_error if the file is truncated or is of another kind.
+ */
+BinaryView view_binary(const char* data, const char* end, BinaryKind kind, const std::string& filepath);
+
+/**
+ * Order-sensitive checksum of records [first, first + count) of a file. It is a sum over
+ * records, so ranges can be checksummed in parallel and added up.
+ */
+uint64_t pair_checksum(const int32_t* pairs, uint64_t first, uint64_t count);
+
+struct ConvertOptions {
+    int num_threads = 1;
+    bool header = false;        // write a versioned header with node count, remap table and checksum
+};
+
+struct ConvertStats {
+    uint64_t num_records = 0;
+    uint64_t num_nodes = 0;     // only counted with a header
+    uint64_t checksum = 0;
+    double thread_seconds = 0;  // summed busy time of the conversion threads
+};
+
+/**
+ * Convert a text edge list or clustering to its binary form at output. The input is split
+ * into line-aligned chunks; a first pass counts the lines of each chunk, a second parses
+ * every chunk on its own thread and pwrites its records at their final offset in large
+ * blocks aligned to the file. Throws std::runtime_error on I/O errors.
+ */
+ConvertStats convert_text_pairs(const std::string& input, const std::string& output, BinaryKind kind,
+                                const ConvertOptions& options);
+
+/**
+ * Recompute the checksum of a versioned binary file. Returns false on a mismatch.
+ */
+bool verify_binary(const std::string& filepath, BinaryKind kind, int num_threads);
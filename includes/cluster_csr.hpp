@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <span>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Batch graph in CSR form with local node ids (.bcsr). Only dcc_relabel_bench builds it for
+ * now: the CM/MincutOnly child reads edge lists, so Phase 1 does not write it.
+ *
+ * Nodes get local ids 0..n-1 and each undirected edge is stored as an arc in both adjacency
+ * lists (a self-loop twice in its own list), so a reader can walk neighbors without
+ * building anything. Adjacency lists are sorted by local id. local_to_global maps a local
+ * id back to its global node id, so results only need translating when they are written.
+ * Local ids follow ascending global ids unless the batch was relabeled (see NodeOrder).
+ *
+ * The image is laid out for mmap: a CsrHeader, then int64 offsets[n + 1], int32
+ * neighbors[2m] and int32 local_to_global[n].
+ */
+constexpr char CSR_MAGIC[8] = {'D', 'C', 'C', 'C', 'S', 'R', '0', '1'};
+
+struct CsrHeader {
+    char magic[8];          // CSR_MAGIC
+    uint64_t num_nodes;
+    uint64_t num_edges;     // undirected edges; the adjacency holds 2 * num_edges arcs
+    uint64_t reserved;
+};
+
+// Size of the CSR image of a graph with num_nodes nodes and num_edges edges
+inline uint64_t csr_length(uint64_t num_nodes, uint64_t num_edges) {
+    return sizeof(CsrHeader) + (num_nodes + 1) * sizeof(int64_t) + 2 * num_edges * sizeof(int32_t) +
+           num_nodes * sizeof(int32_t);
+}
+
+/**
+ * Read-only view of a CSR image. Pointers reference the image, which must stay mapped.
+ */
+struct CsrView {
+    uint64_t num_nodes = 0;
+    uint64_t num_edges = 0;
+    const int64_t* offsets = nullptr;
+    const int32_t* neighbors = nullptr;
+    const int32_t* local_to_global = nullptr;
+
+    std::span<const int32_t> neighbors_of(uint64_t node) const {
+        return {neighbors + offsets[node], static_cast<size_t>(offsets[node + 1] - offsets[node])};
+    }
+    int64_t degree(uint64_t node) const { return offsets[node + 1] - offsets[node]; }
+};
+
+// Order of the local ids of a CSR image
+enum class NodeOrder {
+    Global,     // ascending global id
+    Degree,     // descending degree, so high-degree nodes share cache lines
+    Rcm,        // reverse Cuthill-McKee: BFS order, which keeps neighbors close in memory
+};
+
+// True if [data, data + size) starts with a CSR image
+bool is_csr(const void* data, size_t size);
+
+/**
+ * View the CSR image in [data, data + size); data must be 8-byte aligned.
+ * Throws std::runtime_error if the image is truncated (filepath is used in the message).
+ */
+CsrView view_csr(const char* data, size_t size, const std::string& filepath);
+
+/**
+ * Append the CSR image of a batch to out. Nodes are the global ids of cluster_entries
+ * (node_id, cluster_id), numbered in the given order; every edge endpoint must be one of them.
+ * Ties in Degree and Rcm order go to the smaller global id.
+ */
+void encode_csr(const std::vector<std::pair<int, int>>& edges,
+                const std::vector<std::pair<int, int>>& cluster_entries,
+                std::vector<uint8_t>& out,
+                NodeOrder order = NodeOrder::Global);
+
+/**
+ * Expand a CSR image back to global (source, target) pairs, each edge once with
+ * source <= target in local id order
+ */
+std::vector<std::pair<int, int>> csr_edges(const CsrView& csr);
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Compact node -> cluster index built from the (node_id, cluster_id) entries of a clustering.
+ *
+ * Clusters are renumbered to dense indices 0..C-1 in ascending cluster_id order.
+ * Node lookups go through a flat int32 array: when node ids span a compact range the array is
+ * addressed directly by node_id - min_node_id, otherwise by the position of node_id in a
+ * sorted id table. Cluster membership is stored as CSR (offsets + node array) built with a
+ * counting sort, with each cluster's nodes in ascending order.
+ */
+class ClusterIndex {
+private:
+    int32_t min_node_id = 0;
+    bool direct_nodes = true;               // direct addressing vs. sorted id table
+    std::vector<int32_t> node_cluster;      // node slot -> dense cluster index (-1 = unclustered)
+    std::vector<int32_t> sorted_nodes;      // sorted node ids (sparse id ranges only)
+
+    std::vector<int32_t> cluster_ids;       // dense cluster index -> cluster_id
+    std::vector<int64_t> member_offsets;    // CSR offsets into member_nodes (size C + 1)
+    std::vector<int32_t> member_nodes;      // node ids grouped by dense cluster index
+
+public:
+    /**
+     * Build the index from (node_id, cluster_id) entries in file order. A node listed in
+     * several clusters is a member of each, but maps to the last cluster it is listed in
+     * (as before). The entries vector is released.
+     */
+    void build(std::vector<std::pair<int, int>>& entries);
+
+    // Dense cluster index of node_id, or -1 if the node is not in the clustering
+    inline int32_t cluster_of(int node_id) const {
+        if (direct_nodes) {
+            uint32_t slot = static_cast<uint32_t>(node_id) - static_cast<uint32_t>(min_node_id);
+            return slot < node_cluster.size() ? node_cluster[slot] : -1;
+        }
+        return cluster_of_sparse(node_id);
+    }
+
+    int32_t cluster_of_sparse(int node_id) const;
+
+    size_t num_clusters() const { return cluster_ids.size(); }
+    int cluster_id(int32_t cluster) const { return cluster_ids[cluster]; }
+
+    // Nodes of a dense cluster, in ascending node_id order
+    std::span<const int32_t> members(int32_t cluster) const {
+        return {member_nodes.data() + member_offsets[cluster],
+                static_cast<size_t>(member_offsets[cluster + 1] - member_offsets[cluster])};
+    }
+
+    size_t num_memberships() const { return member_nodes.size(); }
+    size_t memory_bytes() const;
+};
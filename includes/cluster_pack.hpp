@@ -0,0 +1,129 @@
+#pragma once
+#include <constants.hpp>
+#include <mapped_file.hpp>
+#include <string>
+#include <vector>
+#include <span>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * Packed cluster archive written by Phase 1 in place of one .bedgelist/.bcluster pair per batch.
+ *
+ * clusters.pack holds the payload of every batch back to back: the exact bytes of its
+ * .bedgelist file (or, with --compress-clusters, of its .cedgelist file; see edge_codec.hpp)
+ * followed by the exact bytes of its .bcluster file. clusters.idx is a small
+ * header followed by one fixed-width PackIndexEntry per batch, in summary.csv order, so it
+ * can be mmapped and read without parsing.
+ */
+struct PackIndexEntry {
+    int32_t cluster_id;     // batch head cluster
+    int32_t node_count;
+    int64_t edge_count;
+    uint64_t offset;        // payload offset in clusters.pack
+    uint64_t length;        // payload length in bytes
+};
+static_assert(sizeof(PackIndexEntry) == 32, "clusters.idx records are 32 bytes");
+
+struct PackIndexHeader {
+    char magic[8];          // PACK_INDEX_MAGIC
+    uint64_t num_entries;
+};
+
+constexpr char PACK_DATA_FILE[] = "clusters.pack";
+constexpr char PACK_INDEX_FILE[] = "clusters.idx";
+constexpr char PACK_INDEX_MAGIC[8] = {'D', 'C', 'C', 'I', 'D', 'X', '0', '1'};
+
+// Size of the .bedgelist image at the start of a payload
+inline uint64_t pack_edges_length(int64_t edge_count) {
+    return sizeof(uint64_t) + static_cast<uint64_t>(edge_count) * 2 * sizeof(int32_t);
+}
+
+// Size of the .bcluster image at the end of a payload
+inline uint64_t pack_cluster_length(int32_t node_count) {
+    return sizeof(uint32_t) + static_cast<uint64_t>(node_count) * 2 * sizeof(int32_t);
+}
+
+// Size of a whole uncompressed payload (.bedgelist image + .bcluster image)
+inline uint64_t pack_payload_length(int32_t node_count, int64_t edge_count) {
+    return pack_edges_length(edge_count) + pack_cluster_length(node_count);
+}
+
+// Encoding of the edge part of each payload
+enum class PackEdgeFormat {
+    Raw,            // .bedgelist image
+    Compressed,     // sorted .cedgelist image
+};
+
+/**
+ * Appends batch payloads to <dir>/clusters.pack with pwrite, starting at base_offset.
+ * Several ranks can write disjoint ranges of one pack by using exclusive-scan offsets;
+ * only the first writer should truncate.
+ */
+class ClusterPackWriter {
+private:
+    int fd = -1;
+    std::string path;
+    uint64_t next_offset;
+    PackEdgeFormat edge_format;
+    std::vector<PackIndexEntry> entries;
+    std::vector<uint8_t> encoded;   // reused buffer of the encoded edge part
+
+public:
+    ClusterPackWriter(const std::string& dir, uint64_t base_offset, bool truncate,
+                      PackEdgeFormat edge_format = PackEdgeFormat::Raw);
+    ~ClusterPackWriter();
+
+    ClusterPackWriter(const ClusterPackWriter&) = delete;
+    ClusterPackWriter& operator=(const ClusterPackWriter&) = delete;
+
+    /**
+     * Append one batch; cluster_entries are its (node_id, cluster_id) pairs.
+     * Compression sorts edges in place.
+     */
+    void append(const ClusterInfo& head,
+                std::vector<std::pair<int, int>>& edges,
+                const std::vector<std::pair<int, int>>& cluster_entries);
+
+    // Index entries of the batches appended by this writer
+    const std::vector<PackIndexEntry>& index() const { return entries; }
+};
+
+/**
+ * Write <dir>/clusters.idx
+ */
+void write_pack_index(const std::string& dir, const std::vector<PackIndexEntry>& entries);
+
+/**
+ * Read access to a packed archive: the index is mmapped, payloads are read with pread.
+ */
+class ClusterPackReader {
+private:
+    MappedFile index_file;
+    int fd = -1;
+    std::string path;
+    std::span<const PackIndexEntry> index_entries;
+    std::unordered_map<int, size_t> by_cluster;     // head cluster_id -> index position
+
+public:
+    explicit ClusterPackReader(const std::string& dir);
+    ~ClusterPackReader();
+
+    ClusterPackReader(const ClusterPackReader&) = delete;
+    ClusterPackReader& operator=(const ClusterPackReader&) = delete;
+
+    // True if dir holds a packed archive (clusters.idx)
+    static bool exists(const std::string& dir);
+
+    std::span<const PackIndexEntry> entries() const { return index_entries; }
+
+    // Index entry of the batch headed by cluster_id, or nullptr
+    const PackIndexEntry* find(int cluster_id) const;
+
+    /**
+     * Copy a batch payload into standalone .bedgelist and .bcluster files, decoding
+     * compressed edges
+     */
+    void extract(const PackIndexEntry& entry, const std::string& edgelist_path, const std::string& cluster_path) const;
+};
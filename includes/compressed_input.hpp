@@ -0,0 +1,125 @@
+#pragma once
+#include <parser.hpp>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstddef>
+
+/**
+ * Streaming decompression of gzip (.gz) and zstd (.zst) text inputs, so archived edge lists
+ * and clusterings are read without a decompress-to-scratch step. Support is compiled in with
+ * DCC_HAVE_ZLIB and DCC_HAVE_ZSTD; a compressed input without it is rejected when opened.
+ *
+ * A compressed input is read as a sequence of independently decodable frames: the members
+ * of a gzip file are treated as one frame, while every zstd frame (as written by pzstd or by
+ * concatenating compressed pieces) is its own, so ranges of frames can be decompressed and
+ * parsed in parallel.
+ */
+enum class Compression { None, Gzip, Zstd };
+
+// Compression of a file from its leading magic bytes
+Compression detect_compression(const char* data, size_t size);
+
+// Compression of a file on disk (None if it cannot be read)
+Compression file_compression(const std::string& filepath);
+
+const char* compression_name(Compression compression);
+
+// True if this build can decompress the format
+bool compression_supported(Compression compression);
+
+// Path without a trailing .gz or .zst
+std::string strip_compression_suffix(const std::string& path);
+
+/**
+ * Offsets at which the independently decodable frames of [data, data + size) start
+ * (the first one is 0). Throws std::runtime_error on a corrupt zstd frame.
+ */
+std::vector<size_t> frame_offsets(Compression compression, const char* data, size_t size,
+                                  const std::string& filepath);
+
+/**
+ * Decompresses [begin, stream_end) on a background thread, in blocks handed out in order
+ * through a bounded queue, so decompression runs ahead of the caller's parsing. Blocks of
+ * the frames in [begin, own_end) are marked own; decompression continues past own_end only
+ * while the caller keeps asking for blocks.
+ */
+class DecompressStream {
+private:
+    struct State;
+    State* state;
+
+public:
+    DecompressStream(Compression compression, const char* begin, const char* own_end, const char* stream_end,
+                     const std::string& filepath);
+    ~DecompressStream();
+
+    DecompressStream(const DecompressStream&) = delete;
+    DecompressStream& operator=(const DecompressStream&) = delete;
+
+    /**
+     * Next decompressed block, valid until the following call. Returns false at the end of
+     * the stream; rethrows a decompression error.
+     */
+    bool next(const char*& data, size_t& size, bool& own);
+};
+
+/**
+ * Decompress up to max_bytes from the start of a compressed file (e.g. to detect its delimiter)
+ */
+std::string decompress_prefix(Compression compression, const char* data, size_t size, size_t max_bytes,
+                              const std::string& filepath);
+
+/**
+ * Parse the lines of a compressed text range, calling emit(first, second) per line in order.
+ * With S the decompressed offset of begin and E that of own_end, the range holds the lines
+ * starting in (S, E], so adjacent ranges split a stream without losing or repeating a line
+ * and the range starting at the beginning of a file skips its header. The last line of a
+ * range is completed from the frames that follow it.
+ */
+template <typename Emit>
+void parse_compressed_lines(Compression compression, const char* begin, const char* own_end,
+                            const char* stream_end, char delimiter, const std::string& filepath, Emit&& emit) {
+    DecompressStream stream(compression, begin, own_end, stream_end, filepath);
+    std::string carry;          // partial line continued in the next block
+    bool skipping = true;       // still before the first line start after S
+    const char* data;
+    size_t size;
+    bool own;
+    while (stream.next(data, size, own)) {
+        const char* p = data;
+        const char* end = data + size;
+        if (!own) {
+            // Past E: only the line started at or before E is left to complete
+            if (skipping) return;
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            carry.append(p, newline ? newline + 1 : end);
+            if (newline) break;
+            continue;
+        }
+        if (skipping) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!newline) continue;
+            p = newline + 1;
+            skipping = false;
+        }
+        if (!carry.empty()) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            carry.append(p, newline ? newline + 1 : end);
+            if (!newline) continue;
+            parse_pairs(carry.data(), carry.data() + carry.size(), delimiter, emit);
+            carry.clear();
+            p = newline + 1;
+        }
+        const char* last_newline = static_cast<const char*>(memrchr(p, '\n', end - p));
+        if (last_newline) {
+            parse_pairs(p, last_newline + 1, delimiter, emit);
+            p = last_newline + 1;
+        }
+        carry.append(p, end);
+    }
+    if (!skipping && !carry.empty()) {
+        parse_pairs(carry.data(), carry.data() + carry.size(), delimiter, emit);
+    }
+}
@@ -1,19 +1,33 @@
 #pragma once
 #include <mpi.h>
+#include <cstdint>
 
 enum class MessageType: int {
     // Worker to LB
+    // Data: int64 number of yield IDs the worker has used so far
     WORK_REQUEST = 0,   // requesting a cluster to be processed
+    // Data: WorkDone
     WORK_DONE = 1,      // the processing of the assigned cluster is completed successfully
     WORK_ABORTED = 2,   // the processing of the assigned cluster is aborted
     AGGREGATE_DONE = 3, // aggregation of results completed
-    // Data: [parent_cluster_id, child_global_id, node_count, edge_count]
+    // Data: YieldReport
     YIELD_REPORT = 4,   // report yielded sub-clusters from CC
     // Worker to LB (piggybacked on WORK_REQUEST)
     WORKER_REPORT = 5,      // worker status report, sent immediately after WORK_REQUEST
 
     // LB to Worker
+    // Data: int64 [yield_id_first, yield_id_count, cluster_id, is_yielded, cluster_id, is_yielded, ...]
     DISTRIBUTE_WORK = 6,    // distribute a cluster to be processed
+
+    // Worker to LB
+    // Data: WorkerInfo
+    WORKER_INFO = 7,        // node and memory budget of the worker, sent before its first WORK_REQUEST
+    // Data: none (an int), answered with YIELD_IDS
+    YIELD_ID_REQUEST = 8,   // a worker ran out of yield IDs in the middle of a cluster
+
+    // LB to Worker
+    // Data: int64 [yield_id_first, yield_id_count]
+    YIELD_IDS = 9,          // block of yield IDs answering YIELD_ID_REQUEST
 };
 
 constexpr int to_int(MessageType messageType) {
@@ -21,7 +35,14 @@ constexpr int to_int(MessageType messageType) {
 }
 
 // Special cluster ID value to signal no more jobs available
-constexpr int NO_MORE_JOBS = -1;
+constexpr int64_t NO_MORE_JOBS = -1;
+
+// Yielded sub-clusters are numbered from a range above every 32-bit input cluster ID. The load
+// balancer hands the range out to workers in blocks of YIELD_ID_BLOCK IDs, and sends a worker
+// a new block with its next assignment once it holds fewer than YIELD_ID_LOW_WATER unused IDs.
+constexpr int64_t YIELD_ID_BASE = int64_t{1} << 32;
+constexpr int64_t YIELD_ID_BLOCK = 4096;
+constexpr int64_t YIELD_ID_LOW_WATER = YIELD_ID_BLOCK / 2;
 
 // Cumulative status report sent from worker to load balancer.
 // Piggybacked on every WORK_REQUEST (sent as a follow-up message).
@@ -30,4 +51,37 @@ struct WorkerReport {
     int oom_count;          // clusters killed by signal (likely OOM) since start
     int timeout_count;      // clusters that timed out since start
     int peak_memory_mb;     // max peak RSS (MB) across all clusters processed
-};
\ No newline at end of file
+};
+
+// Completion message of a cluster (WORK_DONE/WORK_ABORTED), sent as raw bytes.
+// The measured run times feed the load balancer's cost model (see cost_model.hpp).
+struct WorkDone {
+    int64_t cluster_id;
+    int yield_count;        // sub-clusters directly yielded while processing the cluster
+    double wall_seconds;    // run time of the child process
+    double cpu_seconds;     // user + system CPU time of the child process
+    int peak_memory_mb;     // peak RSS of the child process
+    int oom_killed;         // 1 if the child was killed by SIGKILL without timing out (likely OOM)
+};
+
+// Yielded sub-cluster of a running cluster (YIELD_REPORT), sent as raw bytes
+struct YieldReport {
+    int64_t parent_id;
+    int64_t child_id;       // taken from the worker's block of yield IDs
+    int node_count;
+    int64_t edge_count;
+};
+
+// Placement information of a worker, sent as raw bytes. Workers reporting the same node
+// name share its memory budget, which the load balancer keeps their clusters within.
+struct WorkerInfo {
+    char node_name[MPI_MAX_PROCESSOR_NAME];
+    int64_t memory_budget_mb;   // memory the clusters running on the node may use together
+};
+
+// Records information of clusters to be assigned. Used to estimate cost and determine priority, etc.
+struct ClusterInfo {
+    int64_t cluster_id;     // input cluster ID, or a yield ID (>= YIELD_ID_BASE)
+    int node_count;     // number of nodes
+    int64_t edge_count; // number of edges
+};
@@ -0,0 +1,130 @@
+#pragma once
+#include <array>
+#include <string>
+#include <cstdint>
+
+/**
+ * Ridge least-squares regression of y on D features, kept as its sufficient statistics
+ * (X'X, X'y, y'y) so samples from any number of runs can be merged into one fit.
+ */
+template <int D>
+struct RidgeFit {
+    int64_t samples = 0;
+    std::array<double, D * D> xtx{};
+    std::array<double, D> xty{};
+    double yty = 0;
+
+    bool fitted = false;
+    std::array<double, D> weights{};
+    double residual_sd = 0;     // standard deviation of the residuals of the fitted weights
+
+    void add(const std::array<double, D>& x, double y);
+
+    /**
+     * Solve for the weights with the given penalty per sample on all but the intercept;
+     * leaves the fit unchanged if the samples are degenerate
+     */
+    void fit(double ridge);
+
+    double predict(const std::array<double, D>& x) const;
+};
+
+/**
+ * Resource model of a cluster, fitted from the run times and peak memory workers measure
+ * (see WorkDone).
+ *
+ * log(wall seconds) is regressed by ridge least squares on log n, log density, their square
+ * and product terms, and indicators for the method (CM/WCC) and mincut type. The model keeps
+ * the sufficient statistics of the regression (X'X, X'y), so runs sharing a model file keep
+ * adding samples to the same fit.
+ *
+ * Predictions are scaled into the units of the node_count + 1/density heuristic, chosen so
+ * that over the observed clusters both sum to the same total; --min-batch-cost thus keeps its
+ * meaning, while the model redistributes cost between clusters. Until MIN_SAMPLES clusters
+ * have been observed, the heuristic is used.
+ *
+ * Peak RSS in MB is regressed the same way on n and m (in thousands). Memory predictions are
+ * meant for placement, so they are padded by MEMORY_MARGIN_SD residual standard deviations.
+ */
+class CostModel {
+public:
+    static constexpr int RUNTIME_FEATURES = 7;
+    static constexpr int MEMORY_FEATURES = 3;
+    static constexpr int64_t MIN_SAMPLES = 32;
+    static constexpr double MIN_SECONDS = 1e-3;     // run times are clamped to this before taking logs
+    static constexpr double MEMORY_MARGIN_SD = 2;
+
+private:
+    std::string path;           // model file ("" = not persisted)
+    bool wcc = false;           // features of this run's configuration
+    bool noi = false;
+
+    RidgeFit<RUNTIME_FEATURES> runtime;
+    double heuristic_sum = 0;   // sums over the runtime samples, to scale predictions
+    double seconds_sum = 0;
+    double scale = 1;           // heuristic units per predicted second
+
+    RidgeFit<MEMORY_FEATURES> memory;
+
+    std::array<double, RUNTIME_FEATURES> runtime_features(int node_count, int64_t edge_count) const;
+    static std::array<double, MEMORY_FEATURES> memory_features(int node_count, int64_t edge_count);
+
+public:
+    CostModel() = default;
+
+    /**
+     * Model of the given file, loaded when it exists, for runs of method ("CM" or "WCC")
+     * with mincut_type. Throws std::runtime_error if the file cannot be parsed.
+     */
+    CostModel(const std::string& path, const std::string& method, const std::string& mincut_type);
+
+    /**
+     * The node_count + 1/density cost estimate used without a fitted model
+     */
+    static float heuristic(int node_count, int64_t edge_count);
+
+    /**
+     * Estimated cost of a cluster, in the units of heuristic()
+     */
+    float cost(int node_count, int64_t edge_count) const;
+
+    /**
+     * Predicted wall time in seconds, or a negative value without a fitted model
+     */
+    double predict_seconds(int node_count, int64_t edge_count) const;
+
+    /**
+     * Predicted peak RSS in MB, including the safety margin, or a negative value without a
+     * fitted memory model
+     */
+    double predict_memory_mb(int node_count, int64_t edge_count) const;
+
+    /**
+     * Add a measured run time or peak RSS. Predictions are unchanged until fit() is called.
+     */
+    void observe_runtime(int node_count, int64_t edge_count, double wall_seconds);
+    void observe_memory(int node_count, int64_t edge_count, double peak_memory_mb);
+
+    /**
+     * Solve for the weights from the samples so far; a part of the model with under
+     * MIN_SAMPLES samples is left unfitted
+     */
+    void fit();
+
+    /**
+     * Write the samples to the model file (atomically replacing it)
+     */
+    void save() const;
+
+    bool is_fitted() const { return runtime.fitted; }
+    bool is_memory_fitted() const { return memory.fitted; }
+    int64_t num_samples() const { return runtime.samples; }
+    int64_t num_memory_samples() const { return memory.samples; }
+    const std::string& file() const { return path; }
+
+    /**
+     * Hash of the fitted runtime prediction (0 for the heuristic), so cached partitions
+     * batched with a different model are not reused
+     */
+    uint64_t fingerprint() const;
+};
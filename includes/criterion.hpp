@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <span>
+#include <utility>
+#include <cstdint>
+
+/**
+ * Well-connectedness criterion given by --connectedness-criterion: "Clog_x(n)" or "Cn^x",
+ * where C defaults to 1. A cluster of n nodes is well connected when its edge connectivity
+ * (mincut size) exceeds threshold(n).
+ */
+class ConnectednessCriterion {
+private:
+    bool logarithmic = true;
+    double constant = 1;
+    double base_or_exponent = 10;
+
+public:
+    /**
+     * Parse a criterion string; throws std::invalid_argument on an unknown format
+     */
+    explicit ConnectednessCriterion(const std::string& expression);
+
+    double threshold(int64_t node_count) const;
+};
+
+// Outcome of the degree certificates of a cluster
+enum class Certificate {
+    None,   // undecided: the mincut has to be computed
+    Pass,   // edge connectivity provably exceeds the threshold
+    Fail,   // edge connectivity provably stays below the threshold
+};
+
+/**
+ * Decide a cluster from degree data alone, without a mincut. With λ the edge connectivity
+ * and δ the minimum degree:
+ *  - λ <= δ always, λ <= 1 for a tree (m = n - 1) and λ = 0 when m < n - 1: Fail if that
+ *    bound is below the threshold. Duplicate edges and self-loops only raise δ, so this
+ *    holds for any edge list.
+ *  - λ = δ in a simple graph with δ >= n / 2: Pass if δ exceeds the threshold. Only used when
+ *    the cluster has no duplicate edges or self-loops.
+ * A bound equal to the threshold is left undecided.
+ * members are the cluster's nodes in ascending order; edges are its intra-cluster edges.
+ */
+Certificate certify_cluster(const ConnectednessCriterion& criterion, std::span<const int32_t> members,
+                            std::span<const std::pair<int, int>> edges);
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Compressed edge list (.cedgelist): edges sorted by (source, target), delta encoded and
+ * written as LEB128 varints.
+ *
+ * Per edge, the source is stored as the delta to the previous source. The target is stored
+ * as the delta to the previous target when the source repeats, else zigzag(target - source).
+ * Clusters are dense and their node ids close together, so most edges take 2-3 bytes
+ * instead of 8.
+ *
+ * The image is a CompressedEdgesHeader followed by encoded_bytes of varints. It is also
+ * the edge part of a packed payload written with --compress-clusters; the magic tells it
+ * apart from a .bedgelist image, whose leading edge count can never take that value.
+ */
+constexpr char CEDGELIST_MAGIC[8] = {'D', 'C', 'C', 'C', 'E', 'D', 'G', '1'};
+
+struct CompressedEdgesHeader {
+    char magic[8];          // CEDGELIST_MAGIC
+    uint64_t num_edges;
+    uint64_t encoded_bytes; // varint stream length following the header
+};
+
+// True if [data, data + size) starts with a compressed edge list image
+bool is_compressed_edges(const void* data, size_t size);
+
+/**
+ * Sort edges by (source, target) and return the size of their compressed image
+ */
+uint64_t compressed_edges_length(std::vector<std::pair<int, int>>& edges);
+
+/**
+ * Sort edges by (source, target) and append their compressed image to out
+ */
+void encode_edges(std::vector<std::pair<int, int>>& edges, std::vector<uint8_t>& out);
+
+/**
+ * Decode the varint stream of a compressed image into out (num_edges pairs).
+ * Throws std::runtime_error if the stream is truncated.
+ */
+void decode_edges(const uint8_t* data, size_t length, uint64_t num_edges, std::pair<int, int>* out);
+
+/**
+ * Write edges to a standalone .cedgelist file (edges are sorted in place)
+ */
+void write_compressed_edgelist(const std::string& filepath, std::vector<std::pair<int, int>>& edges);
+
+/**
+ * Read a .cedgelist file back into sorted (source, target) pairs
+ */
+std::vector<std::pair<int, int>> read_compressed_edgelist(const std::string& filepath);
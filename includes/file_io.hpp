@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+// Write all of [data, data + length) at offset of fd, retrying short writes
+inline void pwrite_all(int fd, const char* data, size_t length, uint64_t offset, const std::string& filepath) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to write " + filepath + ": " + std::strerror(errno));
+        }
+        data += written;
+        offset += written;
+        length -= written;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+// Non-cryptographic hashing used to key cached files (FNV-1a, 64-bit)
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+inline uint64_t fnv1a64(const void* data, size_t length, uint64_t hash = FNV_OFFSET_BASIS) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t fnv1a64(const std::string& s, uint64_t hash = FNV_OFFSET_BASIS) {
+    return fnv1a64(s.data(), s.size(), hash);
+}
+
+// Fold a value into a running hash
+template <typename T>
+inline uint64_t hash_combine(uint64_t hash, const T& value) {
+    return fnv1a64(&value, sizeof(value), hash);
+}
+
+// Finalizer of splitmix64: scrambles a 64-bit word so that nearby inputs map far apart
+inline uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// 16-digit lowercase hex form of a hash, used in file names
+inline std::string hash_hex(uint64_t hash) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <mapped_file.hpp>
+#include <binary_format.hpp>
+#include <compressed_input.hpp>
+#include <parser.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/**
+ * --edgelist and --existing-clustering name a single file, a directory of shards or a glob
+ * pattern of shards (e.g. Spark "part-*" output). A directory holds every regular file in it
+ * except hidden and underscore-prefixed ones (.crc, _SUCCESS). Shards are taken in name order
+ * and read as if they were concatenated. Each shard is a text file with a header line or a
+ * binary file (.bedgelist/.bcluster), and one input may mix both. Text shards may be gzip or
+ * zstd compressed (detected from their content, see compressed_input.hpp). Empty shards are
+ * skipped.
+ *
+ * Throws std::runtime_error if nothing matches.
+ */
+std::vector<std::string> expand_input(const std::string& input);
+
+// True if input is a directory or a glob pattern rather than a single file
+bool is_sharded_input(const std::string& input);
+
+// True if input names an existing file, or at least one shard
+bool input_exists(const std::string& input);
+
+/**
+ * Range of one shard read by one thread: line-aligned text, binary records [first, last), or
+ * compressed frames [begin, end) of a text shard whose lines are completed up to stream_end
+ */
+struct InputChunk {
+    size_t shard = 0;
+    const char* begin = nullptr;        // text range (binary chunks leave it empty)
+    const char* end = nullptr;
+    char delimiter = ',';
+    Compression compression = Compression::None;
+    const char* stream_end = nullptr;   // end of the compressed shard
+    const char* path = nullptr;         // compressed shard, for error messages
+    const int32_t* pairs = nullptr;     // binary records, nullptr for text
+    uint64_t first = 0;
+    uint64_t last = 0;
+};
+
+/**
+ * Parse a chunk, calling emit(first, second) per pair in order
+ */
+template <typename Emit>
+void parse_chunk(const InputChunk& chunk, Emit&& emit) {
+    if (chunk.pairs) {
+        for (uint64_t i = chunk.first; i < chunk.last; ++i) emit(chunk.pairs[i * 2], chunk.pairs[i * 2 + 1]);
+    } else if (chunk.compression != Compression::None) {
+        parse_compressed_lines(chunk.compression, chunk.begin, chunk.end, chunk.stream_end, chunk.delimiter,
+                               chunk.path, emit);
+    } else {
+        parse_pairs(chunk.begin, chunk.end, chunk.delimiter, emit);
+    }
+}
+
+/**
+ * The mapped shards of an input, split into chunks for parallel parsing.
+ *
+ * The shards' data (after the header of text shards, the records of binary ones) is treated
+ * as one stream and divided by size into num_parts contiguous slices, so each rank can read
+ * slice `part`; a line or record belongs to the slice holding its first byte. A compressed
+ * shard counts with its compressed size and is divided at frame boundaries, a frame belonging
+ * to the slice holding its first compressed byte. Every slice is split into about num_chunks
+ * chunks, in proportion to the size of each shard in it. Chunks are in stream order. The
+ * shards stay mapped as long as the object lives.
+ *
+ * Throws std::runtime_error for a compressed binary shard or a compression this build lacks.
+ */
+class InputShards {
+private:
+    std::vector<std::string> paths;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<InputChunk> input_chunks;
+
+public:
+    /**
+     * description is used in error messages, e.g. "edgelist file"
+     */
+    InputShards(const std::string& input, BinaryKind kind, int part, int num_parts, int num_chunks,
+                const std::string& description);
+
+    const std::vector<InputChunk>& chunks() const { return input_chunks; }
+    size_t num_shards() const { return paths.size(); }
+};
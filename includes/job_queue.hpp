@@ -0,0 +1,80 @@
+#pragma once
+#include <constants.hpp>
+#include <slot_index.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Max-priority queue of clusters keyed by a cost computed once at push time.
+ *
+ * A 4-ary heap of (cost, cluster ID, slot) entries, where the slot holds the cluster and its
+ * heap position, plus a hash index from cluster ID to slot. Besides push/top/pop, a queued
+ * cluster can be erased or given a new cost in O(log n), and the queue can be iterated (in
+ * no particular order) without draining it. Equal costs pop in increasing cluster ID order.
+ */
+class JobQueue {
+private:
+    static constexpr size_t ARITY = 4;
+
+    struct HeapEntry {
+        float cost;
+        uint32_t slot;
+        int64_t cluster_id;
+    };
+
+    std::vector<HeapEntry> heap;
+    std::vector<ClusterInfo> clusters;      // by slot
+    std::vector<uint32_t> positions;        // by slot: index in heap
+    std::vector<uint32_t> free_slots;
+
+    SlotIndex index;                        // cluster_id → slot
+
+    static bool before(const HeapEntry& a, const HeapEntry& b) {
+        return a.cost > b.cost || (a.cost == b.cost && a.cluster_id < b.cluster_id);
+    }
+
+    void place(size_t position, const HeapEntry& entry) {
+        heap[position] = entry;
+        positions[entry.slot] = static_cast<uint32_t>(position);
+    }
+
+    void sift_up(size_t position);
+    void sift_down(size_t position);
+
+    // Remove the entry at a heap position and free its slot
+    void remove_at(size_t position);
+
+public:
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+    bool contains(int64_t cluster_id) const { return index.find(cluster_id) != SlotIndex::NONE; }
+
+    void reserve(size_t capacity);
+    void clear();
+
+    /**
+     * Queue a cluster with the given cost (a NaN cost is queued as 0).
+     * Throws std::runtime_error if the cluster is already queued.
+     */
+    void push(const ClusterInfo& cluster, float cost);
+
+    // Highest-cost cluster; the queue must not be empty
+    const ClusterInfo& top() const { return clusters[heap.front().slot]; }
+    float top_cost() const { return heap.front().cost; }
+
+    // Remove and return the highest-cost cluster; the queue must not be empty
+    ClusterInfo pop();
+
+    // Remove a queued cluster; false if it is not queued
+    bool erase(int64_t cluster_id);
+
+    // Change the cost of a queued cluster; false if it is not queued
+    bool update(int64_t cluster_id, float cost);
+
+    // Call fn(cluster, cost) for every queued cluster, in heap order
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const HeapEntry& entry : heap) fn(clusters[entry.slot], entry.cost);
+    }
+};
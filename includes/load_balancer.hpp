@@ -1,44 +1,20 @@
 #pragma once
 #include <logger.hpp>
 #include <constants.hpp>
+#include <partitioner.hpp>
+#include <cost_model.hpp>
+#include <job_queue.hpp>
+#include <yield_tree.hpp>
 #include <string>
 #include <vector>
-#include <queue>
 #include <set>
 #include <unordered_map>
-#include <unordered_set>
 #include <cstdint>
 
-// Records information of clusters to be assigned. Used to estimate cost and determine priority, etc.
-struct ClusterInfo {
-    int cluster_id;
-    int node_count;     // number of nodes
-    int64_t edge_count; // number of edges
-};
-
 // Per-cluster assignment payload sent to workers via DISTRIBUTE_WORK.
 struct AssignedCluster {
-    int cluster_id;
-    int is_yielded;     // 1 if this cluster is a yielded sub-cluster, 0 otherwise
-};
-
-// Tree node for tracking hierarchical yield dependencies.
-// Each node represents a cluster that may yield sub-clusters during processing.
-// A parent is considered resolved when:
-//   1. Its own work is done (work_done == true)
-//   2. All children have resolved (resolved_children == expected_yields)
-// expected_yields is set from yield_count in the WORK_DONE/WORK_ABORTED message.
-// Before WORK_DONE, YIELD_REPORTs simply register children; resolution can't happen
-// since work_done is false. After WORK_DONE, late YIELD_REPORTs register children
-// without affecting resolved_children (they were pre-counted in expected_yields).
-struct YieldNode {
-    int cluster_id;
-    int parent_id;              // -1 for original clusters (from the input file)
-    bool work_done = false;     // WORK_DONE or WORK_ABORTED received for this node
-    bool aborted = false;       // WORK_ABORTED specifically (triggers descendant sweep)
-    int expected_yields = 0;    // yield_count from WORK_DONE/WORK_ABORTED message
-    int resolved_children = 0;  // children that have completed, been swept, or been discarded
-    std::vector<int> children;  // direct child cluster_ids
+    int64_t cluster_id;
+    int64_t is_yielded;     // 1 if this cluster is a yielded sub-cluster, 0 otherwise
 };
 
 class LoadBalancer {
@@ -51,72 +27,138 @@ private:
     float min_batch_cost;
     int drop_cluster_under;
     bool auto_accept_clique;
+    PartitionOptions partition_options;
 
-    // Comparator for job_queue: highest estimated cost on top (max-heap).
-    struct CostCompare {
-        LoadBalancer* lb;
-        bool operator()(const ClusterInfo& a, const ClusterInfo& b) const {
-            return lb->get_cost(a) < lb->get_cost(b);
-        }
+    // Cost estimates come from the model as loaded; runtimes measured in this run are added
+    // to it and saved at the end, so they shape the priorities and batches of later runs
+    CostModel cost_model;
+
+    // Measured run of a completed cluster, to report the accuracy of the estimates
+    struct RuntimeSample {
+        float heuristic;            // heuristic cost
+        double predicted_seconds;   // model prediction (< 0 without a fitted model)
+        double wall_seconds;
+    };
+    std::vector<RuntimeSample> runtime_samples;
+    int memory_predictions = 0;         // completed clusters with a predicted peak RSS
+    int memory_underpredictions = 0;    // ... that used more than predicted
+
+    // Memory-aware placement. Workers sharing a node share its budget; a cluster is only
+    // assigned to a worker whose node has room for its predicted peak RSS on top of the
+    // clusters already running there (a worker runs its batch one cluster at a time).
+    struct NodeMemory {
+        int64_t budget_mb = 0;
+        std::vector<int> workers;
     };
+    std::unordered_map<std::string, NodeMemory> nodes;          // by node name (see WorkerInfo)
+    std::unordered_map<int, std::string> worker_node;           // worker rank → node name
+    std::unordered_map<int, std::unordered_map<int64_t, double>> worker_memory;    // worker rank → cluster → predicted MB
+
+    // Clusters assigned to each worker and not yet reported done. With --prefetch-depth a
+    // worker holds batches beyond the one it is running, so this can span several batches.
+    std::unordered_map<int, int> worker_outstanding;            // worker rank → clusters
+
+    // OOM-killed clusters are requeued to run where the node has at least this much room
+    std::unordered_map<int64_t, double> oom_required_mb;        // cluster → MB
+    std::unordered_map<int64_t, int> oom_retries;               // cluster → retries so far
 
-    // Job queue: max-heap by estimated cost. Clusters are popped highest-cost-first.
-    std::priority_queue<ClusterInfo, std::vector<ClusterInfo>, CostCompare> job_queue;
-    int job_queue_active = 0;                                   // non-dropped clusters in job_queue
-    std::unordered_set<int> dropped_clusters;                   // lazy deletion set for aborted descendants
+    // Job queue: highest estimated cost on top, each cluster's cost computed once when queued.
+    // Unprocessed children of aborted clusters are erased from it directly.
+    JobQueue job_queue;
 
-    std::unordered_map<int, ClusterInfo> aborted_clusters;      // Aborted clusters - note that these only include root-level clusters
-    std::unordered_map<int, ClusterInfo> in_flight_clusters;    // Clusters that are assigned but not yet completed - map for quicker lookup
+    std::unordered_map<int64_t, ClusterInfo> aborted_clusters;  // Aborted clusters - note that these only include root-level clusters
+    std::unordered_map<int64_t, ClusterInfo> in_flight_clusters;    // Clusters that are assigned but not yet completed - map for quicker lookup
     std::unordered_map<int, WorkerReport> worker_reports;       // Latest cumulative report per worker rank
 
     // Tree-based yield ancestry tracking.
     // Each entry represents a cluster involved in yielding (as parent or child).
     // Roots (parent_id == -1) stay in in_flight_clusters until fully resolved.
     // Children are tracked only in yield_tree (removed from in_flight on creation).
-    std::unordered_map<int, YieldNode> yield_tree;
+    YieldTree yield_tree;
 
     // Persistent mapping: yielded cluster_id → root cluster_id.
     // Unlike yield_tree, this is never erased during resolution, so the LB
     // can determine ownership at aggregation time.
-    std::unordered_map<int, int> yield_to_root;
+    std::unordered_map<int64_t, int64_t> yield_to_root;
+
+    // Yield ID service: the next unassigned ID of the yield range and, per worker, the IDs
+    // granted to it and the IDs it had used as of its last WORK_REQUEST. The difference is
+    // what the worker holds plus the blocks still on their way to it (with prefetched batches).
+    int64_t next_yield_id = YIELD_ID_BASE;
+    std::unordered_map<int, int64_t> worker_yield_ids_granted;
+    std::unordered_map<int, int64_t> worker_yield_ids_used;
 
     /**
      * Shared logic for WORK_DONE and WORK_ABORTED: handles yield tree tracking,
      * removes from in_flight when appropriate, and checks deferred termination.
      */
-    bool handle_cluster_completion(int cluster_id, std::vector<int>& pending_work_requests, int yield_count, bool aborted);
+    bool handle_cluster_completion(int64_t cluster_id, std::vector<int>& pending_work_requests, int yield_count, bool aborted);
 
     /**
-     * Check if a yield node is resolved (work_done, all yields received, all children resolved).
-     * If resolved, erase the subtree and cascade resolution to the parent.
+     * Log the measured run time of a completed cluster against its estimate, and add it to
+     * the cost model (clusters that yielded sub-clusters are left out)
+     */
+    void record_runtime(const ClusterInfo& cluster_info, const WorkDone& done);
+
+    /**
+     * Memory a cluster is expected to need: its predicted peak RSS, or more after an OOM kill
+     * (0 when unknown)
+     */
+    double memory_need(const ClusterInfo& cluster_info) const;
+
+    /**
+     * Memory left on worker_rank's node besides the worker's own clusters (infinite if the
+     * node is unknown), and whether no other worker there has clusters running
+     */
+    double memory_headroom(int worker_rank, bool& node_idle) const;
+
+    /**
+     * Requeue a cluster killed by the OOM killer, to be run on a node with more room.
+     * Returns false if it should be aborted instead: it yielded sub-clusters, ran out of
+     * retries, or needs more memory than any node has.
      */
-    void try_resolve(int cluster_id, std::vector<int>& pending_work_requests);
+    bool retry_after_oom(int64_t cluster_id, const WorkDone& done);
 
     /**
-     * Recursively remove a node and all its descendants from yield_tree.
+     * Assign work to the deferred workers the queue now has clusters for, idle workers
+     * before workers asking ahead (prefetching)
      */
-    void erase_subtree(int cluster_id);
+    void serve_pending_requests(std::vector<int>& pending_work_requests);
 
     /**
-     * Walk the parent chain to check if any ancestor has been aborted.
+     * Log how well the heuristic and the model predicted this run's cluster runtimes, then
+     * save the updated cost model
+     */
+    void finish_cost_model();
+
+    /**
+     * Check if a yield node is resolved (work_done, all yields received, all children resolved).
+     * If resolved, erase the subtree and cascade resolution up through its ancestors.
      */
-    bool is_ancestor_aborted(int cluster_id);
+    void try_resolve(int64_t cluster_id, std::vector<int>& pending_work_requests);
 
     /**
-     * For an aborted node: mark unprocessed children as dropped (lazy deletion)
-     * so they are skipped when popped from job_queue.
+     * For an aborted node: erase its unprocessed children from job_queue.
      */
-    void sweep_aborted_descendants(int cluster_id);
+    void sweep_aborted_descendants(uint32_t slot);
 
     /**
-     * Pop clusters from job_queue (skipping dropped entries), batch up to
-     * min_batch_cost, assign to worker_rank via MPI. Returns true if work
-     * was assigned, false if queue was effectively empty.
+     * Take the next block of yield IDs for worker_rank; returns its first ID
+     */
+    int64_t grant_yield_ids(int worker_rank);
+
+    /**
+     * Pop clusters from job_queue, batch up to
+     * min_batch_cost, assign to worker_rank via MPI. Clusters that do not fit in the
+     * memory left on the worker's node are passed over and stay queued. Returns true if
+     * work was assigned, false if queue was effectively empty or nothing fit. A worker
+     * running low on yield IDs gets a new block with the assignment.
      */
     bool assign_batch(int worker_rank);
 
     /**
-     * Partition clustering into separate cluster files
+     * Partition clustering into a cluster pack (see Partitioner), or restore it from the
+     * partition cache when one is configured and holds a matching entry
      * Returns vector of created cluster IDs
      */
     std::vector<ClusterInfo> partition_clustering(const std::string& edgelist,
@@ -131,15 +173,14 @@ private:
     std::vector<ClusterInfo> load_partitioned_clusters(const std::string& partitioned_dir);
 
     /**
-     * Initialize job queue from created clusters
+     * Queue a cluster at its estimated cost
      */
-    void initialize_job_queue(const std::vector<ClusterInfo>& created_clusters);
+    void enqueue(const ClusterInfo& cluster_info);
 
     /**
-     * Bypass a cluster - write it directly to output without processing
-     * Used for clusters that don't need CM processing (e.g., cliques)
+     * Initialize job queue from created clusters
      */
-    void bypass_cluster(const ClusterInfo& cluster_info, const std::set<int>& nodes);
+    void initialize_job_queue(const std::vector<ClusterInfo>& created_clusters);
 
 public:
     void save_checkpoint(); // save checkpoint - usually due to SIGTERM
@@ -162,7 +203,9 @@ public:
                 bool partition_only = false,
                 float min_batch_cost = 200,
                 int drop_cluster_under = -1,
-                bool auto_accept_clique = false);
+                bool auto_accept_clique = false,
+                const PartitionOptions& partition_options = PartitionOptions(),
+                const CostModel& cost_model = CostModel());
 
     /**
      * Runtime phase: Distribute jobs to workers
@@ -171,12 +214,12 @@ public:
     void run();
 
     /**
-     * Estimate the cost of processing a cluster
+     * Estimate the cost of processing a cluster (see CostModel::cost)
      */
-    float get_cost(int node_count, int64_t edge_count);
+    float get_cost(int node_count, int64_t edge_count) const;
 
     /**
      * Estimate the cost of processing a cluster given cluster_info
      */
-    float get_cost(const ClusterInfo& cluster_info);
+    float get_cost(const ClusterInfo& cluster_info) const;
 };
\ No newline at end of file
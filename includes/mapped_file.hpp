@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Read-only, private memory mapping of an input file.
+// The mapping is released (and the descriptor closed) when the object goes out of scope.
+class MappedFile {
+private:
+    int fd = -1;
+    void* mapped = nullptr;
+    size_t length = 0;
+
+public:
+    // description is used in error messages, e.g. "edgelist file".
+    // populate = false maps lazily, for callers that only read a slice of the file.
+    MappedFile(const std::string& filepath, const std::string& description = "file", bool populate = true) {
+        fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open " + description + ": " + filepath);
+        }
+        struct stat st;
+        fstat(fd, &st);
+        length = static_cast<size_t>(st.st_size);
+        if (length == 0) return;    // mmap rejects empty mappings; expose an empty range instead
+
+        mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+        if (mapped == MAP_FAILED) {
+            mapped = nullptr;
+            close(fd);
+            throw std::runtime_error("mmap failed for " + description + ": " + filepath);
+        }
+        madvise(mapped, length, populate ? (MADV_SEQUENTIAL | MADV_WILLNEED) : MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile() {
+        if (mapped) munmap(mapped, length);
+        if (fd >= 0) close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(mapped); }
+    const char* end() const { return data() + length; }
+    size_t size() const { return length; }
+};
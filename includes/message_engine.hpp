@@ -0,0 +1,89 @@
+#pragma once
+#include <mpi.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+/**
+ * Receives fixed-size messages from any source on a set of tags through receives posted
+ * ahead of time, several per tag, so a message lands in place without a probe and a
+ * matching receive of its own.
+ *
+ * poll() waits for at least one message, then returns all that have arrived: grouped by tag
+ * in the order the tags were added, and in matching order within a tag (for each sender, the
+ * order it sent them). While nothing arrives it spins on MPI_Testsome for a while, then
+ * sleeps for growing intervals so an idle loop does not hold a core.
+ */
+class MessageEngine {
+public:
+    struct Message {
+        int source;
+        int tag;
+        const void* data;       // valid until the next poll()
+    };
+
+private:
+    struct Tag {
+        int tag;
+        MPI_Datatype type;
+        int count;
+        int depth;
+        size_t bytes;
+        std::deque<uint32_t> posted;    // slots with a posted receive, in posting order
+    };
+
+    struct Slot {
+        uint32_t tag_index;
+        size_t offset;          // into buffer
+        bool ready = false;     // received, not yet handed out
+        int source = -1;
+    };
+
+    MPI_Comm comm;
+    std::vector<Tag> tags;
+    std::vector<Slot> slots;
+    std::vector<MPI_Request> requests;      // by slot
+    std::vector<unsigned char> buffer;
+    std::vector<uint32_t> handed_out;       // slots of the last poll(), reposted by the next
+
+    std::vector<int> completed;             // MPI_Testsome scratch
+    std::vector<MPI_Status> statuses;
+
+    void post(uint32_t slot);
+
+    // Move the received messages at the front of each tag's posting order to messages
+    void collect(std::vector<Message>& messages);
+
+public:
+    explicit MessageEngine(MPI_Comm comm) : comm(comm) {}
+    ~MessageEngine() { cancel(); }
+
+    MessageEngine(const MessageEngine&) = delete;
+    MessageEngine& operator=(const MessageEngine&) = delete;
+
+    /**
+     * Receive messages of count elements of type on tag, with depth receives posted at a
+     * time. Tags are added before start().
+     */
+    void add_tag(int tag, MPI_Datatype type, int count, int depth);
+
+    /**
+     * Post the receives of every tag
+     */
+    void start();
+
+    /**
+     * Replace messages with the next batch, waiting for at least one message. on_idle is
+     * called once when the wait turns from spinning to sleeping. Returns with no messages
+     * only if nothing was started.
+     */
+    void poll(std::vector<Message>& messages, const std::function<void()>& on_idle = {});
+
+    /**
+     * Cancel the receives still posted; returns the number of messages that had arrived
+     * on them but were never handed out by poll()
+     */
+    int cancel();
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+// Run task(i) for every i in [0, num_tasks), one thread per task.
+// Returns the summed busy time of all tasks, so callers can report the effective speedup.
+// An exception thrown by a task is rethrown on the calling thread once all tasks finished.
+inline double run_parallel(size_t num_tasks, const std::function<void(size_t)>& task) {
+    std::vector<double> busy(num_tasks, 0.0);
+    std::vector<std::exception_ptr> errors(num_tasks);
+    auto timed_task = [&](size_t i) {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            task(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+        busy[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    if (num_tasks == 1) {
+        timed_task(0);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(num_tasks);
+        for (size_t i = 0; i < num_tasks; ++i) threads.emplace_back(timed_task, i);
+        for (auto& t : threads) t.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    double total = 0;
+    for (double b : busy) total += b;
+    return total;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Parsing of "<int><delimiter><int>" text lines (edge lists, clusterings and cluster outputs).
+ *
+ * The vectorized kernels scan the input in 64-byte windows. Each window is classified into
+ * newline, delimiter and digit bitmasks with AVX2 or SSE4.2, complete lines are located with
+ * bit scans, and their digit runs are converted eight digits at a time with SWAR arithmetic.
+ * Lines that are not plain "[-]digits<delimiter>[-]digits" (or do not fit in a window) fall
+ * back to the scalar loop, so all kernels produce the same values. The kernel is chosen
+ * once at runtime from the CPU features.
+ */
+enum class ParseKernel { Scalar, SSE42, AVX2 };
+
+// Fastest kernel supported by this CPU
+ParseKernel best_parse_kernel();
+
+bool parse_kernel_supported(ParseKernel kernel);
+
+const char* parse_kernel_name(ParseKernel kernel);
+
+// Pairs parsed per parse_pair_batch() call by parse_pairs()
+constexpr size_t PARSE_BATCH_PAIRS = 1024;
+
+/**
+ * Parse lines starting at data into out (two ints per line) until end or max_pairs lines.
+ * Advances data past the parsed lines and returns the number of pairs. Memory in
+ * [begin, end) may be read around the parsed lines; begin must not be after data.
+ */
+size_t parse_pair_batch(ParseKernel kernel, const char* begin, const char*& data, const char* end,
+                        char delimiter, int32_t* out, size_t max_pairs);
+
+/**
+ * Parse all lines in [data, end), calling emit(first, second) per line in order
+ */
+template <typename Emit>
+void parse_pairs(const char* data, const char* end, char delimiter, Emit&& emit,
+                 ParseKernel kernel = best_parse_kernel()) {
+    int32_t pairs[2 * PARSE_BATCH_PAIRS];
+    const char* begin = data;
+    while (data < end) {
+        size_t num_pairs = parse_pair_batch(kernel, begin, data, end, delimiter, pairs, PARSE_BATCH_PAIRS);
+        for (size_t i = 0; i < num_pairs; ++i) {
+            emit(pairs[i * 2], pairs[i * 2 + 1]);
+        }
+    }
+}
+
+/**
+ * Detect the delimiter (',', '\t' or ' ') from the first line of a mapped text file
+ */
+char detect_delimiter(const char* data, const char* end, const std::string& filepath);
+
+// Line-aligned byte range of a mapped text file
+using TextChunk = std::pair<const char*, const char*>;
+
+/**
+ * Skip the header line of a text file
+ */
+const char* skip_header(const char* data, const char* end);
+
+/**
+ * Split [begin, end) into at most num_chunks ranges that each end on a line boundary
+ */
+std::vector<TextChunk> split_lines(const char* begin, const char* end, int num_chunks);
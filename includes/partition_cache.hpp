@@ -0,0 +1,67 @@
+#pragma once
+#include <logger.hpp>
+#include <partitioner.hpp>
+#include <string>
+
+constexpr char PARTITION_KEY_FILE[] = "partition.key";
+
+/**
+ * Phase 1 results shared across runs, under --partition-cache-dir:
+ *
+ *   partitions/<key>/               clusters.pack, clusters.idx, summary.csv, bypass.out and
+ *                                   peeled.csv of one partitioning, keyed by partition_key()
+ *   edgelists/<fingerprint>.bedgelist  pre-parsed binary copy of a text edge list
+ *
+ * Files are keyed by a fingerprint of the inputs (size, mtime and sampled content) rather
+ * than by path, so a moved input still hits and a rewritten one misses. Entries
+ * are written under a temporary name and renamed into place, so concurrent runs sharing a
+ * cache never see a partial entry.
+ */
+class PartitionCache {
+private:
+    Logger& logger;
+    std::string cache_dir;
+
+public:
+    PartitionCache(Logger& logger, const std::string& cache_dir);
+
+    /**
+     * Fingerprint of a file: its size, mtime and a hash of sampled 4 KiB blocks
+     */
+    static uint64_t file_fingerprint(const std::string& path);
+
+    /**
+     * Fingerprint of an --edgelist/--existing-clustering input: file_fingerprint() of a single
+     * file, or the names and fingerprints of all shards of a directory or glob
+     */
+    static uint64_t input_fingerprint(const std::string& input);
+
+    /**
+     * Key of a partitioning: the input fingerprints and every option that changes its output
+     */
+    static std::string partition_key(const std::string& edgelist, const std::string& cluster_file,
+                                     float min_batch_cost, int drop_cluster_under, bool auto_accept_clique,
+                                     const PartitionOptions& options);
+
+    /**
+     * True if the cache in cache_dir holds a partitioning with this key
+     */
+    static bool contains(const std::string& cache_dir, const std::string& key);
+
+    /**
+     * Link (or copy) a cached partitioning into clusters_dir and its bypass and peel output
+     * into <work_dir>/output. Returns false on a miss.
+     */
+    bool restore(const std::string& key, const std::string& clusters_dir, const std::string& work_dir);
+
+    /**
+     * Add the partitioning in clusters_dir (and its bypass and peel output) to the cache
+     */
+    void store(const std::string& key, const std::string& clusters_dir, const std::string& work_dir);
+
+    /**
+     * Path of the cached binary copy of edgelist, converting it with partitioner on a miss.
+     * Binary edge lists and sharded inputs are returned unchanged.
+     */
+    std::string binary_edgelist(const std::string& edgelist, Partitioner& partitioner);
+};
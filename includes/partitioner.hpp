@@ -0,0 +1,272 @@
+#pragma once
+#include <logger.hpp>
+#include <constants.hpp>
+#include <cluster_index.hpp>
+#include <cluster_pack.hpp>
+#include <criterion.hpp>
+#include <string>
+#include <vector>
+#include <span>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <cstdint>
+
+#include <mpi.h>
+
+// Nodes removed by --peel, under <work_dir>/output ("node_id,cluster_id" lines)
+constexpr char PEELED_FILE[] = "peeled.csv";
+
+// Phase 1 options that only affect how the input is partitioned (not how jobs are scheduled).
+struct PartitionOptions {
+    int num_threads = 1;            // threads used to parse and bucket the inputs (0 = all hardware threads)
+    int64_t memory_limit_mb = 0;    // spill intra-cluster edges to disk beyond this budget (0 = keep in memory)
+    std::string cache_dir;          // partition cache shared across runs (empty = disabled)
+    bool compress_clusters = false; // store batch edges delta+varint encoded (sorted, see edge_codec.hpp)
+    bool canonicalize_edges = false;    // dedupe intra-cluster edges and drop self-loops (see canonicalize_edges)
+    bool split_components = false;  // partition each cluster's connected components separately
+    std::string connectedness_criterion;    // criterion used by certificates and peel (see criterion.hpp)
+    bool certificates = false;      // settle clusters by degree certificates
+    bool peel = false;              // peel nodes that CM's prune mode would cut off (see peel_clusters)
+    uint64_t cost_model = 0;        // CostModel::fingerprint() of the batching cost estimates (0 = heuristic)
+};
+
+/**
+ * Edges grouped by a dense key in CSR form: group g holds edges[offsets[g], offsets[g + 1]),
+ * in the order they were read.
+ */
+struct EdgeGroups {
+    std::vector<int64_t> offsets;
+    std::vector<std::pair<int, int>> edges;
+
+    std::span<const std::pair<int, int>> group(size_t g) const {
+        return {edges.data() + offsets[g], static_cast<size_t>(offsets[g + 1] - offsets[g])};
+    }
+    int64_t group_size(size_t g) const { return offsets[g + 1] - offsets[g]; }
+};
+
+/**
+ * Phase 1: splits the input clustering into batches written to a packed cluster archive
+ * (clusters.pack + clusters.idx, see cluster_pack.hpp).
+ * The clustering and edge-list files (or their shards, see input_shards.hpp) are mmapped,
+ * split into line-aligned chunks and parsed on num_threads threads. Node lookups go through a dense ClusterIndex; each thread keeps the
+ * intra-cluster edges of its chunk, which are then grouped per cluster by a counting sort
+ * that preserves file order.
+ *
+ * Partitioning runs either on rank 0 alone (partition) or collectively on every rank
+ * (partition_distributed), where each rank reads a slice of the edge list and owns a
+ * subset of the clusters.
+ */
+class Partitioner {
+private:
+    Logger& logger;
+    std::string work_dir;
+    float min_batch_cost;
+    int drop_cluster_under;
+    bool auto_accept_clique;
+    PartitionOptions options;
+    std::function<float(const ClusterInfo&)> cost_fn;   // estimated cost used for batching
+    int num_threads;
+
+    // Clustering loaded by load_clustering()
+    ClusterIndex index;
+
+    // Intra-cluster edges grouped by dense cluster index
+    EdgeGroups cluster_edges;
+
+    // Bypass output ("node_id,cluster_id" lines) not yet written to bypass.out
+    std::string pending_bypass;
+
+    // Peeled nodes ("node_id,cluster_id" lines) not yet written to peeled.csv
+    std::string pending_peeled;
+
+    // options.connectedness_criterion, parsed when certificates or peel are enabled
+    std::optional<ConnectednessCriterion> criterion;
+
+    // Degree certificates by dense cluster index
+    std::vector<Certificate> certificates;
+
+    // Pack the batches are appended to, opened by open_pack()
+    std::unique_ptr<ClusterPackWriter> pack;
+
+    // Clusters written together as one pack payload, indexed by the head cluster
+    struct BatchPlan {
+        ClusterInfo head{};             // summary.csv entry of the batch
+        std::vector<int32_t> clusters;  // dense cluster indices, in write order
+    };
+
+    /**
+     * Read the clustering file into the cluster index
+     */
+    void load_clustering(const std::string& cluster_file);
+
+    /**
+     * Parse slice `part` of `num_parts` line-aligned slices of the edge list (all its shards
+     * as one stream) on num_threads threads. init(num_chunks) is called once the slice is
+     * split into chunks, then visit(chunk, source, target, cluster) for every intra-cluster
+     * edge. Chunks are contiguous in edge-list order and each is visited by a single thread,
+     * in order.
+     */
+    template <typename Init, typename Visit>
+    void scan_edges(const std::string& edgelist, int part, int num_parts, Init&& init, Visit&& visit);
+
+    /**
+     * Read slice `part` of `num_parts` line-aligned slices of the edge list.
+     * Returns its intra-cluster edges, one vector per parsed chunk, in edge-list order.
+     */
+    std::vector<std::vector<std::pair<int, int>>> read_edges(const std::string& edgelist,
+                                                             int part, int num_parts);
+
+    /**
+     * Send each group of outgoing (keyed by destination rank) to its owner with MPI_Alltoallv.
+     * Returns the received (source, target) pairs, ordered by source rank.
+     */
+    std::vector<std::pair<int, int>> exchange_edges(const EdgeGroups& outgoing, MPI_Comm comm);
+
+    /**
+     * Batch the clusters selected by owns(cluster_id) given their intra-cluster edge counts,
+     * packing them toward min_batch_cost with pack_batches (see batch_packer.hpp).
+     * Cliques and clusters certified to pass are bypassed here; clusters without edges or
+     * under drop_cluster_under are dropped. Clusters certified to fail are only reported.
+     */
+    std::vector<BatchPlan> plan_batches(const std::vector<int64_t>& edge_counts,
+                                        const std::function<bool(int)>& owns);
+
+    /**
+     * Canonicalize the edges of every cluster selected by owns(cluster_id): each edge becomes
+     * (min, max), each cluster's edges are sorted and deduplicated and self-loops are dropped.
+     * Edge counts, and with them costs and clique detection, then count distinct edges.
+     */
+    void canonicalize_edges(const std::function<bool(int)>& owns);
+
+    /**
+     * Replace every disconnected cluster selected by owns(cluster_id) with its connected
+     * components, rebuilding index and cluster_edges. The component holding the smallest node
+     * keeps the cluster id; the others get new ids above the largest cluster id, chosen so
+     * that owner_rank(id, num_ranks) == rank. Singleton components and components under
+     * drop_cluster_under are dropped.
+     */
+    void split_components(const std::function<bool(int)>& owns, int rank, int num_ranks);
+
+    /**
+     * Peel every cluster selected by owns(cluster_id) the way CM's prune mode does: while the
+     * lowest in-cluster degree is at most the criterion threshold for the current cluster
+     * size, that node is a violating cut and is removed. Only the surviving core is kept;
+     * peeled nodes are recorded in <work_dir>/output/peeled.csv.
+     */
+    void peel_clusters(const std::function<bool(int)>& owns);
+
+    /**
+     * Replace the index with (node_id, cluster_id) entries and keep the edges of cluster_edges
+     * whose endpoints are still in one cluster
+     */
+    void rebuild_clusters(std::vector<std::pair<int, int>>& entries);
+
+    /**
+     * Batch the clusters selected by owns(cluster_id) using the edge counts of cluster_edges,
+     * canonicalizing their edges, splitting them into components, peeling and certifying them
+     * first when enabled
+     */
+    std::vector<BatchPlan> plan_grouped_batches(const std::function<bool(int)>& owns,
+                                                int rank = 0, int num_ranks = 1);
+
+    /**
+     * Open <output_dir>/clusters.pack for appending at base_offset
+     */
+    void open_pack(const std::string& output_dir, uint64_t base_offset, bool truncate);
+
+    /**
+     * Edge encoding of pack payloads selected by options
+     */
+    PackEdgeFormat pack_edge_format() const;
+
+    /**
+     * Size of the pack payload of a batch of cluster_edges. With compress_clusters this
+     * encodes the batch once to measure it.
+     */
+    uint64_t payload_length(const BatchPlan& batch) const;
+
+    /**
+     * Append one batch to the pack; edges_of(cluster) gives a cluster's edges
+     */
+    void write_batch(const BatchPlan& batch,
+                     const std::function<std::span<const std::pair<int, int>>(int32_t)>& edges_of);
+
+    /**
+     * Append the planned batches of cluster_edges to the pack
+     */
+    void write_batches(const std::vector<BatchPlan>& plans);
+
+    /**
+     * Close the pack, write clusters.idx and summary.csv and return the created batches
+     */
+    std::vector<ClusterInfo> finish_pack(const std::string& output_dir, const std::vector<PackIndexEntry>& entries);
+
+    /**
+     * partition() within options.memory_limit_mb: a first pass counts the intra-cluster edges
+     * of every cluster and plans the batches, a second pass spills the edges to one file per
+     * chunk, in blocks per bucket (a bucket being consecutive batches that fit the budget), and
+     * each bucket is then read back and appended to the open pack. Write buffers come out of a
+     * fixed share of the budget; throws std::runtime_error if the budget cannot hold the
+     * smallest buffers, or if the edges must spill while a per-cluster pass (canonicalize,
+     * split, peel, certificates) is enabled. Output is identical to the in-memory path.
+     */
+    void partition_out_of_core(const std::string& edgelist);
+
+    /**
+     * Write summary.csv for quicker load
+     */
+    void write_summary(const std::string& output_dir, const std::vector<ClusterInfo>& created_clusters);
+
+    /**
+     * Bypass a cluster - write it directly to output without processing
+     * Used for clusters that don't need CM processing (e.g., cliques)
+     */
+    void bypass_cluster(const ClusterInfo& cluster_info, std::span<const int32_t> nodes);
+
+    /**
+     * Append "node_id,cluster_id" lines to <work_dir>/output/<filename>
+     */
+    void flush_output(const std::string& filename, const std::string& output);
+
+    /**
+     * Concatenate every rank's pending output on rank 0 (in rank order) and clear it
+     */
+    std::string gather_output(std::string& pending, MPI_Comm comm);
+
+public:
+    Partitioner(Logger& logger,
+                const std::string& work_dir,
+                float min_batch_cost,
+                int drop_cluster_under,
+                bool auto_accept_clique,
+                const PartitionOptions& options,
+                std::function<float(const ClusterInfo&)> cost_fn);
+
+    /**
+     * Partition clustering into output_dir/clusters.pack, then write clusters.idx and summary.csv
+     * Returns the ClusterInfo of every created batch (keyed by its head cluster)
+     */
+    std::vector<ClusterInfo> partition(const std::string& edgelist,
+                                       const std::string& cluster_file,
+                                       const std::string& output_dir);
+
+    /**
+     * Write a text edge list as a .bedgelist at output, parsing on num_threads threads.
+     * Returns the number of edges written.
+     */
+    int64_t convert_edgelist(const std::string& edgelist, const std::string& output);
+
+    /**
+     * Collective version of partition(); must be called by every rank of comm.
+     * Each rank reads a byte range of the edge list and routes intra-cluster edges to the
+     * rank owning their cluster (cluster_id mod size). Ranks write their batches to disjoint
+     * ranges of one shared pack, placed by an exclusive scan of their payload sizes.
+     * Rank 0 gathers the index entries and bypass output and writes clusters.idx and summary.csv.
+     * Returns the created batches on rank 0 and an empty vector elsewhere.
+     */
+    std::vector<ClusterInfo> partition_distributed(const std::string& edgelist,
+                                                   const std::string& cluster_file,
+                                                   const std::string& output_dir,
+                                                   MPI_Comm comm);
+};
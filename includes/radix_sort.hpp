@@ -0,0 +1,51 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Key of an edge that orders like (source, target) with signed node ids
+inline uint64_t edge_key(int source, int target) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(source) ^ 0x80000000u) << 32) |
+           (static_cast<uint32_t>(target) ^ 0x80000000u);
+}
+
+inline std::pair<int, int> edge_of_key(uint64_t key) {
+    return {static_cast<int>(static_cast<uint32_t>(key >> 32) ^ 0x80000000u),
+            static_cast<int>(static_cast<uint32_t>(key) ^ 0x80000000u)};
+}
+
+/**
+ * Sort keys ascending with an LSD radix sort on 8-bit digits; scratch is resized to keys.size().
+ * Digits that are equal in every key are skipped, so keys sharing their high bits (e.g. the
+ * edges of one cluster of nearby node ids) take fewer passes. Small inputs use std::sort.
+ */
+inline void radix_sort(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch) {
+    if (keys.size() < 256) {
+        std::sort(keys.begin(), keys.end());
+        return;
+    }
+    uint64_t all_or = 0, all_and = ~uint64_t{0};
+    for (uint64_t key : keys) {
+        all_or |= key;
+        all_and &= key;
+    }
+    uint64_t varying = all_or ^ all_and;
+
+    scratch.resize(keys.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xff) == 0) continue;
+        std::array<size_t, 256> counts{};
+        for (uint64_t key : keys) ++counts[(key >> shift) & 0xff];
+        size_t sum = 0;
+        for (size_t& count : counts) {
+            size_t c = count;
+            count = sum;
+            sum += c;
+        }
+        for (uint64_t key : keys) scratch[counts[(key >> shift) & 0xff]++] = key;
+        keys.swap(scratch);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <hash.hpp>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Map from cluster ID to a slot in a caller's node array, with open addressing, linear
+ * probing and backward-shift deletion. Replaces std::unordered_map<int64_t, uint32_t> in the
+ * load balancer's hot paths, where a heap-allocated node per entry costs more than the
+ * structure it indexes. Cluster IDs must not be INT64_MIN.
+ */
+class SlotIndex {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+private:
+    struct Entry {
+        int64_t cluster_id;
+        uint32_t slot;
+    };
+    static constexpr int64_t EMPTY_KEY = std::numeric_limits<int64_t>::min();
+
+    std::vector<Entry> entries;
+    size_t mask = 0;
+    size_t count = 0;
+
+    size_t home(int64_t cluster_id) const { return mix64(static_cast<uint64_t>(cluster_id)) & mask; }
+    void rehash(size_t capacity);
+
+public:
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    // Slot of a cluster, or NONE
+    uint32_t find(int64_t cluster_id) const;
+
+    // Add a cluster; false (and no change) if it is already present
+    bool insert(int64_t cluster_id, uint32_t slot);
+
+    // Remove a cluster; false if it is not present
+    bool erase(int64_t cluster_id);
+
+    // Size the table for count clusters without rehashing
+    void reserve(size_t capacity);
+    void clear();
+};
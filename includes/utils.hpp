@@ -21,20 +21,6 @@ inline bool is_binary_cluster(const std::string& filepath) {
     return has_suffix(filepath, ".bcluster");
 }
 
-inline char get_delimiter(std::string filepath) {
-    std::ifstream clustering(filepath);
-    std::string line;
-    getline(clustering, line);
-    if (line.find(',') != std::string::npos) {
-        return ',';
-    } else if (line.find('\t') != std::string::npos) {
-        return '\t';
-    } else if (line.find(' ') != std::string::npos) {
-        return ' ';
-    }
-    throw std::invalid_argument("Could not detect filetype for " + filepath);
-}
-
 inline void write_binary_edgelist(const std::string& filepath,
                                   const std::vector<std::pair<int, int>>& edges) {
     std::ofstream out(filepath, std::ios::binary);
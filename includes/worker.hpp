@@ -1,8 +1,23 @@
 #pragma once
 #include <logger.hpp>
 #include <constants.hpp>
+#include <cluster_pack.hpp>
 #include <string>
 #include <vector>
+#include <memory>
+#include <deque>
+#include <utility>
+#include <cstdint>
+
+// Outcome of processing one cluster
+struct ClusterResult {
+    bool success = false;
+    int yield_count = 0;        // sub-clusters directly yielded by the child process
+    double wall_seconds = 0;    // run time of the child process
+    double cpu_seconds = 0;     // user + system CPU time of the child process
+    int peak_memory_mb = 0;     // peak RSS of the child process
+    bool oom_killed = false;    // killed by SIGKILL without timing out
+};
 
 class Worker {
 private:
@@ -20,16 +35,46 @@ private:
     int report_interval;         // send report every N requests, -1 = disabled
     int num_processors;          // number of processors per worker for CM/MincutOnly
     int yield_node_threshold;    // min node count for yielding sub-clusters (0 = disabled)
-    int yield_id_counter = 0;    // auto-incrementing global ID for yielded sub-clusters
+    int64_t node_memory_mb;      // memory budget declared for this worker's node (0 = detect)
+    int prefetch_depth;          // batches requested ahead of the one running (0 = none)
 
     WorkerReport report = {0, 0, 0};  // cumulative stats sent to LB
 
+    // Blocks of yield IDs granted by the load balancer, as [first, end) ranges in order of use.
+    // The main loop adds blocks between clusters; the yield monitor takes IDs while one runs.
+    std::deque<std::pair<int64_t, int64_t>> yield_id_blocks;
+    int64_t used_yield_ids = 0;     // IDs taken so far, reported with every WORK_REQUEST
+
+    // Packed cluster archive of clusters_dir, opened on first use (null for per-file clusters)
+    std::unique_ptr<ClusterPackReader> pack;
+    bool pack_checked = false;
+    std::string scratch_dir;     // node-local dir payloads are extracted to for the child
+
+    /**
+     * Resolve the edgelist and clustering files of a cluster. Packed clusters are extracted
+     * to scratch_dir (staged = true) since CM/MincutOnly read from file paths.
+     */
+    void locate_cluster_files(int64_t cluster_id, bool is_yielded, std::string& edgelist,
+                              std::string& clustering_file, bool& staged);
+
+    /**
+     * Send this worker's node name and memory budget to the load balancer. Without a
+     * declared budget, the node's physical memory (or the job's cgroup limit, if lower) is used.
+     */
+    void send_worker_info();
+
     /**
      * Process a single cluster
-     * Returns {success, yield_count} where yield_count is the number of
-     * sub-clusters directly yielded by this cluster's child process.
+     * Returns whether it succeeded, the number of sub-clusters directly yielded by this
+     * cluster's child process, and the child's run time.
+     */
+    ClusterResult process_cluster(int64_t cluster_id, bool is_yielded);
+
+    /**
+     * Take the next yield ID. Blocks arrive ahead of need with work assignments; only a
+     * worker that runs out in the middle of a cluster asks the load balancer and waits.
      */
-    std::pair<bool, int> process_cluster(int cluster_id, bool is_yielded);
+    int64_t next_yield_id();
 
 public:
     Worker(const std::string& method, Logger& logger, const std::string& work_dir,
@@ -40,6 +85,8 @@ public:
            int time_limit_per_cluster = -1,
            int report_interval = 10,
            int num_processors = 1,
-           int yield_node_threshold = 0);
+           int yield_node_threshold = 0,
+           int64_t node_memory_mb = 0,
+           int prefetch_depth = 0);
     void run();
 };
\ No newline at end of file
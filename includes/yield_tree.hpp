@@ -0,0 +1,99 @@
+#pragma once
+#include <slot_index.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Tree node for tracking hierarchical yield dependencies.
+// Each node represents a cluster that may yield sub-clusters during processing.
+// A parent is considered resolved when:
+//   1. Its own work is done (work_done == true)
+//   2. All children have resolved (resolved_children == expected_yields)
+// expected_yields is set from yield_count in the WORK_DONE/WORK_ABORTED message.
+// Before WORK_DONE, YIELD_REPORTs simply register children; resolution can't happen
+// since work_done is false. After WORK_DONE, late YIELD_REPORTs register children
+// without affecting resolved_children (they were pre-counted in expected_yields).
+struct YieldNode {
+    int64_t cluster_id;
+    int64_t parent_id;          // -1 for original clusters (from the input file)
+    int64_t root_id;            // original cluster at the top of this node's yield chain
+    bool work_done = false;     // WORK_DONE or WORK_ABORTED received for this node
+    bool aborted = false;       // WORK_ABORTED specifically (triggers descendant sweep)
+    bool under_abort = false;   // this node or an ancestor is aborted
+    int expected_yields = 0;    // yield_count from WORK_DONE/WORK_ABORTED message
+    int resolved_children = 0;  // children that have completed, been swept, or been discarded
+
+    // Links, as slots in the YieldTree (SlotIndex::NONE when absent)
+    uint32_t parent = SlotIndex::NONE;
+    uint32_t first_child = SlotIndex::NONE;
+    uint32_t next_sibling = SlotIndex::NONE;
+    uint32_t prev_sibling = SlotIndex::NONE;
+};
+
+/**
+ * The yield tree, stored as a slot map: nodes live in one vector and link to each other by
+ * slot (first child / next sibling), a SlotIndex maps cluster IDs to slots, and the slots of
+ * erased nodes are reused. Every traversal is iterative, so yield chains of any depth are
+ * handled without recursion, and no operation allocates once the vectors have grown.
+ *
+ * Slots stay valid until their node is erased, but references returned by node() are
+ * invalidated by add_root() and add_child().
+ */
+class YieldTree {
+public:
+    static constexpr uint32_t NONE = SlotIndex::NONE;
+
+private:
+    std::vector<YieldNode> nodes;
+    std::vector<uint32_t> free_slots;
+    SlotIndex index;                    // cluster_id → slot
+
+    uint32_t allocate(const YieldNode& node);
+
+    // Detach a node from its parent's child list
+    void unlink(uint32_t slot);
+
+public:
+    bool empty() const { return index.empty(); }
+    size_t size() const { return index.size(); }
+
+    // Slot of a cluster's node, or NONE
+    uint32_t find(int64_t cluster_id) const { return index.find(cluster_id); }
+    bool contains(int64_t cluster_id) const { return find(cluster_id) != NONE; }
+
+    YieldNode& node(uint32_t slot) { return nodes[slot]; }
+    const YieldNode& node(uint32_t slot) const { return nodes[slot]; }
+
+    /**
+     * Slot of a cluster's node, adding it as a root (an original cluster) if it is not tracked
+     */
+    uint32_t find_or_add_root(int64_t cluster_id);
+
+    /**
+     * Add a node for a cluster yielded by the node at parent, inheriting its root and abort
+     * state. Throws std::runtime_error if the cluster is already tracked.
+     */
+    uint32_t add_child(uint32_t parent, int64_t cluster_id);
+
+    /**
+     * Mark a node aborted, and every node below it as under an aborted ancestor
+     */
+    void mark_aborted(uint32_t slot);
+
+    /**
+     * Remove a node and all its descendants
+     */
+    void erase_subtree(uint32_t slot);
+
+    void clear();
+
+    // Call fn(child_slot) for each direct child; fn may erase the child it is given
+    template <typename Fn>
+    void for_each_child(uint32_t slot, Fn&& fn) {
+        for (uint32_t child = nodes[slot].first_child; child != NONE;) {
+            uint32_t next = nodes[child].next_sibling;
+            fn(child);
+            child = next;
+        }
+    }
+};
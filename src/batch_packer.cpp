@@ -0,0 +1,55 @@
+#include <batch_packer.hpp>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+MaxSegmentTree::MaxSegmentTree(size_t size) {
+    while (leaves < size) leaves *= 2;
+    tree.assign(2 * leaves, -std::numeric_limits<double>::infinity());
+}
+
+void MaxSegmentTree::set(size_t slot, double value) {
+    size_t node = leaves + slot;
+    tree[node] = value;
+    for (node /= 2; node >= 1; node /= 2) tree[node] = std::max(tree[2 * node], tree[2 * node + 1]);
+}
+
+int64_t MaxSegmentTree::first_at_least(double bound) const {
+    if (tree[1] < bound) return -1;
+    size_t node = 1;
+    while (node < leaves) node = tree[2 * node] >= bound ? 2 * node : 2 * node + 1;
+    return static_cast<int64_t>(node - leaves);
+}
+
+std::vector<std::vector<int32_t>> pack_batches(const std::vector<float>& costs, double target) {
+    std::vector<int32_t> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int32_t a, int32_t b) { return costs[a] > costs[b]; });
+
+    std::vector<std::vector<int32_t>> standalone;
+    std::vector<std::vector<int32_t>> packed;
+    MaxSegmentTree room(costs.size());      // target - fill of every open packed batch
+    for (int32_t item : order) {
+        double cost = costs[item];
+        if (cost >= target) {
+            standalone.push_back({item});
+            continue;
+        }
+
+        // Exact fit first, then any open batch, then a new batch
+        int64_t slot = room.first_at_least(cost);
+        if (slot < 0) slot = room.first_at_least(std::numeric_limits<double>::min());
+        if (slot < 0) {
+            slot = static_cast<int64_t>(packed.size());
+            packed.emplace_back();
+            room.set(slot, target);
+        }
+        packed[slot].push_back(item);
+        double left = room.get(slot) - cost;
+        room.set(slot, left > 0 ? left : -std::numeric_limits<double>::infinity());
+    }
+
+    standalone.insert(standalone.end(), std::make_move_iterator(packed.begin()),
+                      std::make_move_iterator(packed.end()));
+    return standalone;
+}
@@ -0,0 +1,258 @@
+#include <binary_format.hpp>
+#include <mapped_file.hpp>
+#include <parser.hpp>
+#include <parallel.hpp>
+#include <file_io.hpp>
+#include <hash.hpp>
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace {
+
+// Records per pwrite in convert_text_pairs (4 MiB)
+constexpr uint64_t WRITE_BLOCK = 4 << 20;
+
+// Legacy record count width
+size_t legacy_count_size(BinaryKind kind) {
+    return kind == BinaryKind::Edgelist ? sizeof(uint64_t) : sizeof(uint32_t);
+}
+
+const char* kind_name(BinaryKind kind) {
+    return kind == BinaryKind::Edgelist ? "edgelist file" : "clustering file";
+}
+
+/**
+ * One bit per int32 node id, set concurrently by the conversion threads. Backed by an
+ * anonymous mapping so only the pages holding used ids are ever materialized.
+ */
+class NodeBitmap {
+private:
+    static constexpr uint64_t NUM_WORDS = (uint64_t(1) << 32) / 64;
+    uint64_t* words;
+
+    // Bit order matches signed id order
+    static uint32_t bit_of(int32_t id) { return static_cast<uint32_t>(id) ^ 0x80000000u; }
+
+public:
+    NodeBitmap() {
+        void* mapped = mmap(nullptr, NUM_WORDS * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Failed to allocate node bitmap");
+        }
+        words = static_cast<uint64_t*>(mapped);
+    }
+    ~NodeBitmap() { munmap(words, NUM_WORDS * sizeof(uint64_t)); }
+
+    NodeBitmap(const NodeBitmap&) = delete;
+    NodeBitmap& operator=(const NodeBitmap&) = delete;
+
+    void set(int32_t id) {
+        uint32_t bit = bit_of(id);
+        uint64_t mask = uint64_t(1) << (bit & 63);
+        std::atomic_ref<uint64_t> word(words[bit >> 6]);
+        if ((word.load(std::memory_order_relaxed) & mask) == 0) word.fetch_or(mask, std::memory_order_relaxed);
+    }
+
+    // Set ids in [min_id, max_id], in ascending order
+    std::vector<int32_t> ids(int32_t min_id, int32_t max_id) const {
+        std::vector<int32_t> result;
+        for (uint64_t w = bit_of(min_id) >> 6; w <= (bit_of(max_id) >> 6); ++w) {
+            uint64_t word = words[w];
+            while (word != 0) {
+                uint32_t bit = static_cast<uint32_t>(w * 64 + __builtin_ctzll(word));
+                result.push_back(static_cast<int32_t>(bit ^ 0x80000000u));
+                word &= word - 1;
+            }
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+BinaryView view_binary(const char* data, const char* end, BinaryKind kind, const std::string& filepath) {
+    BinaryView view;
+    size_t size = static_cast<size_t>(end - data);
+    if (size >= sizeof(BinaryHeader) && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+        const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(data);
+        if (header->version > BINARY_FORMAT_VERSION || header->kind != static_cast<uint32_t>(kind)) {
+            throw std::runtime_error("Unsupported binary " + std::string(kind_name(kind)) + " (version " +
+                                     std::to_string(header->version) + ", kind " + std::to_string(header->kind) +
+                                     "): " + filepath);
+        }
+        if (header->data_offset + header->num_records * 2 * sizeof(int32_t) > size ||
+            (header->remap_offset != 0 && header->remap_offset + header->num_nodes * sizeof(int32_t) > size)) {
+            throw std::runtime_error("Truncated binary " + std::string(kind_name(kind)) + ": " + filepath);
+        }
+        view.header = header;
+        view.num_records = header->num_records;
+        view.pairs = reinterpret_cast<const int32_t*>(data + header->data_offset);
+        if (header->remap_offset != 0) view.remap = reinterpret_cast<const int32_t*>(data + header->remap_offset);
+        return view;
+    }
+
+    size_t count_size = legacy_count_size(kind);
+    if (size < count_size) {
+        throw std::runtime_error("Truncated binary " + std::string(kind_name(kind)) + ": " + filepath);
+    }
+    if (kind == BinaryKind::Edgelist) {
+        std::memcpy(&view.num_records, data, sizeof(uint64_t));
+    } else {
+        uint32_t num_entries;
+        std::memcpy(&num_entries, data, sizeof(num_entries));
+        view.num_records = num_entries;
+    }
+    if (count_size + view.num_records * 2 * sizeof(int32_t) > size) {
+        throw std::runtime_error("Truncated binary " + std::string(kind_name(kind)) + ": " + filepath);
+    }
+    view.pairs = reinterpret_cast<const int32_t*>(data + count_size);
+    return view;
+}
+
+uint64_t pair_checksum(const int32_t* pairs, uint64_t first, uint64_t count) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t record = (uint64_t(static_cast<uint32_t>(pairs[2 * i])) << 32) | static_cast<uint32_t>(pairs[2 * i + 1]);
+        sum += mix64(record ^ ((first + i) * 0x9E3779B97F4A7C15ULL));
+    }
+    return sum;
+}
+
+ConvertStats convert_text_pairs(const std::string& input, const std::string& output, BinaryKind kind,
+                                const ConvertOptions& options) {
+    MappedFile mapped(input, kind_name(kind));
+    const char* data = mapped.data();
+    const char* end = mapped.end();
+    char delimiter = detect_delimiter(data, end, input);
+    std::vector<TextChunk> chunks = split_lines(skip_header(data, end), end, std::max(1, options.num_threads));
+
+    // Pass 1: the parser emits one record per line, so newlines give each chunk's first record
+    std::vector<uint64_t> first_record(chunks.size() + 1, 0);
+    ConvertStats stats;
+    stats.thread_seconds = run_parallel(chunks.size(), [&](size_t c) {
+        const auto& [begin, chunk_end] = chunks[c];
+        first_record[c + 1] = std::count(begin, chunk_end, '\n') + (*(chunk_end - 1) != '\n' ? 1 : 0);
+    });
+    for (size_t c = 0; c < chunks.size(); ++c) first_record[c + 1] += first_record[c];
+    stats.num_records = first_record.back();
+    if (!options.header && kind == BinaryKind::Cluster && stats.num_records > UINT32_MAX) {
+        throw std::runtime_error("Too many entries for a legacy .bcluster (use a header): " + input);
+    }
+
+    uint64_t data_offset = options.header ? BINARY_DATA_ALIGNMENT : legacy_count_size(kind);
+    uint64_t data_end = data_offset + stats.num_records * 2 * sizeof(int32_t);
+    int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open binary " + std::string(kind_name(kind)) + " for writing: " + output);
+    }
+
+    try {
+        if (ftruncate(fd, static_cast<off_t>(data_end)) != 0) {
+            throw std::runtime_error("Failed to size " + output + ": " + std::strerror(errno));
+        }
+
+        // Pass 2: parse each chunk and write its records at their offset. The first write of
+        // a chunk runs up to a WRITE_BLOCK boundary of the file, so later ones are aligned.
+        std::unique_ptr<NodeBitmap> nodes = options.header ? std::make_unique<NodeBitmap>() : nullptr;
+        std::vector<uint64_t> chunk_checksums(chunks.size(), 0);
+        std::vector<int32_t> chunk_min(chunks.size(), INT32_MAX), chunk_max(chunks.size(), INT32_MIN);
+        stats.thread_seconds += run_parallel(chunks.size(), [&](size_t c) {
+            uint64_t record = first_record[c];
+            uint64_t offset = data_offset + record * 2 * sizeof(int32_t);
+            std::vector<int32_t> buffer;
+            buffer.reserve(WRITE_BLOCK / sizeof(int32_t));
+            size_t limit = (WRITE_BLOCK - offset % WRITE_BLOCK) / sizeof(int32_t);
+            auto flush = [&]() {
+                uint64_t count = buffer.size() / 2;
+                chunk_checksums[c] += pair_checksum(buffer.data(), record, count);
+                pwrite_all(fd, reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(int32_t),
+                           offset, output);
+                record += count;
+                offset += buffer.size() * sizeof(int32_t);
+                buffer.clear();
+                limit = WRITE_BLOCK / sizeof(int32_t);
+            };
+            parse_pairs(chunks[c].first, chunks[c].second, delimiter, [&](int first, int second) {
+                // Legacy .bcluster records start at offset 4, so their flushes end one int past a boundary
+                buffer.push_back(first);
+                buffer.push_back(second);
+                if (nodes) {
+                    nodes->set(first);
+                    chunk_min[c] = std::min(chunk_min[c], first);
+                    chunk_max[c] = std::max(chunk_max[c], first);
+                    if (kind == BinaryKind::Edgelist) {
+                        nodes->set(second);
+                        chunk_min[c] = std::min(chunk_min[c], second);
+                        chunk_max[c] = std::max(chunk_max[c], second);
+                    }
+                }
+                if (buffer.size() >= limit) flush();
+            });
+            flush();
+        });
+        for (uint64_t checksum : chunk_checksums) stats.checksum += checksum;
+
+        if (options.header) {
+            std::vector<int32_t> remap;
+            if (stats.num_records > 0) {
+                remap = nodes->ids(*std::min_element(chunk_min.begin(), chunk_min.end()),
+                                   *std::max_element(chunk_max.begin(), chunk_max.end()));
+            }
+            nodes.reset();
+            stats.num_nodes = remap.size();
+            pwrite_all(fd, reinterpret_cast<const char*>(remap.data()), remap.size() * sizeof(int32_t), data_end, output);
+
+            BinaryHeader header{};
+            std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+            header.version = BINARY_FORMAT_VERSION;
+            header.kind = static_cast<uint32_t>(kind);
+            header.num_records = stats.num_records;
+            header.num_nodes = stats.num_nodes;
+            header.data_offset = data_offset;
+            header.remap_offset = data_end;
+            header.checksum = stats.checksum;
+            pwrite_all(fd, reinterpret_cast<const char*>(&header), sizeof(header), 0, output);
+        } else if (kind == BinaryKind::Edgelist) {
+            uint64_t num_edges = stats.num_records;
+            pwrite_all(fd, reinterpret_cast<const char*>(&num_edges), sizeof(num_edges), 0, output);
+        } else {
+            uint32_t num_entries = static_cast<uint32_t>(stats.num_records);
+            pwrite_all(fd, reinterpret_cast<const char*>(&num_entries), sizeof(num_entries), 0, output);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return stats;
+}
+
+bool verify_binary(const std::string& filepath, BinaryKind kind, int num_threads) {
+    MappedFile mapped(filepath, kind_name(kind));
+    BinaryView view = view_binary(mapped.data(), mapped.end(), kind, filepath);
+    if (view.header == nullptr) {
+        throw std::runtime_error("No header (and so no checksum) in " + filepath);
+    }
+
+    size_t num_chunks = std::max<uint64_t>(1, std::min<uint64_t>(std::max(1, num_threads), view.num_records));
+    uint64_t per_chunk = view.num_records / num_chunks + 1;
+    std::vector<uint64_t> chunk_checksums(num_chunks, 0);
+    run_parallel(num_chunks, [&](size_t c) {
+        uint64_t first = std::min(view.num_records, c * per_chunk);
+        uint64_t last = std::min(view.num_records, first + per_chunk);
+        chunk_checksums[c] = pair_checksum(view.pairs + 2 * first, first, last - first);
+    });
+
+    uint64_t checksum = 0;
+    for (uint64_t sum : chunk_checksums) checksum += sum;
+    return checksum == view.header->checksum;
+}
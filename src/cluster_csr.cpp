@@ -0,0 +1,167 @@
+#include <cluster_csr.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+
+// Old local id of every new local id, for a graph in CSR form with ids in ascending global order
+std::vector<int32_t> relabel_order(NodeOrder order, const std::vector<int64_t>& offsets,
+                                   const std::vector<int32_t>& neighbors) {
+    size_t num_nodes = offsets.size() - 1;
+    auto degree = [&](int32_t u) { return offsets[u + 1] - offsets[u]; };
+    std::vector<int32_t> by_degree(num_nodes);
+    for (size_t u = 0; u < num_nodes; ++u) by_degree[u] = static_cast<int32_t>(u);
+    if (order == NodeOrder::Degree) {
+        std::stable_sort(by_degree.begin(), by_degree.end(),
+                         [&](int32_t a, int32_t b) { return degree(a) > degree(b); });
+        return by_degree;
+    }
+
+    // Cuthill-McKee from the lowest-degree node of every component, reversed at the end
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [&](int32_t a, int32_t b) { return degree(a) < degree(b); });
+    std::vector<int32_t> visit_order;
+    visit_order.reserve(num_nodes);
+    std::vector<char> visited(num_nodes, 0);
+    std::vector<int32_t> next;
+    for (int32_t seed : by_degree) {
+        if (visited[seed]) continue;
+        visited[seed] = 1;
+        visit_order.push_back(seed);
+        for (size_t head = visit_order.size() - 1; head < visit_order.size(); ++head) {
+            int32_t u = visit_order[head];
+            next.clear();
+            for (int64_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+                int32_t v = neighbors[i];
+                if (visited[v]) continue;
+                visited[v] = 1;
+                next.push_back(v);
+            }
+            std::sort(next.begin(), next.end(), [&](int32_t a, int32_t b) {
+                return degree(a) != degree(b) ? degree(a) < degree(b) : a < b;
+            });
+            visit_order.insert(visit_order.end(), next.begin(), next.end());
+        }
+    }
+    std::reverse(visit_order.begin(), visit_order.end());
+    return visit_order;
+}
+
+}  // namespace
+
+bool is_csr(const void* data, size_t size) {
+    return size >= sizeof(CsrHeader) && std::memcmp(data, CSR_MAGIC, sizeof(CSR_MAGIC)) == 0;
+}
+
+CsrView view_csr(const char* data, size_t size, const std::string& filepath) {
+    if (!is_csr(data, size)) {
+        throw std::runtime_error("Not a CSR cluster image: " + filepath);
+    }
+    const CsrHeader* header = reinterpret_cast<const CsrHeader*>(data);
+    if (csr_length(header->num_nodes, header->num_edges) > size) {
+        throw std::runtime_error("Truncated CSR cluster image: " + filepath);
+    }
+
+    CsrView view;
+    view.num_nodes = header->num_nodes;
+    view.num_edges = header->num_edges;
+    const char* cursor = data + sizeof(CsrHeader);
+    view.offsets = reinterpret_cast<const int64_t*>(cursor);
+    cursor += (view.num_nodes + 1) * sizeof(int64_t);
+    view.neighbors = reinterpret_cast<const int32_t*>(cursor);
+    cursor += 2 * view.num_edges * sizeof(int32_t);
+    view.local_to_global = reinterpret_cast<const int32_t*>(cursor);
+    return view;
+}
+
+void encode_csr(const std::vector<std::pair<int, int>>& edges,
+                const std::vector<std::pair<int, int>>& cluster_entries,
+                std::vector<uint8_t>& out,
+                NodeOrder order) {
+    uint64_t num_nodes = cluster_entries.size();
+    uint64_t num_edges = edges.size();
+    std::vector<int32_t> local_to_global(num_nodes);
+    for (size_t i = 0; i < num_nodes; ++i) local_to_global[i] = cluster_entries[i].first;
+    std::sort(local_to_global.begin(), local_to_global.end());
+    auto local_id = [&](int node) {
+        auto it = std::lower_bound(local_to_global.begin(), local_to_global.end(), node);
+        if (it == local_to_global.end() || *it != node) {
+            throw std::runtime_error("Edge endpoint " + std::to_string(node) + " is not a member of its batch");
+        }
+        return static_cast<int32_t>(it - local_to_global.begin());
+    };
+
+    size_t header_at = out.size();
+    out.resize(header_at + csr_length(num_nodes, num_edges));
+    CsrHeader header{};
+    std::memcpy(header.magic, CSR_MAGIC, sizeof(header.magic));
+    header.num_nodes = num_nodes;
+    header.num_edges = num_edges;
+    std::memcpy(out.data() + header_at, &header, sizeof(header));
+
+    // Degrees, then prefix sums, then fill; arcs are kept as local ids during the fill
+    std::vector<std::pair<int32_t, int32_t>> arcs(num_edges);
+    std::vector<int64_t> offsets(num_nodes + 1, 0);
+    for (size_t e = 0; e < num_edges; ++e) {
+        arcs[e] = {local_id(edges[e].first), local_id(edges[e].second)};
+        ++offsets[arcs[e].first + 1];
+        ++offsets[arcs[e].second + 1];
+    }
+    for (size_t u = 0; u < num_nodes; ++u) offsets[u + 1] += offsets[u];
+
+    std::vector<int32_t> neighbors(2 * num_edges);
+    std::vector<int64_t> next(offsets.begin(), offsets.end() - 1);
+    for (const auto& [u, v] : arcs) {
+        neighbors[next[u]++] = v;
+        neighbors[next[v]++] = u;
+    }
+
+    // Renumber: the adjacency of new id u is the adjacency of old_of[u], translated
+    if (order != NodeOrder::Global && num_nodes > 1) {
+        std::vector<int32_t> old_of = relabel_order(order, offsets, neighbors);
+        std::vector<int32_t> new_of(num_nodes);
+        for (size_t u = 0; u < num_nodes; ++u) new_of[old_of[u]] = static_cast<int32_t>(u);
+
+        std::vector<int64_t> new_offsets(num_nodes + 1, 0);
+        std::vector<int32_t> new_neighbors(neighbors.size());
+        std::vector<int32_t> new_local_to_global(num_nodes);
+        for (size_t u = 0; u < num_nodes; ++u) {
+            int32_t old = old_of[u];
+            int64_t written = new_offsets[u];
+            for (int64_t i = offsets[old]; i < offsets[old + 1]; ++i) new_neighbors[written++] = new_of[neighbors[i]];
+            new_offsets[u + 1] = written;
+            new_local_to_global[u] = local_to_global[old];
+        }
+        offsets.swap(new_offsets);
+        neighbors.swap(new_neighbors);
+        local_to_global.swap(new_local_to_global);
+    }
+    for (size_t u = 0; u < num_nodes; ++u) {
+        std::sort(neighbors.begin() + offsets[u], neighbors.begin() + offsets[u + 1]);
+    }
+
+    uint8_t* cursor = out.data() + header_at + sizeof(CsrHeader);
+    std::memcpy(cursor, offsets.data(), offsets.size() * sizeof(int64_t));
+    cursor += offsets.size() * sizeof(int64_t);
+    std::memcpy(cursor, neighbors.data(), neighbors.size() * sizeof(int32_t));
+    cursor += neighbors.size() * sizeof(int32_t);
+    std::memcpy(cursor, local_to_global.data(), local_to_global.size() * sizeof(int32_t));
+}
+
+std::vector<std::pair<int, int>> csr_edges(const CsrView& csr) {
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(csr.num_edges);
+    for (uint64_t u = 0; u < csr.num_nodes; ++u) {
+        bool skip_loop = false;     // a self-loop occupies two consecutive arcs
+        for (int32_t v : csr.neighbors_of(u)) {
+            if (static_cast<uint64_t>(v) < u) continue;
+            if (static_cast<uint64_t>(v) == u) {
+                skip_loop = !skip_loop;
+                if (!skip_loop) continue;
+            }
+            edges.emplace_back(csr.local_to_global[u], csr.local_to_global[v]);
+        }
+    }
+    return edges;
+}
@@ -0,0 +1,113 @@
+#include <cluster_index.hpp>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Id ranges up to this many slots per distinct entry are direct-addressed
+constexpr int64_t MAX_SLOTS_PER_ENTRY = 4;
+constexpr int64_t MIN_DIRECT_SLOTS = int64_t(1) << 20;
+
+bool use_direct_addressing(int64_t min_id, int64_t max_id, size_t num_entries) {
+    int64_t span = max_id - min_id + 1;
+    return span <= std::max<int64_t>(MIN_DIRECT_SLOTS, MAX_SLOTS_PER_ENTRY * static_cast<int64_t>(num_entries));
+}
+
+}  // namespace
+
+void ClusterIndex::build(std::vector<std::pair<int, int>>& entries) {
+    node_cluster.clear();
+    sorted_nodes.clear();
+    cluster_ids.clear();
+    member_offsets.assign(1, 0);
+    member_nodes.clear();
+    if (entries.empty()) return;
+
+    int64_t min_node = std::numeric_limits<int32_t>::max(), max_node = std::numeric_limits<int32_t>::min();
+    int64_t min_cluster = std::numeric_limits<int32_t>::max(), max_cluster = std::numeric_limits<int32_t>::min();
+    for (const auto& [node_id, cluster_id] : entries) {
+        min_node = std::min<int64_t>(min_node, node_id);
+        max_node = std::max<int64_t>(max_node, node_id);
+        min_cluster = std::min<int64_t>(min_cluster, cluster_id);
+        max_cluster = std::max<int64_t>(max_cluster, cluster_id);
+    }
+
+    // Dense cluster indices in ascending cluster_id order. Each entry's cluster_id is
+    // replaced by its dense index, so the remaining passes only deal with dense indices.
+    if (use_direct_addressing(min_cluster, max_cluster, entries.size())) {
+        std::vector<int32_t> cluster_slot(max_cluster - min_cluster + 1, -1);
+        for (const auto& entry : entries) cluster_slot[entry.second - min_cluster] = 0;
+        for (size_t slot = 0; slot < cluster_slot.size(); ++slot) {
+            if (cluster_slot[slot] == 0) {
+                cluster_slot[slot] = static_cast<int32_t>(cluster_ids.size());
+                cluster_ids.push_back(static_cast<int32_t>(min_cluster + slot));
+            }
+        }
+        for (auto& entry : entries) entry.second = cluster_slot[entry.second - min_cluster];
+    } else {
+        cluster_ids.reserve(entries.size());
+        for (const auto& entry : entries) cluster_ids.push_back(entry.second);
+        std::sort(cluster_ids.begin(), cluster_ids.end());
+        cluster_ids.erase(std::unique(cluster_ids.begin(), cluster_ids.end()), cluster_ids.end());
+        cluster_ids.shrink_to_fit();
+        for (auto& entry : entries) {
+            entry.second = static_cast<int32_t>(
+                std::lower_bound(cluster_ids.begin(), cluster_ids.end(), entry.second) - cluster_ids.begin());
+        }
+    }
+
+    // Node -> cluster array; later entries overwrite earlier ones
+    min_node_id = static_cast<int32_t>(min_node);
+    direct_nodes = use_direct_addressing(min_node, max_node, entries.size());
+    if (direct_nodes) {
+        node_cluster.assign(max_node - min_node + 1, -1);
+        for (const auto& [node_id, cluster] : entries) node_cluster[node_id - min_node] = cluster;
+    } else {
+        sorted_nodes.reserve(entries.size());
+        for (const auto& entry : entries) sorted_nodes.push_back(entry.first);
+        std::sort(sorted_nodes.begin(), sorted_nodes.end());
+        sorted_nodes.erase(std::unique(sorted_nodes.begin(), sorted_nodes.end()), sorted_nodes.end());
+        sorted_nodes.shrink_to_fit();
+        node_cluster.assign(sorted_nodes.size(), -1);
+        for (const auto& [node_id, cluster] : entries) {
+            size_t slot = std::lower_bound(sorted_nodes.begin(), sorted_nodes.end(), node_id) - sorted_nodes.begin();
+            node_cluster[slot] = cluster;
+        }
+    }
+
+    // Membership CSR via counting sort by dense cluster index
+    size_t num_clusters = cluster_ids.size();
+    std::vector<int64_t> cursor(num_clusters + 1, 0);
+    for (const auto& entry : entries) ++cursor[entry.second + 1];
+    for (size_t c = 0; c < num_clusters; ++c) cursor[c + 1] += cursor[c];
+    member_nodes.resize(entries.size());
+    member_offsets = cursor;
+    for (const auto& [node_id, cluster] : entries) member_nodes[cursor[cluster]++] = node_id;
+    std::vector<std::pair<int, int>>().swap(entries);
+
+    // Sort each cluster's nodes and drop duplicate entries, compacting in place
+    int64_t write = 0;
+    for (size_t c = 0; c < num_clusters; ++c) {
+        auto first = member_nodes.begin() + member_offsets[c];
+        auto last = member_nodes.begin() + member_offsets[c + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        member_offsets[c] = write;
+        write = std::copy(first, last, member_nodes.begin() + write) - member_nodes.begin();
+    }
+    member_offsets[num_clusters] = write;
+    member_nodes.resize(write);
+    member_nodes.shrink_to_fit();
+}
+
+int32_t ClusterIndex::cluster_of_sparse(int node_id) const {
+    auto it = std::lower_bound(sorted_nodes.begin(), sorted_nodes.end(), node_id);
+    if (it == sorted_nodes.end() || *it != node_id) return -1;
+    return node_cluster[it - sorted_nodes.begin()];
+}
+
+size_t ClusterIndex::memory_bytes() const {
+    return node_cluster.capacity() * sizeof(int32_t) + sorted_nodes.capacity() * sizeof(int32_t) +
+           cluster_ids.capacity() * sizeof(int32_t) + member_offsets.capacity() * sizeof(int64_t) +
+           member_nodes.capacity() * sizeof(int32_t);
+}
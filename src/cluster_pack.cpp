@@ -0,0 +1,187 @@
+#include <cluster_pack.hpp>
+#include <utils.hpp>
+#include <edge_codec.hpp>
+#include <file_io.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+namespace fs = std::filesystem;
+
+namespace {
+
+// Copy length bytes at offset of fd into a new file at path
+void copy_range(int fd, uint64_t offset, uint64_t length, const std::string& source, const std::string& path) {
+    int out = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        throw std::runtime_error("Failed to create " + path + ": " + std::strerror(errno));
+    }
+
+    constexpr size_t BUFFER_SIZE = 4 << 20;
+    std::vector<char> buffer(std::min<uint64_t>(BUFFER_SIZE, length));
+    while (length > 0) {
+        ssize_t read = pread(fd, buffer.data(), std::min<uint64_t>(buffer.size(), length), static_cast<off_t>(offset));
+        if (read < 0 && errno == EINTR) continue;
+        if (read <= 0) {
+            close(out);
+            throw std::runtime_error("Failed to read " + source + " at offset " + std::to_string(offset));
+        }
+        const char* data = buffer.data();
+        size_t remaining = static_cast<size_t>(read);
+        while (remaining > 0) {
+            ssize_t written = ::write(out, data, remaining);
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0) {
+                close(out);
+                throw std::runtime_error("Failed to write " + path + ": " + std::strerror(errno));
+            }
+            data += written;
+            remaining -= written;
+        }
+        offset += read;
+        length -= read;
+    }
+    close(out);
+}
+
+}  // namespace
+
+ClusterPackWriter::ClusterPackWriter(const std::string& dir, uint64_t base_offset, bool truncate,
+                                     PackEdgeFormat edge_format)
+    : path(dir + "/" + PACK_DATA_FILE), next_offset(base_offset), edge_format(edge_format) {
+    // Replace rather than truncate: an existing pack may be hard-linked from the partition cache
+    if (truncate) fs::remove(path);
+    fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open cluster pack for writing: " + path);
+    }
+}
+
+ClusterPackWriter::~ClusterPackWriter() {
+    if (fd >= 0) close(fd);
+}
+
+// Append one batch payload: .bedgelist (or .cedgelist) image followed by .bcluster image
+void ClusterPackWriter::append(const ClusterInfo& head,
+                               std::vector<std::pair<int, int>>& edges,
+                               const std::vector<std::pair<int, int>>& cluster_entries) {
+    uint64_t num_edges = edges.size();
+    uint32_t num_entries = static_cast<uint32_t>(cluster_entries.size());
+    struct iovec parts[4] = {
+        {&num_edges, sizeof(num_edges)},
+        {edges.data(), edges.size() * sizeof(std::pair<int, int>)},
+        {&num_entries, sizeof(num_entries)},
+        {const_cast<std::pair<int, int>*>(cluster_entries.data()), cluster_entries.size() * sizeof(std::pair<int, int>)},
+    };
+    int first_part = 0;
+    if (edge_format == PackEdgeFormat::Compressed) {
+        encoded.clear();
+        encode_edges(edges, encoded);
+        parts[1] = {encoded.data(), encoded.size()};
+        first_part = 1;
+    }
+
+    uint64_t length = 0;
+    for (int i = first_part; i < 4; ++i) length += parts[i].iov_len;
+    PackIndexEntry entry{static_cast<int32_t>(head.cluster_id), static_cast<int32_t>(num_entries), static_cast<int64_t>(num_edges),
+                         next_offset, length};
+
+    // pwritev may write partially; finish any remainder part by part
+    ssize_t written = pwritev(fd, parts + first_part, 4 - first_part, static_cast<off_t>(next_offset));
+    if (written < 0) written = 0;
+    uint64_t offset = next_offset;
+    for (int i = first_part; i < 4; ++i) {
+        const struct iovec& part = parts[i];
+        size_t done = std::min<uint64_t>(part.iov_len, static_cast<uint64_t>(written));
+        written -= done;
+        if (done < part.iov_len) {
+            pwrite_all(fd, static_cast<const char*>(part.iov_base) + done, part.iov_len - done, offset + done, path);
+        }
+        offset += part.iov_len;
+    }
+
+    next_offset += entry.length;
+    entries.push_back(entry);
+}
+
+void write_pack_index(const std::string& dir, const std::vector<PackIndexEntry>& entries) {
+    // Written aside and renamed over the old index: that one may be hard-linked from the
+    // partition cache, whose pack would then be paired with a foreign index
+    std::string path = dir + "/" + PACK_INDEX_FILE;
+    std::string staging = path + ".tmp";
+    int fd = open(staging.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open cluster pack index for writing: " + staging);
+    }
+
+    PackIndexHeader header{};
+    std::memcpy(header.magic, PACK_INDEX_MAGIC, sizeof(header.magic));
+    header.num_entries = entries.size();
+    pwrite_all(fd, reinterpret_cast<const char*>(&header), sizeof(header), 0, staging);
+    pwrite_all(fd, reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackIndexEntry),
+               sizeof(header), staging);
+    close(fd);
+    fs::rename(staging, path);
+}
+
+ClusterPackReader::ClusterPackReader(const std::string& dir)
+    : index_file(dir + "/" + PACK_INDEX_FILE, "cluster pack index"), path(dir + "/" + PACK_DATA_FILE) {
+    PackIndexHeader header;
+    if (index_file.size() < sizeof(header)) {
+        throw std::runtime_error("Truncated cluster pack index: " + dir + "/" + PACK_INDEX_FILE);
+    }
+    std::memcpy(&header, index_file.data(), sizeof(header));
+    if (std::memcmp(header.magic, PACK_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        index_file.size() < sizeof(header) + header.num_entries * sizeof(PackIndexEntry)) {
+        throw std::runtime_error("Invalid cluster pack index: " + dir + "/" + PACK_INDEX_FILE);
+    }
+    index_entries = {reinterpret_cast<const PackIndexEntry*>(index_file.data() + sizeof(header)),
+                     static_cast<size_t>(header.num_entries)};
+
+    by_cluster.reserve(index_entries.size());
+    for (size_t i = 0; i < index_entries.size(); ++i) by_cluster.emplace(index_entries[i].cluster_id, i);
+
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open cluster pack: " + path);
+    }
+}
+
+ClusterPackReader::~ClusterPackReader() {
+    if (fd >= 0) close(fd);
+}
+
+bool ClusterPackReader::exists(const std::string& dir) {
+    return fs::exists(dir + "/" + PACK_INDEX_FILE);
+}
+
+const PackIndexEntry* ClusterPackReader::find(int cluster_id) const {
+    auto it = by_cluster.find(cluster_id);
+    return it == by_cluster.end() ? nullptr : &index_entries[it->second];
+}
+
+void ClusterPackReader::extract(const PackIndexEntry& entry, const std::string& edgelist_path,
+                                const std::string& cluster_path) const {
+    uint64_t edges_length = pack_edges_length(entry.edge_count);
+    CompressedEdgesHeader header;
+    if (entry.length >= sizeof(header) &&
+        pread(fd, &header, sizeof(header), static_cast<off_t>(entry.offset)) == static_cast<ssize_t>(sizeof(header)) &&
+        is_compressed_edges(&header, sizeof(header))) {
+        edges_length = sizeof(header) + header.encoded_bytes;
+        std::vector<uint8_t> stream(header.encoded_bytes);
+        if (pread(fd, stream.data(), stream.size(), static_cast<off_t>(entry.offset + sizeof(header))) !=
+            static_cast<ssize_t>(stream.size())) {
+            throw std::runtime_error("Failed to read " + path + " at offset " + std::to_string(entry.offset));
+        }
+        std::vector<std::pair<int, int>> edges(header.num_edges);
+        decode_edges(stream.data(), stream.size(), header.num_edges, edges.data());
+        write_binary_edgelist(edgelist_path, edges);
+    } else {
+        copy_range(fd, entry.offset, edges_length, path, edgelist_path);
+    }
+    copy_range(fd, entry.offset + edges_length, entry.length - edges_length, path, cluster_path);
+}
@@ -0,0 +1,326 @@
+#include <compressed_input.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#ifdef DCC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef DCC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Decompressed block size, and blocks decompressed ahead of the parser
+constexpr size_t BLOCK_SIZE = 1 << 20;
+constexpr size_t QUEUE_BLOCKS = 4;
+
+// Past the own frames only the rest of a line is needed, so decompress in small steps
+constexpr size_t BEYOND_BLOCK_SIZE = 64 << 10;
+
+void require_support(Compression compression, const std::string& filepath) {
+    if (!compression_supported(compression)) {
+        throw std::runtime_error(filepath + " is " + compression_name(compression) +
+                                 "-compressed, but this build has no " + compression_name(compression) + " support");
+    }
+}
+
+/**
+ * Incremental decoder of one compressed stream. produce() decodes from [in, in_end) into
+ * out, advancing in, and returns the bytes written; at_end() tells whether the input seen
+ * so far ends on a complete frame.
+ */
+class Decoder {
+public:
+    virtual ~Decoder() = default;
+    virtual size_t produce(const char*& in, const char* in_end, char* out, size_t capacity) = 0;
+    virtual bool at_end() const = 0;
+};
+
+#ifdef DCC_HAVE_ZLIB
+class GzipDecoder : public Decoder {
+private:
+    z_stream stream{};
+    bool ended = false;
+    std::string filepath;
+
+public:
+    explicit GzipDecoder(const std::string& filepath) : filepath(filepath) {
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+            throw std::runtime_error("Failed to initialize gzip decompression for " + filepath);
+        }
+    }
+
+    ~GzipDecoder() override { inflateEnd(&stream); }
+
+    size_t produce(const char*& in, const char* in_end, char* out, size_t capacity) override {
+        if (ended) {
+            if (in == in_end) return 0;
+            // Concatenated gzip members (e.g. from pigz or cat) form one stream
+            inflateReset(&stream);
+            ended = false;
+        }
+        size_t available = std::min<size_t>(in_end - in, std::numeric_limits<uInt>::max());
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        stream.avail_in = static_cast<uInt>(available);
+        stream.next_out = reinterpret_cast<Bytef*>(out);
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(capacity, std::numeric_limits<uInt>::max()));
+        uInt out_capacity = stream.avail_out;
+        int status = inflate(&stream, Z_NO_FLUSH);
+        in += available - stream.avail_in;
+        size_t produced = out_capacity - stream.avail_out;
+        if (status == Z_STREAM_END) {
+            ended = true;
+        } else if (status != Z_OK && !(status == Z_BUF_ERROR && produced == 0)) {
+            throw std::runtime_error("Corrupt gzip data in " + filepath + ": " +
+                                     (stream.msg ? stream.msg : "error " + std::to_string(status)));
+        }
+        return produced;
+    }
+
+    bool at_end() const override { return ended; }
+};
+#endif
+
+#ifdef DCC_HAVE_ZSTD
+class ZstdDecoder : public Decoder {
+private:
+    ZSTD_DStream* stream;
+    size_t hint = 0;            // 0 once the current frame is fully decoded and flushed
+    std::string filepath;
+
+public:
+    explicit ZstdDecoder(const std::string& filepath) : stream(ZSTD_createDStream()), filepath(filepath) {
+        if (!stream || ZSTD_isError(ZSTD_initDStream(stream))) {
+            ZSTD_freeDStream(stream);
+            throw std::runtime_error("Failed to initialize zstd decompression for " + filepath);
+        }
+    }
+
+    ~ZstdDecoder() override { ZSTD_freeDStream(stream); }
+
+    size_t produce(const char*& in, const char* in_end, char* out, size_t capacity) override {
+        if (in == in_end && hint == 0) return 0;    // past the last frame nothing is pending
+        ZSTD_inBuffer input{in, static_cast<size_t>(in_end - in), 0};
+        ZSTD_outBuffer output{out, capacity, 0};
+        hint = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(hint)) {
+            throw std::runtime_error("Corrupt zstd data in " + filepath + ": " + ZSTD_getErrorName(hint));
+        }
+        in += input.pos;
+        return output.pos;
+    }
+
+    bool at_end() const override { return hint == 0; }
+};
+#endif
+
+std::unique_ptr<Decoder> make_decoder(Compression compression, const std::string& filepath) {
+    require_support(compression, filepath);
+#ifdef DCC_HAVE_ZLIB
+    if (compression == Compression::Gzip) return std::make_unique<GzipDecoder>(filepath);
+#endif
+#ifdef DCC_HAVE_ZSTD
+    if (compression == Compression::Zstd) return std::make_unique<ZstdDecoder>(filepath);
+#endif
+    throw std::runtime_error("Not a compressed input: " + filepath);
+}
+
+}  // namespace
+
+Compression detect_compression(const char* data, size_t size) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b) return Compression::Gzip;
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+        return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+Compression file_compression(const std::string& filepath) {
+    char magic[4];
+    std::ifstream in(filepath, std::ios::binary);
+    in.read(magic, sizeof(magic));
+    return detect_compression(magic, static_cast<size_t>(in.gcount()));
+}
+
+const char* compression_name(Compression compression) {
+    switch (compression) {
+        case Compression::Gzip: return "gzip";
+        case Compression::Zstd: return "zstd";
+        default: return "uncompressed";
+    }
+}
+
+bool compression_supported(Compression compression) {
+    switch (compression) {
+        case Compression::None: return true;
+#ifdef DCC_HAVE_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef DCC_HAVE_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+std::string strip_compression_suffix(const std::string& path) {
+    for (const char* suffix : {".gz", ".zst"}) {
+        if (has_suffix(path, suffix)) return path.substr(0, path.size() - std::strlen(suffix));
+    }
+    return path;
+}
+
+std::vector<size_t> frame_offsets(Compression compression, const char* data, size_t size,
+                                  const std::string& filepath) {
+    std::vector<size_t> offsets{0};
+#ifdef DCC_HAVE_ZSTD
+    if (compression == Compression::Zstd) {
+        size_t offset = 0;
+        while (offset < size) {
+            size_t frame_size = ZSTD_findFrameCompressedSize(data + offset, size - offset);
+            if (ZSTD_isError(frame_size)) {
+                throw std::runtime_error("Corrupt zstd frame in " + filepath + " at byte " + std::to_string(offset) +
+                                         ": " + ZSTD_getErrorName(frame_size));
+            }
+            offset += frame_size;
+            if (offset < size) offsets.push_back(offset);
+        }
+    }
+#else
+    (void)compression, (void)data, (void)size, (void)filepath;
+#endif
+    return offsets;
+}
+
+struct DecompressStream::State {
+    struct Block {
+        std::string data;
+        bool own;
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Block> queue;
+    Block current;
+    bool waiting = false;       // the consumer is blocked in next()
+    bool done = false;
+    bool stop = false;
+    std::exception_ptr error;
+    std::thread producer;
+
+    // Hand a block to the consumer; false once the consumer is gone
+    bool push(Block block) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (block.own) {
+            changed.wait(lock, [&] { return stop || queue.size() < QUEUE_BLOCKS; });
+        } else {
+            changed.wait(lock, [&] { return stop || (queue.empty() && waiting); });
+        }
+        if (stop) return false;
+        queue.push_back(std::move(block));
+        changed.notify_all();
+        return true;
+    }
+
+    // Decode [in, in_end) into blocks; false once the consumer is gone
+    bool decode(Decoder& decoder, const char* in, const char* in_end, bool own, const std::string& filepath) {
+        size_t block_size = own ? BLOCK_SIZE : BEYOND_BLOCK_SIZE;
+        Block block{std::string(block_size, '\0'), own};
+        size_t filled = 0;
+        while (true) {
+            size_t produced = decoder.produce(in, in_end, block.data.data() + filled, block_size - filled);
+            filled += produced;
+            bool finished = in == in_end && produced == 0;
+            if (filled == block_size || (finished && filled > 0)) {
+                block.data.resize(filled);
+                if (!push(std::move(block))) return false;
+                block = Block{std::string(block_size, '\0'), own};
+                filled = 0;
+            }
+            if (finished) break;
+        }
+        if (!decoder.at_end()) {
+            throw std::runtime_error("Truncated " + filepath + " (compressed stream ends mid-frame)");
+        }
+        return true;
+    }
+};
+
+DecompressStream::DecompressStream(Compression compression, const char* begin, const char* own_end,
+                                   const char* stream_end, const std::string& filepath)
+    : state(new State) {
+    std::unique_ptr<Decoder> decoder;
+    try {
+        decoder = make_decoder(compression, filepath);
+    } catch (...) {
+        delete state;
+        throw;
+    }
+    state->producer = std::thread([state = state, begin, own_end, stream_end, filepath, decoder = std::move(decoder)]() {
+        try {
+            if (state->decode(*decoder, begin, own_end, true, filepath)) {
+                state->decode(*decoder, own_end, stream_end, false, filepath);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->done = true;
+        state->changed.notify_all();
+    });
+}
+
+DecompressStream::~DecompressStream() {
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stop = true;
+        state->changed.notify_all();
+    }
+    state->producer.join();
+    delete state;
+}
+
+bool DecompressStream::next(const char*& data, size_t& size, bool& own) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->waiting = true;
+    state->changed.notify_all();
+    state->changed.wait(lock, [&] { return !state->queue.empty() || state->done; });
+    state->waiting = false;
+    if (state->queue.empty()) {
+        if (state->error) std::rethrow_exception(state->error);
+        return false;
+    }
+    state->current = std::move(state->queue.front());
+    state->queue.pop_front();
+    state->changed.notify_all();
+    data = state->current.data.data();
+    size = state->current.data.size();
+    own = state->current.own;
+    return true;
+}
+
+std::string decompress_prefix(Compression compression, const char* data, size_t size, size_t max_bytes,
+                              const std::string& filepath) {
+    std::unique_ptr<Decoder> decoder = make_decoder(compression, filepath);
+    std::string prefix(max_bytes, '\0');
+    size_t filled = 0;
+    const char* in = data;
+    while (filled < max_bytes) {
+        size_t produced = decoder->produce(in, data + size, prefix.data() + filled, max_bytes - filled);
+        filled += produced;
+        if (in == data + size && produced == 0) break;
+    }
+    prefix.resize(filled);
+    return prefix;
+}
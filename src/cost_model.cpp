@@ -0,0 +1,210 @@
+#include <cost_model.hpp>
+#include <hash.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* MODEL_FORMAT_VERSION = "cost-model-v2";
+
+// Seed of fingerprint(), kept apart from the file format: only the runtime fit affects
+// batching, so a format change must not invalidate cached partitions
+constexpr const char* FINGERPRINT_TAG = "cost-model-v1";
+
+// Ridge penalty per sample on every weight but the intercept
+constexpr double RIDGE = 1e-3;
+
+}  // namespace
+
+template <int D>
+void RidgeFit<D>::add(const std::array<double, D>& x, double y) {
+    for (int i = 0; i < D; ++i) {
+        for (int j = 0; j < D; ++j) xtx[i * D + j] += x[i] * x[j];
+        xty[i] += x[i] * y;
+    }
+    yty += y * y;
+    ++samples;
+}
+
+template <int D>
+void RidgeFit<D>::fit(double ridge) {
+    // Cholesky factorization of X'X + ridge, then two triangular solves
+    std::array<double, D * D> lower{};
+    for (int i = 0; i < D; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            double sum = xtx[i * D + j] + (i == j && i > 0 ? ridge * samples : 0.0);
+            for (int k = 0; k < j; ++k) sum -= lower[i * D + k] * lower[j * D + k];
+            if (i == j) {
+                if (!(sum > 0)) return;     // degenerate samples, keep the current prediction
+                lower[i * D + i] = std::sqrt(sum);
+            } else {
+                lower[i * D + j] = sum / lower[j * D + j];
+            }
+        }
+    }
+    std::array<double, D> z{};
+    for (int i = 0; i < D; ++i) {
+        double sum = xty[i];
+        for (int k = 0; k < i; ++k) sum -= lower[i * D + k] * z[k];
+        z[i] = sum / lower[i * D + i];
+    }
+    for (int i = D - 1; i >= 0; --i) {
+        double sum = z[i];
+        for (int k = i + 1; k < D; ++k) sum -= lower[k * D + i] * weights[k];
+        weights[i] = sum / lower[i * D + i];
+    }
+
+    // Residual sum of squares: y'y - 2 w'X'y + w'X'Xw
+    double residual = yty;
+    for (int i = 0; i < D; ++i) {
+        residual -= 2 * weights[i] * xty[i];
+        for (int j = 0; j < D; ++j) residual += weights[i] * xtx[i * D + j] * weights[j];
+    }
+    residual_sd = std::sqrt(std::max(residual, 0.0) / std::max<int64_t>(1, samples - D));
+    fitted = true;
+}
+
+template <int D>
+double RidgeFit<D>::predict(const std::array<double, D>& x) const {
+    double y = 0;
+    for (int i = 0; i < D; ++i) y += weights[i] * x[i];
+    return y;
+}
+
+template struct RidgeFit<CostModel::RUNTIME_FEATURES>;
+template struct RidgeFit<CostModel::MEMORY_FEATURES>;
+
+CostModel::CostModel(const std::string& path, const std::string& method, const std::string& mincut_type)
+    : path(path), wcc(method == "WCC"), noi(mincut_type == "noi") {
+    std::ifstream in(path);
+    if (path.empty() || !in) return;
+
+    auto fail = [&]() { throw std::runtime_error("Failed to parse cost model " + path); };
+    auto read_values = [&](const char* name, auto& values) {
+        std::string token;
+        if (!(in >> token) || token != name) fail();
+        for (double& value : values) {
+            if (!(in >> value)) fail();
+        }
+    };
+    auto read_value = [&](const char* name, auto& value) {
+        std::string token;
+        if (!(in >> token >> value) || token != name) fail();
+    };
+
+    std::string version;
+    if (!(in >> version) || version != MODEL_FORMAT_VERSION) fail();
+    read_value("samples", runtime.samples);
+    read_value("heuristic_sum", heuristic_sum);
+    read_value("seconds_sum", seconds_sum);
+    read_values("xtx", runtime.xtx);
+    read_values("xty", runtime.xty);
+    read_value("yty", runtime.yty);
+    read_value("memory_samples", memory.samples);
+    read_values("memory_xtx", memory.xtx);
+    read_values("memory_xty", memory.xty);
+    read_value("memory_yty", memory.yty);
+    fit();
+}
+
+float CostModel::heuristic(int node_count, int64_t edge_count) {
+    double density = (2.0 * edge_count) / ((double)node_count * (node_count - 1));
+    return node_count + (1.0f / density);
+}
+
+std::array<double, CostModel::RUNTIME_FEATURES> CostModel::runtime_features(int node_count, int64_t edge_count) const {
+    double n = std::max(node_count, 2);
+    double density = std::clamp(2.0 * static_cast<double>(edge_count) / (n * (n - 1)), 1e-9, 1.0);
+    double log_n = std::log(n);
+    double log_density = std::log(density);
+    return {1.0, log_n, log_density, log_n * log_n, log_n * log_density, wcc ? 1.0 : 0.0, noi ? 1.0 : 0.0};
+}
+
+std::array<double, CostModel::MEMORY_FEATURES> CostModel::memory_features(int node_count, int64_t edge_count) {
+    // Memory grows about linearly with the graph, so this fit is on MB rather than its log
+    return {1.0, node_count / 1e3, static_cast<double>(edge_count) / 1e3};
+}
+
+double CostModel::predict_seconds(int node_count, int64_t edge_count) const {
+    if (!runtime.fitted) return -1;
+    return std::exp(runtime.predict(runtime_features(node_count, edge_count)));
+}
+
+float CostModel::cost(int node_count, int64_t edge_count) const {
+    if (!runtime.fitted) return heuristic(node_count, edge_count);
+    return static_cast<float>(scale * predict_seconds(node_count, edge_count));
+}
+
+double CostModel::predict_memory_mb(int node_count, int64_t edge_count) const {
+    if (!memory.fitted) return -1;
+    return std::max(0.0, memory.predict(memory_features(node_count, edge_count)) + MEMORY_MARGIN_SD * memory.residual_sd);
+}
+
+void CostModel::observe_runtime(int node_count, int64_t edge_count, double wall_seconds) {
+    double estimate = heuristic(node_count, edge_count);
+    if (!std::isfinite(estimate) || !(wall_seconds >= 0)) return;
+
+    runtime.add(runtime_features(node_count, edge_count), std::log(std::max(wall_seconds, MIN_SECONDS)));
+    heuristic_sum += estimate;
+    seconds_sum += std::max(wall_seconds, MIN_SECONDS);
+}
+
+void CostModel::observe_memory(int node_count, int64_t edge_count, double peak_memory_mb) {
+    if (!(peak_memory_mb >= 0)) return;
+    memory.add(memory_features(node_count, edge_count), peak_memory_mb);
+}
+
+void CostModel::fit() {
+    if (runtime.samples >= MIN_SAMPLES) {
+        runtime.fit(RIDGE);
+        if (runtime.fitted) scale = heuristic_sum / seconds_sum;
+    }
+    if (memory.samples >= MIN_SAMPLES) memory.fit(RIDGE);
+}
+
+void CostModel::save() const {
+    if (path.empty()) return;
+    std::string staging = path + ".tmp";
+    {
+        std::ofstream out(staging);
+        if (!out) {
+            throw std::runtime_error("Failed to write cost model " + path);
+        }
+        char buffer[32];
+        auto number = [&](double value) {
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+            return std::string(buffer);
+        };
+        auto values = [&](const char* name, const auto& array) {
+            out << name;
+            for (double value : array) out << " " << number(value);
+            out << "\n";
+        };
+        out << MODEL_FORMAT_VERSION << "\n";
+        out << "samples " << runtime.samples << "\n";
+        out << "heuristic_sum " << number(heuristic_sum) << "\n";
+        out << "seconds_sum " << number(seconds_sum) << "\n";
+        values("xtx", runtime.xtx);
+        values("xty", runtime.xty);
+        out << "yty " << number(runtime.yty) << "\n";
+        out << "memory_samples " << memory.samples << "\n";
+        values("memory_xtx", memory.xtx);
+        values("memory_xty", memory.xty);
+        out << "memory_yty " << number(memory.yty) << "\n";
+    }
+    fs::rename(staging, path);
+}
+
+uint64_t CostModel::fingerprint() const {
+    if (!runtime.fitted) return 0;
+    uint64_t hash = fnv1a64(std::string(FINGERPRINT_TAG));
+    for (double weight : runtime.weights) hash = hash_combine(hash, weight);
+    hash = hash_combine(hash, scale);
+    hash = hash_combine(hash, wcc);
+    return hash_combine(hash, noi);
+}
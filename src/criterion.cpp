@@ -0,0 +1,75 @@
+#include <criterion.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+ConnectednessCriterion::ConnectednessCriterion(const std::string& expression) {
+    auto parse_number = [&](const std::string& text, double fallback) {
+        if (text.empty()) return fallback;
+        size_t used = 0;
+        double value = std::stod(text, &used);
+        if (used != text.size()) throw std::invalid_argument(text);
+        return value;
+    };
+
+    try {
+        size_t log_at = expression.find("log_");
+        size_t power_at = expression.find("n^");
+        if (log_at != std::string::npos && expression.size() > log_at + 7 &&
+            expression.compare(expression.size() - 3, 3, "(n)") == 0) {
+            logarithmic = true;
+            constant = parse_number(expression.substr(0, log_at), 1);
+            base_or_exponent = parse_number(expression.substr(log_at + 4, expression.size() - 3 - (log_at + 4)), 10);
+        } else if (power_at != std::string::npos) {
+            logarithmic = false;
+            constant = parse_number(expression.substr(0, power_at), 1);
+            base_or_exponent = parse_number(expression.substr(power_at + 2), 1);
+        } else {
+            throw std::invalid_argument(expression);
+        }
+    } catch (const std::logic_error&) {
+        throw std::invalid_argument("Connectedness criterion must be Clog_x(n) or Cn^x: " + expression);
+    }
+}
+
+double ConnectednessCriterion::threshold(int64_t node_count) const {
+    double n = static_cast<double>(node_count);
+    return logarithmic ? constant * std::log(n) / std::log(base_or_exponent)
+                       : constant * std::pow(n, base_or_exponent);
+}
+
+Certificate certify_cluster(const ConnectednessCriterion& criterion, std::span<const int32_t> members,
+                            std::span<const std::pair<int, int>> edges) {
+    int64_t n = static_cast<int64_t>(members.size());
+    int64_t m = static_cast<int64_t>(edges.size());
+    if (n < 2) return Certificate::None;
+    double threshold = criterion.threshold(n);
+
+    auto local_id = [&](int node) {
+        return std::lower_bound(members.begin(), members.end(), node) - members.begin();
+    };
+    std::vector<int64_t> degree(n, 0);
+    for (const auto& [source, target] : edges) {
+        ++degree[local_id(source)];
+        ++degree[local_id(target)];
+    }
+    int64_t min_degree = *std::min_element(degree.begin(), degree.end());
+
+    // Upper bound on the edge connectivity
+    int64_t bound = min_degree;
+    if (m < n - 1) bound = 0;
+    else if (m == n - 1) bound = std::min<int64_t>(bound, 1);
+    if (bound < threshold) return Certificate::Fail;
+    if (2 * min_degree < n || min_degree <= threshold) return Certificate::None;
+
+    // Dirac-type bound: exact only on a simple graph
+    std::vector<std::pair<int, int>> canonical(edges.begin(), edges.end());
+    for (auto& [source, target] : canonical) {
+        if (source == target) return Certificate::None;
+        if (source > target) std::swap(source, target);
+    }
+    std::sort(canonical.begin(), canonical.end());
+    if (std::adjacent_find(canonical.begin(), canonical.end()) != canonical.end()) return Certificate::None;
+    return Certificate::Pass;
+}
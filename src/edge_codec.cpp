@@ -0,0 +1,141 @@
+#include <edge_codec.hpp>
+#include <mapped_file.hpp>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+
+// Largest varint stream of one edge: two 33-bit values at 7 bits per byte
+constexpr size_t MAX_EDGE_BYTES = 10;
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline size_t varint_length(uint64_t value) {
+    size_t length = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++length;
+    }
+    return length;
+}
+
+inline uint8_t* put_varint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+inline const uint8_t* get_varint(const uint8_t* data, const uint8_t* end, uint64_t& value) {
+    if (data < end && *data < 0x80) {   // most deltas fit in one byte
+        value = *data;
+        return data + 1;
+    }
+    value = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7) {
+        uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) return data;
+    }
+    throw std::runtime_error("Truncated compressed edge list");
+}
+
+// Visit the (source delta, target code) values of sorted edges
+template <typename Visit>
+void for_each_code(const std::vector<std::pair<int, int>>& edges, Visit&& visit) {
+    int64_t previous_source = INT32_MIN;
+    int64_t previous_target = 0;
+    for (const auto& [source, target] : edges) {
+        uint64_t source_delta = static_cast<uint64_t>(source - previous_source);
+        uint64_t target_code = source_delta == 0 ? static_cast<uint64_t>(target - previous_target)
+                                                 : zigzag(static_cast<int64_t>(target) - source);
+        visit(source_delta, target_code);
+        previous_source = source;
+        previous_target = target;
+    }
+}
+
+}  // namespace
+
+bool is_compressed_edges(const void* data, size_t size) {
+    return size >= sizeof(CompressedEdgesHeader) && std::memcmp(data, CEDGELIST_MAGIC, sizeof(CEDGELIST_MAGIC)) == 0;
+}
+
+uint64_t compressed_edges_length(std::vector<std::pair<int, int>>& edges) {
+    std::sort(edges.begin(), edges.end());
+    uint64_t length = sizeof(CompressedEdgesHeader);
+    for_each_code(edges, [&](uint64_t source_delta, uint64_t target_code) {
+        length += varint_length(source_delta) + varint_length(target_code);
+    });
+    return length;
+}
+
+void encode_edges(std::vector<std::pair<int, int>>& edges, std::vector<uint8_t>& out) {
+    std::sort(edges.begin(), edges.end());
+    size_t header_at = out.size();
+    out.resize(header_at + sizeof(CompressedEdgesHeader) + edges.size() * MAX_EDGE_BYTES);
+    uint8_t* stream = out.data() + header_at + sizeof(CompressedEdgesHeader);
+    uint8_t* cursor = stream;
+    for_each_code(edges, [&](uint64_t source_delta, uint64_t target_code) {
+        cursor = put_varint(cursor, source_delta);
+        cursor = put_varint(cursor, target_code);
+    });
+
+    CompressedEdgesHeader header{};
+    std::memcpy(header.magic, CEDGELIST_MAGIC, sizeof(header.magic));
+    header.num_edges = edges.size();
+    header.encoded_bytes = static_cast<uint64_t>(cursor - stream);
+    std::memcpy(out.data() + header_at, &header, sizeof(header));
+    out.resize(static_cast<size_t>(cursor - out.data()));
+}
+
+void decode_edges(const uint8_t* data, size_t length, uint64_t num_edges, std::pair<int, int>* out) {
+    const uint8_t* end = data + length;
+    int64_t source = INT32_MIN;
+    int64_t target = 0;
+    for (uint64_t i = 0; i < num_edges; ++i) {
+        uint64_t source_delta, target_code;
+        data = get_varint(data, end, source_delta);
+        data = get_varint(data, end, target_code);
+        source += static_cast<int64_t>(source_delta);
+        target = source_delta == 0 ? target + static_cast<int64_t>(target_code) : source + unzigzag(target_code);
+        out[i] = {static_cast<int>(source), static_cast<int>(target)};
+    }
+}
+
+void write_compressed_edgelist(const std::string& filepath, std::vector<std::pair<int, int>>& edges) {
+    std::vector<uint8_t> image;
+    encode_edges(edges, image);
+    std::ofstream out(filepath, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open compressed edgelist for writing: " + filepath);
+    }
+    out.write(reinterpret_cast<const char*>(image.data()), image.size());
+}
+
+std::vector<std::pair<int, int>> read_compressed_edgelist(const std::string& filepath) {
+    MappedFile mapped(filepath, "compressed edgelist");
+    CompressedEdgesHeader header;
+    if (!is_compressed_edges(mapped.data(), mapped.size())) {
+        throw std::runtime_error("Not a compressed edgelist: " + filepath);
+    }
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (sizeof(header) + header.encoded_bytes > mapped.size()) {
+        throw std::runtime_error("Truncated compressed edgelist: " + filepath);
+    }
+
+    std::vector<std::pair<int, int>> edges(header.num_edges);
+    decode_edges(reinterpret_cast<const uint8_t*>(mapped.data()) + sizeof(header), header.encoded_bytes,
+                 header.num_edges, edges.data());
+    return edges;
+}
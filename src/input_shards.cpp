@@ -0,0 +1,196 @@
+#include <input_shards.hpp>
+#include <utils.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <cstring>
+#include <glob.h>
+namespace fs = std::filesystem;
+
+namespace {
+
+// Decompressed bytes read to detect the delimiter of a compressed shard
+constexpr size_t DELIMITER_PREFIX = 64 << 10;
+
+bool has_glob_pattern(const std::string& input) {
+    std::error_code ec;
+    return input.find_first_of("*?[") != std::string::npos && !fs::exists(input, ec);
+}
+
+// Shard data treated as part of one stream: text after the header, or binary records
+struct ShardData {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    char delimiter = ',';
+    const int32_t* pairs = nullptr;
+    uint64_t num_records = 0;
+    Compression compression = Compression::None;
+    std::vector<size_t> frames;     // offsets of the compressed frames
+
+    uint64_t size() const { return pairs ? num_records * 2 * sizeof(int32_t) : static_cast<uint64_t>(end - begin); }
+};
+
+// Start of the first line of [begin, end) that starts at or after at
+const char* line_start(const char* begin, const char* end, const char* at) {
+    if (at <= begin || at >= end || at[-1] == '\n') return at;
+    const char* newline = static_cast<const char*>(std::memchr(at, '\n', end - at));
+    return newline ? newline + 1 : end;
+}
+
+uint64_t scale(uint64_t total, uint64_t numerator, uint64_t denominator) {
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(total) * numerator / denominator);
+}
+
+}  // namespace
+
+std::vector<std::string> expand_input(const std::string& input) {
+    std::vector<std::string> shards;
+    std::error_code ec;
+    if (fs::is_directory(input, ec)) {
+        for (const auto& entry : fs::directory_iterator(input)) {
+            std::string name = entry.path().filename().string();
+            if (name.empty() || name[0] == '.' || name[0] == '_' || !entry.is_regular_file()) continue;
+            shards.push_back(entry.path().string());
+        }
+        std::sort(shards.begin(), shards.end());
+    } else if (has_glob_pattern(input)) {
+        glob_t matches;
+        if (glob(input.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                if (fs::is_regular_file(matches.gl_pathv[i], ec)) shards.emplace_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    } else {
+        shards.push_back(input);    // a missing file is reported when it is opened
+    }
+
+    if (shards.empty()) {
+        throw std::runtime_error("No input files match " + input);
+    }
+    return shards;
+}
+
+bool is_sharded_input(const std::string& input) {
+    std::error_code ec;
+    return fs::is_directory(input, ec) || has_glob_pattern(input);
+}
+
+bool input_exists(const std::string& input) {
+    if (!is_sharded_input(input)) return fs::exists(input);
+    try {
+        return !expand_input(input).empty();
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+InputShards::InputShards(const std::string& input, BinaryKind kind, int part, int num_parts, int num_chunks,
+                         const std::string& description)
+    : paths(expand_input(input)) {
+    // A slice of a shared input is only read partially, so map it lazily
+    std::vector<ShardData> shards(paths.size());
+    uint64_t total = 0;
+    for (size_t s = 0; s < paths.size(); ++s) {
+        files.push_back(std::make_unique<MappedFile>(paths[s], description, num_parts == 1));
+        const MappedFile& file = *files.back();
+        ShardData& shard = shards[s];
+        if (file.size() == 0) continue;
+
+        const std::string& path = paths[s];
+        Compression compression = detect_compression(file.data(), file.size());
+        std::string name = compression == Compression::None ? path : strip_compression_suffix(path);
+        bool binary = kind == BinaryKind::Edgelist ? is_binary_edgelist(name) : is_binary_cluster(name);
+        if (compression != Compression::None) {
+            if (binary) {
+                throw std::runtime_error("Compressed binary inputs are not supported: " + path);
+            }
+            std::string prefix = decompress_prefix(compression, file.data(), file.size(), DELIMITER_PREFIX, path);
+            if (prefix.empty()) continue;
+            shard.compression = compression;
+            shard.frames = frame_offsets(compression, file.data(), file.size(), path);
+            shard.delimiter = detect_delimiter(prefix.data(), prefix.data() + prefix.size(), path);
+            shard.begin = file.data();
+            shard.end = file.end();
+        } else if (binary) {
+            BinaryView view = view_binary(file.data(), file.end(), kind, paths[s]);
+            shard.pairs = view.pairs;
+            shard.num_records = view.num_records;
+        } else {
+            shard.delimiter = detect_delimiter(file.data(), file.end(), paths[s]);
+            shard.begin = skip_header(file.data(), file.end());
+            shard.end = file.end();
+        }
+        total += shard.size();
+    }
+    if (total == 0) return;
+
+    // This part's slice of the stream, and each shard's share of it
+    uint64_t slice_first = scale(total, part, num_parts);
+    uint64_t slice_last = scale(total, part + 1, num_parts);
+    uint64_t slice_size = std::max<uint64_t>(1, slice_last - slice_first);
+    uint64_t shard_first = 0;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        const ShardData& shard = shards[s];
+        uint64_t size = shard.size();
+        uint64_t from = std::max(slice_first, shard_first) - shard_first;
+        uint64_t to = std::min(slice_last, shard_first + size);
+        to = to > shard_first ? to - shard_first : 0;
+        shard_first += size;
+        if (from >= to) continue;
+
+        size_t pieces = std::max<uint64_t>(1, scale(num_chunks, to - from, slice_size));
+        if (shard.pairs) {
+            constexpr uint64_t record_size = 2 * sizeof(int32_t);
+            uint64_t first = (from + record_size - 1) / record_size;
+            uint64_t last = std::min(shard.num_records, (to + record_size - 1) / record_size);
+            if (first >= last) continue;
+            pieces = std::min<uint64_t>(pieces, last - first);
+            for (size_t i = 0; i < pieces; ++i) {
+                InputChunk chunk;
+                chunk.shard = s;
+                chunk.pairs = shard.pairs;
+                chunk.first = first + scale(last - first, i, pieces);
+                chunk.last = first + scale(last - first, i + 1, pieces);
+                input_chunks.push_back(chunk);
+            }
+        } else if (shard.compression != Compression::None) {
+            // Frames starting in [from, to), grouped into pieces of about equal compressed size
+            const std::vector<size_t>& frames = shard.frames;
+            size_t first = std::lower_bound(frames.begin(), frames.end(), from) - frames.begin();
+            size_t last = std::lower_bound(frames.begin(), frames.end(), to) - frames.begin();
+            if (first >= last) continue;
+            auto offset = [&](size_t frame) { return frame < frames.size() ? frames[frame] : shard.size(); };
+            uint64_t span = offset(last) - frames[first];
+            size_t group_first = first;
+            for (size_t i = 1; i <= pieces && group_first < last; ++i) {
+                uint64_t boundary = frames[first] + scale(span, i, pieces);
+                size_t group_last = i == pieces ? last
+                    : std::lower_bound(frames.begin() + group_first + 1, frames.begin() + last, boundary) - frames.begin();
+                if (group_last <= group_first) continue;
+                InputChunk chunk;
+                chunk.shard = s;
+                chunk.begin = shard.begin + frames[group_first];
+                chunk.end = shard.begin + offset(group_last);
+                chunk.stream_end = shard.end;
+                chunk.delimiter = shard.delimiter;
+                chunk.compression = shard.compression;
+                chunk.path = paths[s].c_str();
+                input_chunks.push_back(chunk);
+                group_first = group_last;
+            }
+        } else {
+            const char* begin = line_start(shard.begin, shard.end, shard.begin + from);
+            const char* end = line_start(shard.begin, shard.end, shard.begin + to);
+            if (begin >= end) continue;
+            for (const TextChunk& text : split_lines(begin, end, static_cast<int>(pieces))) {
+                InputChunk chunk;
+                chunk.shard = s;
+                chunk.begin = text.first;
+                chunk.end = text.second;
+                chunk.delimiter = shard.delimiter;
+                input_chunks.push_back(chunk);
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include <job_queue.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+void JobQueue::sift_up(size_t position) {
+    HeapEntry entry = heap[position];
+    while (position > 0) {
+        size_t parent = (position - 1) / ARITY;
+        if (!before(entry, heap[parent])) break;
+        place(position, heap[parent]);
+        position = parent;
+    }
+    place(position, entry);
+}
+
+void JobQueue::sift_down(size_t position) {
+    HeapEntry entry = heap[position];
+    size_t size = heap.size();
+    while (true) {
+        size_t first = position * ARITY + 1;
+        if (first >= size) break;
+        size_t last = std::min(first + ARITY, size);
+        size_t best = first;
+        for (size_t child = first + 1; child < last; ++child) {
+            if (before(heap[child], heap[best])) best = child;
+        }
+        if (!before(heap[best], entry)) break;
+        place(position, heap[best]);
+        position = best;
+    }
+    place(position, entry);
+}
+
+void JobQueue::remove_at(size_t position) {
+    uint32_t slot = heap[position].slot;
+    index.erase(heap[position].cluster_id);
+    free_slots.push_back(slot);
+
+    HeapEntry last = heap.back();
+    heap.pop_back();
+    if (position == heap.size()) return;
+    place(position, last);
+    // The moved entry may belong above or below its new position
+    if (position > 0 && before(last, heap[(position - 1) / ARITY])) {
+        sift_up(position);
+    } else {
+        sift_down(position);
+    }
+}
+
+void JobQueue::reserve(size_t capacity) {
+    heap.reserve(capacity);
+    clusters.reserve(capacity);
+    positions.reserve(capacity);
+    index.reserve(capacity);
+}
+
+void JobQueue::clear() {
+    heap.clear();
+    clusters.clear();
+    positions.clear();
+    free_slots.clear();
+    index.clear();
+}
+
+void JobQueue::push(const ClusterInfo& cluster, float cost) {
+    uint32_t slot = free_slots.empty() ? static_cast<uint32_t>(clusters.size()) : free_slots.back();
+    if (!index.insert(cluster.cluster_id, slot)) {
+        throw std::runtime_error("Cluster " + std::to_string(cluster.cluster_id) + " is already queued");
+    }
+    if (free_slots.empty()) {
+        clusters.push_back(cluster);
+        positions.push_back(0);
+    } else {
+        free_slots.pop_back();
+        clusters[slot] = cluster;
+    }
+
+    heap.push_back({std::isnan(cost) ? 0.0f : cost, slot, cluster.cluster_id});
+    sift_up(heap.size() - 1);
+}
+
+ClusterInfo JobQueue::pop() {
+    ClusterInfo cluster = top();
+    remove_at(0);
+    return cluster;
+}
+
+bool JobQueue::erase(int64_t cluster_id) {
+    uint32_t slot = index.find(cluster_id);
+    if (slot == SlotIndex::NONE) return false;
+    remove_at(positions[slot]);
+    return true;
+}
+
+bool JobQueue::update(int64_t cluster_id, float cost) {
+    uint32_t slot = index.find(cluster_id);
+    if (slot == SlotIndex::NONE) return false;
+    size_t position = positions[slot];
+    float previous = heap[position].cost;
+    heap[position].cost = std::isnan(cost) ? 0.0f : cost;
+    if (heap[position].cost > previous) {
+        sift_up(position);
+    } else {
+        sift_down(position);
+    }
+    return true;
+}
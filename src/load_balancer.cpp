@@ -1,20 +1,45 @@
 #include <load_balancer.hpp>
 #include <utils.hpp>
 #include <constants.hpp>
+#include <mapped_file.hpp>
+#include <cluster_pack.hpp>
+#include <partition_cache.hpp>
+#include <input_shards.hpp>
+#include <message_engine.hpp>
+#include <parser.hpp>
 #include <unordered_map>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
 #include <set>
 #include <sstream>
 #include <fstream>
 #include <filesystem>
 #include <stdexcept>
-#include <cstring>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
 namespace fs = std::filesystem;
 
+namespace {
+
+// Queued clusters passed over per assignment for lack of memory before giving up on the worker
+constexpr size_t MAX_PASSED_OVER = 64;
+
+// Retries of an OOM-killed cluster, each asking for this factor more room than it reached
+constexpr int MAX_OOM_RETRIES = 2;
+constexpr double OOM_HEADROOM_FACTOR = 1.5;
+
+// Receives kept posted per message tag: up to one per worker, capped for the tags every
+// cluster sends on and for the rare ones
+constexpr int MAX_POSTED_RECEIVES = 32;
+constexpr int MAX_POSTED_RARE_RECEIVES = 4;
+
+// Longest the log goes unflushed while the run loop is busy
+constexpr std::chrono::milliseconds LOG_FLUSH_INTERVAL(1000);
+
+}  // namespace
+
 // Constructor
 LoadBalancer::LoadBalancer(const std::string& method,
                           const std::string& edgelist,
@@ -27,7 +52,9 @@ LoadBalancer::LoadBalancer(const std::string& method,
                           bool partition_only,
                           float min_batch_cost,
                           int drop_cluster_under,
-                          bool auto_accept_clique)
+                          bool auto_accept_clique,
+                          const PartitionOptions& partition_options,
+                          const CostModel& cost_model)
     : method(method),
       logger(work_dir + "/logs/load_balancer.log", log_level),
       work_dir(work_dir),
@@ -36,10 +63,12 @@ LoadBalancer::LoadBalancer(const std::string& method,
       min_batch_cost(min_batch_cost),
       drop_cluster_under(drop_cluster_under),
       auto_accept_clique(auto_accept_clique),
-      job_queue(CostCompare{this}) {
+      partition_options(partition_options),
+      cost_model(cost_model) {
 
-    const std::string clusters_dir = work_dir + "/" + "clusters";
-    std::string summary_filename = partitioned_clusters_dir + "/summary.csv";
+    // Partitions are written to (and loaded from) the pre-partitioned dir when one is given
+    const std::string clusters_dir = partitioned_clusters_dir.empty() ? work_dir + "/" + "clusters" : partitioned_clusters_dir;
+    std::string summary_filename = clusters_dir + "/summary.csv";
 
     logger.info("LoadBalancer initialization starting");
 
@@ -56,15 +85,32 @@ LoadBalancer::LoadBalancer(const std::string& method,
     logger.info("Min batch cost: " + std::to_string(min_batch_cost));
     logger.info("Drop cluster under: " + std::to_string(drop_cluster_under));
     logger.info("Auto accept clique: " + std::string(auto_accept_clique ? "true" : "false"));
+    logger.info("Partition threads: " + std::to_string(partition_options.num_threads));
+    logger.info("Partition memory limit (MB): " + std::to_string(partition_options.memory_limit_mb));
+    logger.info("Partition cache dir: " + partition_options.cache_dir);
+    logger.info("Cost model: " + (cost_model.file().empty() ? std::string("disabled") : cost_model.file()) + " (" +
+                std::to_string(cost_model.num_samples()) + " samples, " +
+                (cost_model.is_fitted() ? "fitted" : "using the node_count + 1/density heuristic") + ", " +
+                (cost_model.is_memory_fitted() ? "memory model fitted" : "no memory model yet") + ")");
 
     std::vector<ClusterInfo> created_clusters;
 
     // Phase 1: Load or partition clusters
     if (fs::exists(summary_filename)) {
-        logger.info("Loading pre-partitioned clusters from: " + partitioned_clusters_dir);
-        created_clusters = load_partitioned_clusters(partitioned_clusters_dir);
+        logger.info("Loading pre-partitioned clusters from: " + clusters_dir);
+        // A partition written with the cache enabled records its key; flag one made from other inputs
+        std::ifstream key_file(clusters_dir + "/" + PARTITION_KEY_FILE);
+        std::string stored_key;
+        if (!partition_options.cache_dir.empty() && std::getline(key_file, stored_key) &&
+            input_exists(edgelist) && input_exists(cluster_file) &&
+            stored_key != PartitionCache::partition_key(edgelist, cluster_file, min_batch_cost,
+                                                        drop_cluster_under, auto_accept_clique, partition_options)) {
+            logger.error("Pre-partitioned clusters in " + clusters_dir +
+                         " were made from different inputs or options (key " + stored_key + ")");
+        }
+        created_clusters = load_partitioned_clusters(clusters_dir);
     } else {
-        logger.info("Partitioning clustering into individual cluster files");
+        logger.info("Partitioning clustering into a packed cluster archive");
         created_clusters = partition_clustering(edgelist, cluster_file, clusters_dir);
     }
 
@@ -86,348 +132,26 @@ LoadBalancer::LoadBalancer(const std::string& method,
     logger.flush(); // flush when the program terminates normally
 }
 
-/** Helper methods */
-bool is_clique(int node_count, int64_t edge_count) {
-    return ((int64_t)node_count * (node_count - 1) / 2) == edge_count;
-}
-
-bool is_clique(ClusterInfo& cluster_info) {
-    return is_clique(cluster_info.node_count, cluster_info.edge_count);
-}
-
-// Bypass a cluster - write it directly to output without processing
-void LoadBalancer::bypass_cluster(const ClusterInfo& cluster_info, const std::set<int>& nodes) {
-    fs::create_directories(work_dir + "/output");
-
-    std::string filename = work_dir + "/output/bypass.out";
-    bool file_exists = fs::exists(filename);
-
-    std::ofstream out(filename, std::ios::app);
-
-    if (!out.is_open()) {
-        logger.error("Failed to create bypass output file: " + filename);
-        throw std::runtime_error("Failed to create bypass output file: " + filename);
-    }
-
-    if (!file_exists) {
-        out << "node_id,cluster_id\n";
-    }
-
-    for (const int node : nodes) {
-        out << node << "," << cluster_info.cluster_id << "\n";
-    }
-    out.close();
-
-    logger.info("Bypassed cluster " + std::to_string(cluster_info.cluster_id) +
-                " (nodes=" + std::to_string(cluster_info.node_count) + ")");
-}
-
 // Partition clustering into separate cluster files
 std::vector<ClusterInfo> LoadBalancer::partition_clustering(const std::string& edgelist,
                                                      const std::string& cluster_file,
                                                      const std::string& output_dir) {
-    logger.debug("Start partitioning initial clustering");
-    logger.debug(">> Edgelist: " + edgelist);
-    logger.debug(">> Clustering: " + cluster_file);
-    logger.debug(">> Output directory: " + output_dir);
-
-    std::vector<ClusterInfo> created_clusters;  // Track which clusters were created
-
-    // Read clustering file: node_id -> cluster_id
-    logger.debug("Reading clustering file...");
-    std::unordered_map<int, int> node_to_cluster;
-    std::unordered_map<int, std::set<int>> cluster_to_node;
-    std::unordered_map<int, ClusterInfo> clusters;
-
-    auto add_cluster_entry = [&](int node_id, int cluster_id) {
-        node_to_cluster[node_id] = cluster_id;
-        cluster_to_node[cluster_id].insert(node_id);
-        if (clusters.count(cluster_id)) {
-            ++clusters[cluster_id].node_count;
-        } else {
-            ClusterInfo info;
-            info.cluster_id = cluster_id;
-            info.node_count = 1;
-            info.edge_count = 0;
-            clusters.insert({cluster_id, info});
-        }
-    };
-
-    int clustering_lines = 0;
-    if (is_binary_cluster(cluster_file)) {
-        int fd = open(cluster_file.c_str(), O_RDONLY);
-        if (fd < 0) {
-            logger.error("Failed to open clustering file: " + cluster_file);
-            throw std::runtime_error("Failed to open clustering file: " + cluster_file);
-        }
-        struct stat st;
-        fstat(fd, &st);
-        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-        if (mapped == MAP_FAILED) {
-            close(fd);
-            throw std::runtime_error("mmap failed for clustering file: " + cluster_file);
-        }
-        madvise(mapped, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
-
-        const char* data = static_cast<const char*>(mapped);
-        uint32_t num_entries;
-        memcpy(&num_entries, data, sizeof(num_entries));
-        const int32_t* pairs = reinterpret_cast<const int32_t*>(data + sizeof(num_entries));
-        for (uint32_t i = 0; i < num_entries; ++i) {
-            add_cluster_entry(pairs[i * 2], pairs[i * 2 + 1]);
-            clustering_lines++;
-        }
-
-        munmap(mapped, st.st_size);
-        close(fd);
-    } else {
-        int fd = open(cluster_file.c_str(), O_RDONLY);
-        if (fd < 0) {
-            logger.error("Failed to open clustering file: " + cluster_file);
-            throw std::runtime_error("Failed to open clustering file: " + cluster_file);
-        }
-        struct stat st;
-        fstat(fd, &st);
-        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-        if (mapped == MAP_FAILED) {
-            close(fd);
-            throw std::runtime_error("mmap failed for clustering file: " + cluster_file);
-        }
-        madvise(mapped, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
-
-        const char* data = static_cast<const char*>(mapped);
-        const char* end = data + st.st_size;
-        char cluster_delimiter = get_delimiter(cluster_file);
-
-        // Skip header line
-        while (data < end && *data != '\n') ++data;
-        if (data < end) ++data;
-
-        while (data < end) {
-            // Parse node_id
-            int node_id = 0;
-            bool neg = false;
-            if (data < end && *data == '-') { neg = true; ++data; }
-            while (data < end && *data >= '0' && *data <= '9') {
-                node_id = node_id * 10 + (*data - '0');
-                ++data;
-            }
-            if (neg) node_id = -node_id;
-            if (data < end && *data == cluster_delimiter) ++data;
-
-            // Parse cluster_id
-            int cluster_id = 0;
-            neg = false;
-            if (data < end && *data == '-') { neg = true; ++data; }
-            while (data < end && *data >= '0' && *data <= '9') {
-                cluster_id = cluster_id * 10 + (*data - '0');
-                ++data;
-            }
-            if (neg) cluster_id = -cluster_id;
-
-            // Skip to next line
-            while (data < end && *data != '\n') ++data;
-            if (data < end) ++data;
-
-            add_cluster_entry(node_id, cluster_id);
-            clustering_lines++;
-        }
-
-        munmap(mapped, st.st_size);
-        close(fd);
-    }
-    logger.debug("Read " + std::to_string(clustering_lines) + " nodes in " +
-                std::to_string(clusters.size()) + " clusters");
-
-    // Create storage for edges per cluster
-    std::unordered_map<int, std::vector<std::pair<int, int>>> cluster_edges;
-
-    // Read edgelist and partition edges
-    logger.debug("Reading edgelist file...");
-    int64_t total_edges = 0;
-    int64_t intra_cluster_edges = 0;
-
-    auto add_edge = [&](int source, int target) {
-        total_edges++;
-        if (node_to_cluster.find(source) != node_to_cluster.end() &&
-            node_to_cluster.find(target) != node_to_cluster.end()) {
-            int source_cluster = node_to_cluster[source];
-            int target_cluster = node_to_cluster[target];
-            if (source_cluster == target_cluster) {
-                cluster_edges[source_cluster].emplace_back(source, target);
-                intra_cluster_edges++;
-            }
-        }
-    };
-
-    if (is_binary_edgelist(edgelist)) {
-        int fd = open(edgelist.c_str(), O_RDONLY);
-        if (fd < 0) {
-            logger.error("Failed to open edgelist file: " + edgelist);
-            throw std::runtime_error("Failed to open edgelist file: " + edgelist);
-        }
-        struct stat st;
-        fstat(fd, &st);
-        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-        if (mapped == MAP_FAILED) {
-            close(fd);
-            throw std::runtime_error("mmap failed for edgelist file: " + edgelist);
-        }
-        madvise(mapped, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
-
-        const char* data = static_cast<const char*>(mapped);
-        uint64_t num_edges;
-        memcpy(&num_edges, data, sizeof(num_edges));
-        const int32_t* pairs = reinterpret_cast<const int32_t*>(data + sizeof(num_edges));
-        for (uint64_t i = 0; i < num_edges; ++i) {
-            add_edge(pairs[i * 2], pairs[i * 2 + 1]);
-        }
-
-        munmap(mapped, st.st_size);
-        close(fd);
-    } else {
-        int fd = open(edgelist.c_str(), O_RDONLY);
-        if (fd < 0) {
-            logger.error("Failed to open edgelist file: " + edgelist);
-            throw std::runtime_error("Failed to open edgelist file: " + edgelist);
-        }
-        struct stat st;
-        fstat(fd, &st);
-        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-        if (mapped == MAP_FAILED) {
-            close(fd);
-            throw std::runtime_error("mmap failed for edgelist file: " + edgelist);
-        }
-        madvise(mapped, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
-
-        const char* data = static_cast<const char*>(mapped);
-        const char* end = data + st.st_size;
-        char edgelist_delimiter = get_delimiter(edgelist);
-
-        // Skip header line
-        while (data < end && *data != '\n') ++data;
-        if (data < end) ++data;
-
-        while (data < end) {
-            // Parse source
-            int source = 0;
-            bool neg = false;
-            if (data < end && *data == '-') { neg = true; ++data; }
-            while (data < end && *data >= '0' && *data <= '9') {
-                source = source * 10 + (*data - '0');
-                ++data;
-            }
-            if (neg) source = -source;
-            if (data < end && *data == edgelist_delimiter) ++data;
-
-            // Parse target
-            int target = 0;
-            neg = false;
-            if (data < end && *data == '-') { neg = true; ++data; }
-            while (data < end && *data >= '0' && *data <= '9') {
-                target = target * 10 + (*data - '0');
-                ++data;
-            }
-            if (neg) target = -target;
-
-            // Skip to next line
-            while (data < end && *data != '\n') ++data;
-            if (data < end) ++data;
-
-            add_edge(source, target);
-        }
-
-        munmap(mapped, st.st_size);
-        close(fd);
-    }
-    logger.debug("Read " + std::to_string(total_edges) + " edges, " +
-                std::to_string(intra_cluster_edges) + " intra-cluster edges");
-
-    // Write out cluster files to output_dir
-    logger.info("Writing cluster files to " + output_dir);
-    int files_written = 0;
-
-    float accumulated_cost = 0;
-    ClusterInfo batch_head_cluster_info{};
-    std::string output_edgelist;
-    std::string output_cluster_file;
-    std::vector<std::pair<int, int>> batch_edges;
-    std::vector<std::pair<int, int>> batch_cluster_entries;  // (node_id, cluster_id)
-    for (auto& [cluster_id, cluster_info] : clusters) {
-        int64_t edge_count = cluster_edges[cluster_id].size();
-        cluster_info.edge_count = edge_count;
-
-        // Clique bypass
-        if (auto_accept_clique && is_clique(cluster_info)) {
-            bypass_cluster(cluster_info, cluster_to_node[cluster_id]);
-            continue;
-        }
-
-        if (edge_count == 0) {
-            logger.debug("Dropping cluster " + std::to_string(cluster_id) +
-                " (no edges, nodes=" + std::to_string(cluster_info.node_count) + ")");
-            continue;
-        }
-        if (cluster_info.node_count < drop_cluster_under) {
-            logger.debug("Dropping cluster " + std::to_string(cluster_id) +
-                " (nodes=" + std::to_string(cluster_info.node_count) +
-                " < drop_cluster_under=" + std::to_string(drop_cluster_under) + ")");
-            continue;
-        }
-
-        // Batch very small clusters together, by min_batch_size
-        if (accumulated_cost == 0) {    // make new file only when we start to form a batch
-            batch_head_cluster_info = ClusterInfo{};
-            batch_head_cluster_info.cluster_id = cluster_id;    // form new batch head cluster
-
-            output_edgelist = output_dir + "/" + std::to_string(cluster_id) + ".bedgelist";
-            output_cluster_file = output_dir + "/" + std::to_string(cluster_id) + ".bcluster";
-
-            batch_edges.clear();
-            batch_cluster_entries.clear();
-        }
-
-        accumulated_cost += get_cost(cluster_info);
-        batch_head_cluster_info.node_count += cluster_info.node_count;
-        batch_head_cluster_info.edge_count += cluster_info.edge_count;
-
-        // Accumulate edges and cluster entries for this cluster
-        batch_edges.insert(batch_edges.end(),
-                           cluster_edges[cluster_id].begin(),
-                           cluster_edges[cluster_id].end());
-        for (int node : cluster_to_node[cluster_id]) {
-            batch_cluster_entries.emplace_back(node, cluster_id);
-        }
-
-        // Check if batch formation is completed
-        if (accumulated_cost >= this->min_batch_cost) {
-            accumulated_cost = 0;
-            write_binary_edgelist(output_edgelist, batch_edges);
-            write_binary_cluster(output_cluster_file, batch_cluster_entries);
-            ++files_written;
-            created_clusters.emplace_back(batch_head_cluster_info);
-        }
-    }
-
-    // Flush remaining batch that didn't reach min_batch_cost
-    if (accumulated_cost > 0) {
-        write_binary_edgelist(output_edgelist, batch_edges);
-        write_binary_cluster(output_cluster_file, batch_cluster_entries);
-        ++files_written;
-        created_clusters.emplace_back(batch_head_cluster_info);
-    }
-
-    // Write summary file for quicker load
-    std::string summary_filename = output_dir + "/summary.csv";
-    std::ofstream out_summary(summary_filename);
-    out_summary << "cluster_id,node_count,edge_count\n";
-    for (const auto& cluster : created_clusters)
-        out_summary << cluster.cluster_id << "," << cluster.node_count << "," << cluster.edge_count << "\n";
-
-    logger.info("partition_clustering completed successfully. " +
-               std::to_string(clusters.size()) + " clusters written to " +
-               std::to_string(files_written) + " batched files");
-
+    Partitioner partitioner(logger, work_dir, min_batch_cost, drop_cluster_under, auto_accept_clique,
+                            partition_options,
+                            [this](const ClusterInfo& cluster_info) { return get_cost(cluster_info); });
+    if (partition_options.cache_dir.empty()) {
+        return partitioner.partition(edgelist, cluster_file, output_dir);
+    }
+
+    PartitionCache cache(logger, partition_options.cache_dir);
+    std::string key = PartitionCache::partition_key(edgelist, cluster_file, min_batch_cost,
+                                                    drop_cluster_under, auto_accept_clique, partition_options);
+    if (cache.restore(key, output_dir, work_dir)) {
+        return load_partitioned_clusters(output_dir);
+    }
+    std::vector<ClusterInfo> created_clusters =
+        partitioner.partition(cache.binary_edgelist(edgelist, partitioner), cluster_file, output_dir);
+    cache.store(key, output_dir, work_dir);
     return created_clusters;
 }
 
@@ -437,6 +161,18 @@ std::vector<ClusterInfo> LoadBalancer::load_partitioned_clusters(const std::stri
 
     std::vector<ClusterInfo> clusters;
 
+    // Packed clusters: the index holds the same entries as summary.csv
+    if (ClusterPackReader::exists(partitioned_dir)) {
+        ClusterPackReader pack(partitioned_dir);
+        clusters.reserve(pack.entries().size());
+        for (const PackIndexEntry& entry : pack.entries()) {
+            clusters.push_back({entry.cluster_id, entry.node_count, entry.edge_count});
+        }
+        logger.info("Loaded " + std::to_string(clusters.size()) + " clusters from " + partitioned_dir + "/" +
+                    PACK_INDEX_FILE);
+        return clusters;
+    }
+
     // Load summary file
     std::string summary_filename = partitioned_dir + "/summary.csv";
     std::ifstream summary(summary_filename);
@@ -451,7 +187,7 @@ std::vector<ClusterInfo> LoadBalancer::load_partitioned_clusters(const std::stri
         std::getline(ss, edge_count, ',');
 
         ClusterInfo cluster_info;
-        cluster_info.cluster_id = std::stoi(cluster_id);
+        cluster_info.cluster_id = std::stoll(cluster_id);
         cluster_info.node_count = std::stoi(node_count);
         cluster_info.edge_count = std::stoll(edge_count);
 
@@ -466,60 +202,109 @@ std::vector<ClusterInfo> LoadBalancer::load_partitioned_clusters(const std::stri
     return clusters;
 }
 
+// Queue a cluster at its estimated cost
+void LoadBalancer::enqueue(const ClusterInfo& cluster_info) {
+    job_queue.push(cluster_info, get_cost(cluster_info));
+}
+
 // Initialize job queue from created clusters
 void LoadBalancer::initialize_job_queue(const std::vector<ClusterInfo>& created_clusters) {
     logger.info("Initializing job queue with " + std::to_string(created_clusters.size()) + " clusters");
 
+    job_queue.reserve(created_clusters.size());
     for (const auto& c : created_clusters) {
-        job_queue.push(c);
-        job_queue_active++;
+        enqueue(c);
     }
 
-    logger.info("Job queue initialized with " + std::to_string(job_queue_active) + " unprocessed clusters.");
+    logger.info("Job queue initialized with " + std::to_string(job_queue.size()) + " unprocessed clusters.");
 }
 
-// Pop clusters from job_queue (skipping dropped entries), batch up to min_batch_cost,
+// Pop clusters from job_queue, batch up to min_batch_cost,
 // assign to worker_rank via MPI. Returns true if work was assigned.
 bool LoadBalancer::assign_batch(int worker_rank) {
     std::vector<AssignedCluster> assign_clusters;
     float batch_cost = 0;
 
-    while (!job_queue.empty() && batch_cost < min_batch_cost) {
-        ClusterInfo cluster_info = job_queue.top();
-        job_queue.pop();
+    // A worker asking for work with nothing outstanding has finished its previous batch;
+    // a prefetching worker still holds its reservations until it reports each cluster done
+    if (worker_outstanding[worker_rank] == 0) worker_memory.erase(worker_rank);
+    bool node_idle;
+    double headroom = memory_headroom(worker_rank, node_idle);
+    std::vector<std::pair<ClusterInfo, float>> passed_over;  // too big for the node right now, requeued below
 
-        // Lazy deletion: skip dropped clusters
-        if (dropped_clusters.erase(cluster_info.cluster_id)) {
+    while (!job_queue.empty() && batch_cost < min_batch_cost) {
+        float cost = job_queue.top_cost();
+        ClusterInfo cluster_info = job_queue.pop();
+
+        // Without a better place, a node with nothing running still takes the largest cluster
+        // (unless it was killed for lack of memory before); with nothing running anywhere,
+        // any cluster is placed
+        double need = memory_need(cluster_info);
+        bool fits = need <= headroom || in_flight_clusters.empty() ||
+                    (node_idle && assign_clusters.empty() && !oom_required_mb.count(cluster_info.cluster_id));
+        if (!fits) {
+            passed_over.emplace_back(cluster_info, cost);
+            if (passed_over.size() >= MAX_PASSED_OVER) break;
             continue;
         }
 
-        job_queue_active--;
         int is_yielded = yield_to_root.count(cluster_info.cluster_id) ? 1 : 0;
         assign_clusters.push_back({cluster_info.cluster_id, is_yielded});
         in_flight_clusters[cluster_info.cluster_id] = cluster_info;
+        ++worker_outstanding[worker_rank];
+        if (need > 0) worker_memory[worker_rank][cluster_info.cluster_id] = need;
 
-        float cost = get_cost(cluster_info);
         batch_cost += cost;
 
         logger.info("Assigning cluster " + std::to_string(cluster_info.cluster_id) +
             " (nodes: " + std::to_string(cluster_info.node_count) +
             ", edges: " + std::to_string(cluster_info.edge_count) +
             ", estimated cost: " + std::to_string(cost) +
+            (need > 0 ? ", predicted memory: " + std::to_string(need) + " MB" : std::string()) +
             ", yielded: " + std::to_string(is_yielded) + ")" +
             " to worker " + std::to_string(worker_rank) +
-            " (" + std::to_string(job_queue_active) + " jobs remaining)");
+            " (" + std::to_string(worker_outstanding[worker_rank]) + " outstanding on it, " +
+            std::to_string(job_queue.size()) + " jobs remaining)");
 
         std::ofstream pending_out(work_dir + "/" + "pending" + "/" + std::to_string(cluster_info.cluster_id));
     }
 
+    for (const auto& [cluster_info, cost] : passed_over) job_queue.push(cluster_info, cost);
+    if (!passed_over.empty()) {
+        logger.debug("Passed over " + std::to_string(passed_over.size()) + " clusters for worker " +
+            std::to_string(worker_rank) + " (" + std::to_string(headroom) + " MB free on its node, largest needs " +
+            std::to_string(memory_need(passed_over.front().first)) + " MB)");
+    }
+
     if (assign_clusters.empty()) return false;
 
-    // Send as flat int array: [cluster_id, is_yielded, cluster_id, is_yielded, ...]
-    MPI_Send(assign_clusters.data(), assign_clusters.size() * 2, MPI_INT, worker_rank,
+    // Send as flat int64 array: [yield_id_first, yield_id_count, cluster_id, is_yielded, ...]
+    // The worker gets its next block of yield IDs ahead of need, so yields never wait on the LB
+    std::vector<int64_t> message = {0, 0};
+    message.reserve(2 + 2 * assign_clusters.size());
+    if (worker_yield_ids_granted[worker_rank] - worker_yield_ids_used[worker_rank] < YIELD_ID_LOW_WATER) {
+        message[0] = grant_yield_ids(worker_rank);
+        message[1] = YIELD_ID_BLOCK;
+    }
+    for (const AssignedCluster& assigned : assign_clusters) {
+        message.push_back(assigned.cluster_id);
+        message.push_back(assigned.is_yielded);
+    }
+    MPI_Send(message.data(), message.size(), MPI_INT64_T, worker_rank,
              to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD);
     return true;
 }
 
+// Hand out the next block of the yield ID range
+int64_t LoadBalancer::grant_yield_ids(int worker_rank) {
+    int64_t first = next_yield_id;
+    next_yield_id += YIELD_ID_BLOCK;
+    worker_yield_ids_granted[worker_rank] += YIELD_ID_BLOCK;
+    logger.debug("Yield IDs " + std::to_string(first) + "-" + std::to_string(next_yield_id - 1) +
+        " granted to worker " + std::to_string(worker_rank));
+    return first;
+}
+
 // Runtime phase: Distribute jobs to workers
 void LoadBalancer::run() {
     logger.info("LoadBalancer runtime phase started");
@@ -536,135 +321,190 @@ void LoadBalancer::run() {
     // but in-flight clusters may still yield new work.
     std::vector<int> pending_work_requests;
 
+    // Receives stay posted on every tag workers send to rank 0 (DISTRIBUTE_WORK and YIELD_IDS
+    // are left to a worker running on rank 0). Within a batch, messages are handled in the
+    // order the tags are added: a worker's WORKER_INFO before its first WORK_REQUEST,
+    // YIELD_REPORTs before the WORK_DONE of their parent, and completions before the requests
+    // they free memory for.
+    int busy_depth = std::clamp(num_workers, 1, MAX_POSTED_RECEIVES);
+    int rare_depth = std::clamp(num_workers, 1, MAX_POSTED_RARE_RECEIVES);
+    MessageEngine engine(MPI_COMM_WORLD);
+    engine.add_tag(to_int(MessageType::WORKER_INFO), MPI_BYTE, sizeof(WorkerInfo), rare_depth);
+    engine.add_tag(to_int(MessageType::WORKER_REPORT), MPI_INT, 3, busy_depth);
+    engine.add_tag(to_int(MessageType::YIELD_REPORT), MPI_BYTE, sizeof(YieldReport), busy_depth);
+    engine.add_tag(to_int(MessageType::WORK_DONE), MPI_BYTE, sizeof(WorkDone), busy_depth);
+    engine.add_tag(to_int(MessageType::WORK_ABORTED), MPI_BYTE, sizeof(WorkDone), rare_depth);
+    engine.add_tag(to_int(MessageType::YIELD_ID_REQUEST), MPI_INT, 1, rare_depth);
+    engine.add_tag(to_int(MessageType::WORK_REQUEST), MPI_INT64_T, 1, busy_depth);
+    engine.add_tag(to_int(MessageType::AGGREGATE_DONE), MPI_INT, 1, rare_depth);
+    engine.start();
+
+    // The log is flushed whenever the loop goes idle, and at least every LOG_FLUSH_INTERVAL
+    std::vector<MessageEngine::Message> messages;
+    auto last_flush = std::chrono::steady_clock::now();
+    auto flush_log = [&]() {
+        logger.flush();
+        last_flush = std::chrono::steady_clock::now();
+    };
+
     while (active_workers > 0) {
-        // Listen to incoming messages from workers
-        MPI_Status status;
-        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-
-        int worker_rank = status.MPI_SOURCE;
-        MessageType message_type = static_cast<MessageType>(status.MPI_TAG);
-
-        // Worker report: 3-int message, handle separately
-        if (message_type == MessageType::WORKER_REPORT) {
-            int report_data[3];
-            MPI_Recv(report_data, 3, MPI_INT, worker_rank, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            worker_reports[worker_rank] = {report_data[0], report_data[1], report_data[2]};
-            continue;
-        }
+        engine.poll(messages, flush_log);
 
-        // Yield report: {parent_id, child_id, node_count, edge_count} sent as raw bytes
-        if (message_type == MessageType::YIELD_REPORT) {
-            struct { int parent_id; int child_id; int node_count; int64_t edge_count; } yield_data;
-            MPI_Recv(&yield_data, sizeof(yield_data), MPI_BYTE, worker_rank, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for (const MessageEngine::Message& message : messages) {
+            int worker_rank = message.source;
+            MessageType message_type = static_cast<MessageType>(message.tag);
 
-            int parent_id = yield_data.parent_id;
-            int child_id = yield_data.child_id;
-            int node_count = yield_data.node_count;
-            int64_t edge_count = yield_data.edge_count;
+            // Worker report: 3-int message, handle separately
+            if (message_type == MessageType::WORKER_REPORT) {
+                int report_data[3];
+                std::memcpy(report_data, message.data, sizeof(report_data));
+                worker_reports[worker_rank] = {report_data[0], report_data[1], report_data[2]};
+                continue;
+            }
 
-            // Ensure parent exists in yield_tree (may not if WORK_DONE hasn't arrived yet).
-            // Create as root (parent_id=-1) if this is an original cluster.
-            if (!yield_tree.count(parent_id)) {
-                yield_tree[parent_id] = {parent_id, -1, false, false, 0, 0, {}};
+            // Worker info: node name and memory budget, sent once before the first WORK_REQUEST
+            if (message_type == MessageType::WORKER_INFO) {
+                WorkerInfo info;
+                std::memcpy(&info, message.data, sizeof(info));
+                std::string node_name(info.node_name, strnlen(info.node_name, sizeof(info.node_name)));
+                NodeMemory& node = nodes[node_name];
+                node.budget_mb = std::max(node.budget_mb, info.memory_budget_mb);
+                node.workers.push_back(worker_rank);
+                worker_node[worker_rank] = node_name;
+                logger.info("Worker " + std::to_string(worker_rank) + " runs on node " + node_name +
+                    " (memory budget " + std::to_string(node.budget_mb) + " MB, " +
+                    std::to_string(node.workers.size()) + " workers)");
+                continue;
             }
 
-            YieldNode& parent_node = yield_tree[parent_id];
+            // Yield report: {parent_id, child_id, node_count, edge_count} sent as raw bytes
+            if (message_type == MessageType::YIELD_REPORT) {
+                YieldReport yield_data;
+                std::memcpy(&yield_data, message.data, sizeof(yield_data));
+
+                int64_t parent_id = yield_data.parent_id;
+                int64_t child_id = yield_data.child_id;
+                int node_count = yield_data.node_count;
+                int64_t edge_count = yield_data.edge_count;
+
+                // Ensure parent exists in yield_tree (may not if WORK_DONE hasn't arrived yet).
+                // Create as root (parent_id=-1) if this is an original cluster.
+                uint32_t parent_slot = yield_tree.find_or_add_root(parent_id);
+
+                // If any ancestor is aborted, discard this child.
+                // Count it as resolved so the aborted ancestor can eventually resolve.
+                if (yield_tree.node(parent_slot).under_abort) {
+                    logger.info("Discarding YIELD_REPORT for aborted ancestor chain"
+                        " (parent=" + std::to_string(parent_id) +
+                        ", child=" + std::to_string(child_id) + ")");
+                    yield_tree.node(parent_slot).resolved_children++;
+                    try_resolve(parent_id, pending_work_requests);
+                    continue;
+                }
 
-            // If any ancestor is aborted, discard this child.
-            // Count it as resolved so the aborted ancestor can eventually resolve.
-            if (is_ancestor_aborted(parent_id)) {
-                logger.info("Discarding YIELD_REPORT for aborted ancestor chain"
-                    " (parent=" + std::to_string(parent_id) +
-                    ", child=" + std::to_string(child_id) + ")");
-                parent_node.resolved_children++;
-                try_resolve(parent_id, pending_work_requests);
+                // Create child node in yield_tree
+                uint32_t child_slot = yield_tree.add_child(parent_slot, child_id);
+                const YieldNode& parent_node = yield_tree.node(parent_slot);
+
+                // Track yielded cluster → root mapping (persistent across resolution)
+                yield_to_root[child_id] = yield_tree.node(child_slot).root_id;
+
+                // Add child to queue
+                ClusterInfo yielded = {child_id, node_count, edge_count};
+                enqueue(yielded);
+
+                logger.info("Yield: parent=" + std::to_string(parent_id) +
+                    " child=" + std::to_string(child_id) +
+                    " (nodes=" + std::to_string(node_count) +
+                    ", edges=" + std::to_string(edge_count) +
+                    ", cost=" + std::to_string(get_cost(node_count, edge_count)) + ")" +
+                    " resolved=" + std::to_string(parent_node.resolved_children) +
+                    "/" + std::to_string(parent_node.expected_yields) +
+                    " (" + std::to_string(job_queue.size()) + " jobs in queue)");
+
+                // Service any workers that were waiting for work
+                serve_pending_requests(pending_work_requests);
+
+                continue;
+            }
+
+            // A worker used up its yield IDs mid-cluster; its yield monitor waits for this block
+            if (message_type == MessageType::YIELD_ID_REQUEST) {
+                int64_t block[2] = {grant_yield_ids(worker_rank), YIELD_ID_BLOCK};
+                MPI_Send(block, 2, MPI_INT64_T, worker_rank, to_int(MessageType::YIELD_IDS), MPI_COMM_WORLD);
+                logger.info("Worker " + std::to_string(worker_rank) + " ran out of yield IDs; sent " +
+                    std::to_string(YIELD_ID_BLOCK) + " more starting at " + std::to_string(block[0]));
                 continue;
             }
 
-            // Create child node in yield_tree
-            yield_tree[child_id] = {child_id, parent_id, false, false, 0, 0, {}};
-            parent_node.children.push_back(child_id);
-
-            // Track yielded cluster → root mapping (persistent across resolution)
-            int root = parent_id;
-            while (yield_tree.count(root) && yield_tree[root].parent_id != -1)
-                root = yield_tree[root].parent_id;
-            yield_to_root[child_id] = root;
-
-            // Add child to queue
-            ClusterInfo yielded = {child_id, node_count, edge_count};
-            job_queue.push(yielded);
-            job_queue_active++;
-
-            logger.info("Yield: parent=" + std::to_string(parent_id) +
-                " child=" + std::to_string(child_id) +
-                " (nodes=" + std::to_string(node_count) +
-                ", edges=" + std::to_string(edge_count) +
-                ", cost=" + std::to_string(get_cost(node_count, edge_count)) + ")" +
-                " resolved=" + std::to_string(parent_node.resolved_children) +
-                "/" + std::to_string(parent_node.expected_yields) +
-                " (" + std::to_string(job_queue_active) + " jobs in queue)");
-
-            // Service any workers that were waiting for work
-            while (!pending_work_requests.empty()) {
-                int waiting_rank = pending_work_requests.back();
-                if (assign_batch(waiting_rank)) {
-                    pending_work_requests.pop_back();
+            if (message_type == MessageType::WORK_REQUEST) {
+                int64_t used_yield_ids;
+                std::memcpy(&used_yield_ids, message.data, sizeof(used_yield_ids));
+                worker_yield_ids_used[worker_rank] = used_yield_ids;
+
+                if (assign_batch(worker_rank)) {
+                    // Work assigned
+                } else if (!in_flight_clusters.empty()) {
+                    // Queue is effectively empty (or nothing queued fits in the memory left on the
+                    // worker's node) but in-flight clusters may still yield new work or free memory.
+                    // Defer this worker's request — respond when work becomes available
+                    // or when all in-flight clusters complete.
+                    pending_work_requests.push_back(worker_rank);
+                    logger.info("Worker " + std::to_string(worker_rank) +
+                        " is waiting for work (" + std::to_string(in_flight_clusters.size()) +
+                        " clusters still in flight)");
                 } else {
-                    break;  // queue effectively empty
+                    // Queue empty and nothing in flight — truly done
+                    int64_t no_more = NO_MORE_JOBS;
+                    MPI_Send(&no_more, 1, MPI_INT64_T, worker_rank,
+                             to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD);
+                    logger.info("Sending termination signal to worker " + std::to_string(worker_rank));
                 }
-            }
+            } else if (message_type == MessageType::WORK_DONE || message_type == MessageType::WORK_ABORTED) {
+                // Completion message: WorkDone
+                // yield_count is the number of sub-clusters directly yielded during processing.
+                // All YIELD_REPORTs for those sub-clusters are guaranteed sent before this message
+                // on the worker side, but may arrive later due to MPI cross-tag reordering.
+                WorkDone done_data;
+                std::memcpy(&done_data, message.data, sizeof(done_data));
+                int64_t cluster_id = done_data.cluster_id;
+                int yield_count = done_data.yield_count;
+                bool is_aborted = (message_type == MessageType::WORK_ABORTED);
 
-            continue;
-        }
+                logger.info("Worker " + std::to_string(worker_rank) +
+                    (is_aborted ? " aborted" : " completed") + " cluster " +
+                    std::to_string(cluster_id) + " (yield_count=" + std::to_string(yield_count) + ")");
 
-        if (message_type == MessageType::WORK_REQUEST) {
-            int message;
-            MPI_Recv(&message, 1, MPI_INT, worker_rank, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                auto in_flight = in_flight_clusters.find(cluster_id);
+                if (!is_aborted && in_flight != in_flight_clusters.end()) {
+                    record_runtime(in_flight->second, done_data);
+                }
+                auto reserved = worker_memory.find(worker_rank);
+                if (reserved != worker_memory.end()) reserved->second.erase(cluster_id);
+                auto outstanding = worker_outstanding.find(worker_rank);
+                if (outstanding != worker_outstanding.end() && outstanding->second > 0) --outstanding->second;
 
-            if (assign_batch(worker_rank)) {
-                // Work assigned
-            } else if (!in_flight_clusters.empty()) {
-                // Queue is effectively empty but in-flight clusters may still yield new work.
-                // Defer this worker's request — respond when work becomes available
-                // or when all in-flight clusters complete.
-                pending_work_requests.push_back(worker_rank);
-                logger.info("Worker " + std::to_string(worker_rank) +
-                    " is waiting for work (" + std::to_string(in_flight_clusters.size()) +
-                    " clusters still in flight)");
-            } else {
-                // Queue empty and nothing in flight — truly done
-                int no_more = NO_MORE_JOBS;
-                MPI_Send(&no_more, 1, MPI_INT, worker_rank,
-                         to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD);
-                logger.info("Sending termination signal to worker " + std::to_string(worker_rank));
+                if (!(is_aborted && done_data.oom_killed && retry_after_oom(cluster_id, done_data))) {
+                    handle_cluster_completion(cluster_id, pending_work_requests, yield_count, is_aborted);
+                }
+
+                // The memory the cluster held may let deferred workers take a queued cluster
+                serve_pending_requests(pending_work_requests);
+            } else if (message_type == MessageType::AGGREGATE_DONE) {
+                logger.info("Worker " + std::to_string(worker_rank) + " completed worker-level aggregation.");
+                --active_workers;
             }
-        } else if (message_type == MessageType::WORK_DONE || message_type == MessageType::WORK_ABORTED) {
-            // Completion message: [cluster_id, yield_count]
-            // yield_count is the number of sub-clusters directly yielded during processing.
-            // All YIELD_REPORTs for those sub-clusters are guaranteed sent before this message
-            // on the worker side, but may arrive later due to MPI cross-tag reordering.
-            int done_data[2];
-            MPI_Recv(done_data, 2, MPI_INT, worker_rank, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            int cluster_id = done_data[0];
-            int yield_count = done_data[1];
-            bool is_aborted = (message_type == MessageType::WORK_ABORTED);
-
-            logger.info("Worker " + std::to_string(worker_rank) +
-                (is_aborted ? " aborted" : " completed") + " cluster " +
-                std::to_string(cluster_id) + " (yield_count=" + std::to_string(yield_count) + ")");
-
-            handle_cluster_completion(cluster_id, pending_work_requests, yield_count, is_aborted);
-        } else if (message_type == MessageType::AGGREGATE_DONE) {
-            int message;
-            MPI_Recv(&message, 1, MPI_INT, worker_rank, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            logger.info("Worker " + std::to_string(worker_rank) + " completed worker-level aggregation.");
-            --active_workers;
         }
 
-        logger.flush(); // flush per assignment
+        if (std::chrono::steady_clock::now() - last_flush >= LOG_FLUSH_INTERVAL) flush_log();
     }
 
+    int unhandled = engine.cancel();
+    if (unhandled > 0) {
+        logger.error(std::to_string(unhandled) + " messages arrived after every worker finished");
+    }
+    logger.flush();
+
     // Aggregation phase: combine outputs from all workers
     int next_cluster_id = 0;
     std::string clusters_output_dir = work_dir + "/output/";
@@ -675,32 +515,26 @@ void LoadBalancer::run() {
 
     // Helper lambda for aggregating a single output file
     auto aggregate_file = [&](const std::string& filepath, const std::string& source_name) {
-        std::ifstream in(filepath);
-        if (!in.is_open()) return;
+        if (!fs::exists(filepath)) return;
+        MappedFile in(filepath, source_name + " output");
 
-        std::string line;
-        std::getline(in, line);  // Skip header
+        // Skip header
+        const char* data = in.data();
+        const char* end = in.end();
+        while (data < end && *data != '\n') ++data;
+        if (data < end) ++data;
 
         std::unordered_map<int, int> cluster_mapping;  // per-file mapping
 
-        while (std::getline(in, line)) {
-            std::stringstream ss(line);
-            std::string node_str, cluster_str;
-            std::getline(ss, node_str, ',');
-            std::getline(ss, cluster_str, ',');
-
-            int node_id = std::stoi(node_str);
-            int cluster_id = std::stoi(cluster_str);
-
+        parse_pairs(data, end, ',', [&](int node_id, int cluster_id) {
             // Assign new global ID if this cluster_id hasn't been seen in this file's output
             if (cluster_mapping.find(cluster_id) == cluster_mapping.end()) {
                 cluster_mapping[cluster_id] = next_cluster_id++;
             }
 
             out << node_id << "," << cluster_mapping[cluster_id] << "\n";
-        }
+        });
 
-        in.close();
         out.flush();
 
         logger.info("Scanned " + source_name + " output.");
@@ -722,7 +556,7 @@ void LoadBalancer::run() {
     if (fs::exists(yield_dir)) {
         for (const auto& entry : fs::directory_iterator(yield_dir)) {
             if (!entry.is_regular_file() || entry.path().extension() != ".output") continue;
-            int cluster_id = std::stoi(entry.path().stem());
+            int64_t cluster_id = std::stoll(entry.path().stem());
             // Skip outputs belonging to aborted root clusters
             if (yield_to_root.count(cluster_id) && aborted_clusters.count(yield_to_root[cluster_id])) {
                 logger.info("Skipping yield output for cluster " + std::to_string(cluster_id) +
@@ -754,6 +588,8 @@ void LoadBalancer::run() {
                     + std::to_string(total_timeout) + " timeouts, peak cluster memory " + std::to_string(global_peak_mb) + " MB");
     }
 
+    finish_cost_model();
+
     logger.info("LoadBalancer runtime phase ended");
 
     std::string checkpoint_file = work_dir + "/checkpoint.csv";
@@ -772,7 +608,7 @@ void LoadBalancer::run() {
 // Shared completion logic for WORK_DONE and WORK_ABORTED.
 // Uses tree-based yield tracking: each node stays in yield_tree until fully resolved
 // (work_done, all yields received, all children resolved), then cascades upward.
-bool LoadBalancer::handle_cluster_completion(int cluster_id, std::vector<int>& pending_work_requests, int yield_count, bool aborted) {
+bool LoadBalancer::handle_cluster_completion(int64_t cluster_id, std::vector<int>& pending_work_requests, int yield_count, bool aborted) {
     // Clean up pending file
     try {
         fs::remove(work_dir + "/" + "pending" + "/" + std::to_string(cluster_id));
@@ -781,7 +617,7 @@ bool LoadBalancer::handle_cluster_completion(int cluster_id, std::vector<int>& p
     }
 
     // Simple case: no yields and not already in yield_tree (never yielded, never was yielded)
-    if (yield_count == 0 && !yield_tree.count(cluster_id)) {
+    if (yield_count == 0 && !yield_tree.contains(cluster_id)) {
         if (aborted) {
             aborted_clusters[cluster_id] = in_flight_clusters[cluster_id];
             logger.info("Cluster " + std::to_string(cluster_id) + " aborted (simple, no yields)");
@@ -791,10 +627,10 @@ bool LoadBalancer::handle_cluster_completion(int cluster_id, std::vector<int>& p
         in_flight_clusters.erase(cluster_id);
 
         // Deferred termination check
-        if (job_queue_active == 0 && in_flight_clusters.empty() && !pending_work_requests.empty()) {
+        if (job_queue.empty() && in_flight_clusters.empty() && !pending_work_requests.empty()) {
             for (int waiting_rank : pending_work_requests) {
-                int no_more = NO_MORE_JOBS;
-                MPI_Send(&no_more, 1, MPI_INT, waiting_rank,
+                int64_t no_more = NO_MORE_JOBS;
+                MPI_Send(&no_more, 1, MPI_INT64_T, waiting_rank,
                          to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD);
                 logger.info("Sending termination signal to deferred worker " + std::to_string(waiting_rank));
             }
@@ -804,14 +640,11 @@ bool LoadBalancer::handle_cluster_completion(int cluster_id, std::vector<int>& p
     }
 
     // Ensure node exists in yield_tree (may already exist if YIELD_REPORTs arrived first)
-    if (!yield_tree.count(cluster_id)) {
-        yield_tree[cluster_id] = {cluster_id, -1, false, false, 0, 0, {}};
-    }
+    uint32_t slot = yield_tree.find_or_add_root(cluster_id);
 
-    YieldNode& node = yield_tree[cluster_id];
+    YieldNode& node = yield_tree.node(slot);
     node.work_done = true;
     node.expected_yields = yield_count;
-    node.aborted = aborted;
 
     // If this is a child node (not a root), remove from in_flight_clusters.
     // The tree tracks it; only roots remain in in_flight.
@@ -828,13 +661,11 @@ bool LoadBalancer::handle_cluster_completion(int cluster_id, std::vector<int>& p
     // If aborted, sweep descendants: remove unprocessed children from queue,
     // mark in-flight children for discard
     if (aborted) {
-        sweep_aborted_descendants(cluster_id);
+        yield_tree.mark_aborted(slot);
+        sweep_aborted_descendants(slot);
 
-        // Find the root of this cluster's yield tree and mark it as aborted
-        int root = cluster_id;
-        while (yield_tree.count(root) && yield_tree[root].parent_id != -1) {
-            root = yield_tree[root].parent_id;
-        }
+        // Mark the root of this cluster's yield tree as aborted
+        int64_t root = yield_tree.node(slot).root_id;
         if (!aborted_clusters.count(root) && in_flight_clusters.count(root)) {
             aborted_clusters[root] = in_flight_clusters[root];
             logger.info("Root cluster " + std::to_string(root) +
@@ -850,117 +681,238 @@ bool LoadBalancer::handle_cluster_completion(int cluster_id, std::vector<int>& p
 
 // Check resolution condition and cascade upward.
 // A node resolves when: work_done && resolved_children == expected_yields
-void LoadBalancer::try_resolve(int cluster_id, std::vector<int>& pending_work_requests) {
-    if (!yield_tree.count(cluster_id)) return;
-
-    YieldNode& node = yield_tree[cluster_id];
-
-    if (!node.work_done) return;
-    if (node.resolved_children < node.expected_yields) return;
-
-    // Node is fully resolved
-    int parent_id = node.parent_id;
-    logger.info("Yield node " + std::to_string(cluster_id) + " fully resolved"
-        " (parent=" + std::to_string(parent_id) + ")");
-
-    erase_subtree(cluster_id);
-
-    if (parent_id == -1) {
-        // Root resolved — remove from in_flight
-        in_flight_clusters.erase(cluster_id);
-        logger.info("Root cluster " + std::to_string(cluster_id) + " fully complete (all descendants resolved)");
-
-        // Deferred termination check
-        if (job_queue_active == 0 && in_flight_clusters.empty() && !pending_work_requests.empty()) {
-            for (int waiting_rank : pending_work_requests) {
-                int no_more = NO_MORE_JOBS;
-                MPI_Send(&no_more, 1, MPI_INT, waiting_rank,
-                         to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD);
-                logger.info("Sending termination signal to deferred worker " + std::to_string(waiting_rank));
+void LoadBalancer::try_resolve(int64_t cluster_id, std::vector<int>& pending_work_requests) {
+    uint32_t slot = yield_tree.find(cluster_id);
+
+    // Each pass resolves one node, then moves on to its parent
+    while (slot != YieldTree::NONE) {
+        const YieldNode& node = yield_tree.node(slot);
+        if (!node.work_done) return;
+        if (node.resolved_children < node.expected_yields) return;
+
+        // Node is fully resolved
+        int64_t parent_id = node.parent_id;
+        uint32_t parent_slot = node.parent;
+        logger.info("Yield node " + std::to_string(cluster_id) + " fully resolved"
+            " (parent=" + std::to_string(parent_id) + ")");
+
+        yield_tree.erase_subtree(slot);
+
+        if (parent_id == -1) {
+            // Root resolved — remove from in_flight
+            in_flight_clusters.erase(cluster_id);
+            logger.info("Root cluster " + std::to_string(cluster_id) + " fully complete (all descendants resolved)");
+
+            // Deferred termination check
+            if (job_queue.empty() && in_flight_clusters.empty() && !pending_work_requests.empty()) {
+                for (int waiting_rank : pending_work_requests) {
+                    int64_t no_more = NO_MORE_JOBS;
+                    MPI_Send(&no_more, 1, MPI_INT64_T, waiting_rank,
+                             to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD);
+                    logger.info("Sending termination signal to deferred worker " + std::to_string(waiting_rank));
+                }
+                pending_work_requests.clear();
             }
-            pending_work_requests.clear();
-        }
-    } else {
-        // Child resolved — increment parent's resolved count and try to resolve parent
-        if (yield_tree.count(parent_id)) {
-            yield_tree[parent_id].resolved_children++;
-            logger.info("Child " + std::to_string(cluster_id) + " resolved under parent " +
-                std::to_string(parent_id) + " (" +
-                std::to_string(yield_tree[parent_id].resolved_children) + "/" +
-                std::to_string(yield_tree[parent_id].expected_yields) + " resolved)");
-            try_resolve(parent_id, pending_work_requests);
+            return;
         }
-    }
-}
-
-// Recursively remove a node and all its descendants from yield_tree.
-void LoadBalancer::erase_subtree(int cluster_id) {
-    if (!yield_tree.count(cluster_id)) return;
 
-    // Copy children list before erasing (iterator invalidation)
-    std::vector<int> children = yield_tree[cluster_id].children;
-    yield_tree.erase(cluster_id);
-
-    for (int child_id : children) {
-        erase_subtree(child_id);
-    }
-}
-
-// Walk the parent chain to check if any ancestor (including self) has been aborted.
-bool LoadBalancer::is_ancestor_aborted(int cluster_id) {
-    int current = cluster_id;
-    while (yield_tree.count(current)) {
-        if (yield_tree[current].aborted) return true;
-        if (yield_tree[current].parent_id == -1) break;
-        current = yield_tree[current].parent_id;
+        // Child resolved — increment parent's resolved count and try to resolve parent
+        YieldNode& parent = yield_tree.node(parent_slot);
+        parent.resolved_children++;
+        logger.info("Child " + std::to_string(cluster_id) + " resolved under parent " +
+            std::to_string(parent_id) + " (" +
+            std::to_string(parent.resolved_children) + "/" +
+            std::to_string(parent.expected_yields) + " resolved)");
+        cluster_id = parent_id;
+        slot = parent_slot;
     }
-    return false;
 }
 
-// For an aborted node: mark its unprocessed children for lazy deletion from job_queue.
+// For an aborted node: erase its unprocessed children from job_queue.
 // In-flight children will be resolved normally (their WORK_DONE/WORK_ABORTED will arrive);
 // the aborted flag on the ancestor prevents new grandchildren from being enqueued.
-void LoadBalancer::sweep_aborted_descendants(int cluster_id) {
-    if (!yield_tree.count(cluster_id)) return;
-
-    YieldNode& node = yield_tree[cluster_id];
+void LoadBalancer::sweep_aborted_descendants(uint32_t slot) {
     int swept = 0;
-
-    // Copy children list since we modify it
-    std::vector<int> children_copy = node.children;
-    for (int child_id : children_copy) {
-        if (!yield_tree.count(child_id)) continue;
-        YieldNode& child = yield_tree[child_id];
+    yield_tree.for_each_child(slot, [&](uint32_t child_slot) {
+        const YieldNode& child = yield_tree.node(child_slot);
 
         // Only drop children that are still in the queue (not yet assigned to a worker)
-        if (!child.work_done && !in_flight_clusters.count(child_id)) {
-            dropped_clusters.insert(child_id);
-            job_queue_active--;
+        if (!child.work_done && !in_flight_clusters.count(child.cluster_id)) {
+            job_queue.erase(child.cluster_id);
             ++swept;
 
-            node.resolved_children++;
-            node.children.erase(std::remove(node.children.begin(), node.children.end(), child_id), node.children.end());
-            yield_tree.erase(child_id);
+            yield_tree.node(slot).resolved_children++;
+            yield_tree.erase_subtree(child_slot);
         }
-    }
+    });
 
     if (swept > 0) {
         logger.info("Swept " + std::to_string(swept) + " unprocessed children of aborted cluster " +
-            std::to_string(cluster_id));
+            std::to_string(yield_tree.node(slot).cluster_id));
     }
 }
 
 // Estimate the cost of a cluster given node_count and edge_count
-float LoadBalancer::get_cost(int node_count, int64_t edge_count) {
-    double density = (2.0 * edge_count) / ((double)node_count * (node_count - 1));
-    return node_count + (1.0f / density);
+float LoadBalancer::get_cost(int node_count, int64_t edge_count) const {
+    return cost_model.cost(node_count, edge_count);
 }
 
 // Estimate the cost of a cluster given cluster_info
-float LoadBalancer::get_cost(const ClusterInfo& cluster_info) {
+float LoadBalancer::get_cost(const ClusterInfo& cluster_info) const {
     return get_cost(cluster_info.node_count, cluster_info.edge_count);
 }
 
+// Predicted peak RSS of a cluster, raised after an OOM kill
+double LoadBalancer::memory_need(const ClusterInfo& cluster_info) const {
+    double need = std::max(0.0, cost_model.predict_memory_mb(cluster_info.node_count, cluster_info.edge_count));
+    auto required = oom_required_mb.find(cluster_info.cluster_id);
+    return required != oom_required_mb.end() ? std::max(need, required->second) : need;
+}
+
+// Memory left on a worker's node after the clusters its other workers are running
+double LoadBalancer::memory_headroom(int worker_rank, bool& node_idle) const {
+    node_idle = true;
+    auto node_name = worker_node.find(worker_rank);
+    if (node_name == worker_node.end()) return std::numeric_limits<double>::infinity();
+    const NodeMemory& node = nodes.at(node_name->second);
+
+    double reserved = 0;
+    for (int rank : node.workers) {
+        auto clusters = worker_memory.find(rank);
+        if (rank == worker_rank || clusters == worker_memory.end() || clusters->second.empty()) continue;
+        // A worker runs its batch one cluster at a time, so it holds the largest of them
+        double largest = 0;
+        for (const auto& [cluster_id, mb] : clusters->second) largest = std::max(largest, mb);
+        reserved += largest;
+        node_idle = false;
+    }
+    return node.budget_mb - reserved;
+}
+
+// Requeue an OOM-killed cluster with a raised memory requirement
+bool LoadBalancer::retry_after_oom(int64_t cluster_id, const WorkDone& done) {
+    auto in_flight = in_flight_clusters.find(cluster_id);
+    // Only clusters that ran on their own: a yielding cluster's sub-clusters are already out
+    if (in_flight == in_flight_clusters.end() || done.yield_count > 0 || yield_tree.contains(cluster_id)) return false;
+    ClusterInfo cluster_info = in_flight->second;
+
+    int& retries = oom_retries[cluster_id];
+    if (retries >= MAX_OOM_RETRIES) {
+        logger.info("Cluster " + std::to_string(cluster_id) + " was killed (likely OOM) after " +
+            std::to_string(retries) + " retries; aborting it");
+        return false;
+    }
+
+    // The kill came when the node ran out, so ask for more room than the cluster had reached
+    double required = OOM_HEADROOM_FACTOR * std::max<double>(done.peak_memory_mb, memory_need(cluster_info));
+    int64_t largest_budget = 0;
+    for (const auto& [name, node] : nodes) largest_budget = std::max(largest_budget, node.budget_mb);
+    if (largest_budget > 0 && required > largest_budget) {
+        logger.info("Cluster " + std::to_string(cluster_id) + " was killed (likely OOM) at " +
+            std::to_string(done.peak_memory_mb) + " MB; no node has the " + std::to_string(required) +
+            " MB to retry it, aborting it");
+        return false;
+    }
+
+    ++retries;
+    oom_required_mb[cluster_id] = required;
+    in_flight_clusters.erase(in_flight);
+    std::error_code ec;
+    fs::remove(work_dir + "/" + "pending" + "/" + std::to_string(cluster_id), ec);
+    enqueue(cluster_info);
+    logger.info("Cluster " + std::to_string(cluster_id) + " was killed (likely OOM) at " +
+        std::to_string(done.peak_memory_mb) + " MB; requeued for a node with " + std::to_string(required) +
+        " MB free (retry " + std::to_string(retries) + "/" + std::to_string(MAX_OOM_RETRIES) + ")");
+    return true;
+}
+
+// Assign queued clusters to deferred workers, newest request first
+void LoadBalancer::serve_pending_requests(std::vector<int>& pending_work_requests) {
+    // Idle workers first, so prefetch requests do not take work an idle worker could run now
+    for (bool idle_pass : {true, false}) {
+        for (size_t i = pending_work_requests.size(); i-- > 0 && !job_queue.empty();) {
+            int worker_rank = pending_work_requests[i];
+            if (idle_pass && worker_outstanding[worker_rank] > 0) continue;
+            if (assign_batch(worker_rank)) {
+                pending_work_requests.erase(pending_work_requests.begin() + i);
+            }
+        }
+    }
+}
+
+// Compare a measured cluster runtime with its estimate and add it to the cost model
+void LoadBalancer::record_runtime(const ClusterInfo& cluster_info, const WorkDone& done) {
+    float heuristic = CostModel::heuristic(cluster_info.node_count, cluster_info.edge_count);
+    double predicted = cost_model.predict_seconds(cluster_info.node_count, cluster_info.edge_count);
+    double predicted_memory = cost_model.predict_memory_mb(cluster_info.node_count, cluster_info.edge_count);
+    logger.info("Cluster " + std::to_string(cluster_info.cluster_id) + " runtime: " +
+        std::to_string(done.wall_seconds) + " s wall, " + std::to_string(done.cpu_seconds) + " s CPU, " +
+        std::to_string(done.peak_memory_mb) + " MB peak" +
+        " (nodes=" + std::to_string(cluster_info.node_count) +
+        ", edges=" + std::to_string(cluster_info.edge_count) +
+        ", estimated cost " + std::to_string(get_cost(cluster_info)) +
+        (predicted >= 0 ? ", predicted " + std::to_string(predicted) + " s" : std::string()) +
+        (predicted_memory >= 0 ? ", predicted " + std::to_string(predicted_memory) + " MB" : std::string()) + ")");
+
+    if (predicted_memory >= 0) {
+        ++memory_predictions;
+        if (done.peak_memory_mb > predicted_memory) ++memory_underpredictions;
+    }
+    cost_model.observe_memory(cluster_info.node_count, cluster_info.edge_count, done.peak_memory_mb);
+
+    // A yielding cluster's time covers only part of its work
+    if (done.yield_count > 0) return;
+    runtime_samples.push_back({heuristic, predicted, done.wall_seconds});
+    cost_model.observe_runtime(cluster_info.node_count, cluster_info.edge_count, done.wall_seconds);
+}
+
+// Report the accuracy of this run's estimates and save the cost model with its new samples
+void LoadBalancer::finish_cost_model() {
+    // Typical error of an estimate: the median |log2(estimate / actual)|, so 1.0 means off by 2x
+    auto median_error = [](std::vector<double> log_ratios) {
+        for (double& ratio : log_ratios) ratio = std::abs(ratio);
+        std::nth_element(log_ratios.begin(), log_ratios.begin() + log_ratios.size() / 2, log_ratios.end());
+        return log_ratios[log_ratios.size() / 2];
+    };
+
+    std::vector<double> heuristic_ratios, model_ratios;
+    for (const RuntimeSample& sample : runtime_samples) {
+        double actual = std::log2(std::max(sample.wall_seconds, CostModel::MIN_SECONDS));
+        if (std::isfinite(sample.heuristic) && sample.heuristic > 0) {
+            heuristic_ratios.push_back(std::log2(sample.heuristic) - actual);
+        }
+        if (sample.predicted_seconds > 0) model_ratios.push_back(std::log2(sample.predicted_seconds) - actual);
+    }
+    if (!heuristic_ratios.empty()) {
+        // The heuristic is not in seconds; compare it after its best constant scaling
+        double offset = std::accumulate(heuristic_ratios.begin(), heuristic_ratios.end(), 0.0) / heuristic_ratios.size();
+        for (double& ratio : heuristic_ratios) ratio -= offset;
+        logger.info("Cost estimates vs measured runtimes of " + std::to_string(heuristic_ratios.size()) +
+            " clusters, median |log2(estimate / actual)|: heuristic " + std::to_string(median_error(heuristic_ratios)) +
+            (model_ratios.empty() ? ", no fitted model"
+                                  : ", model " + std::to_string(median_error(model_ratios)) + " (" +
+                                        std::to_string(model_ratios.size()) + " clusters)"));
+    }
+
+    if (memory_predictions > 0) {
+        logger.info("Peak memory exceeded its prediction for " + std::to_string(memory_underpredictions) + " of " +
+            std::to_string(memory_predictions) + " clusters");
+    }
+
+    if (cost_model.file().empty()) return;
+    try {
+        cost_model.save();
+        CostModel updated = cost_model;     // the run's own estimates stay fixed (job_queue order)
+        updated.fit();
+        logger.info("Saved cost model to " + cost_model.file() + " (" + std::to_string(cost_model.num_samples()) +
+            " runtime and " + std::to_string(cost_model.num_memory_samples()) + " memory samples, " +
+            (updated.is_fitted() ? "used by later runs" : "fitted from " +
+            std::to_string(CostModel::MIN_SAMPLES) + " samples on") + ")");
+    } catch (const std::exception& e) {
+        logger.error("Failed to save cost model: " + std::string(e.what()));
+    }
+}
+
 // Save checkpoint - usually due to SIGTERM
 // Yielded children are ephemeral and not checkpointed. Their root ancestors
 // are saved instead, so on recovery the root is re-processed from scratch.
@@ -969,17 +921,14 @@ void LoadBalancer::save_checkpoint() {
     std::string tmp_path = path + ".tmp";   // tmp file containing incomplete results
     std::ofstream out(tmp_path);
     out << "cluster_id,node_count,edge_count\n";
-    // Drain job_queue (save_checkpoint is called at termination, queue won't be reused)
     int queued = 0;
-    while (!job_queue.empty()) {
-        ClusterInfo c = job_queue.top();
-        job_queue.pop();
-        if (dropped_clusters.erase(c.cluster_id)) continue;
+    job_queue.for_each([&](const ClusterInfo& c, float) {
         // Skip yielded children (ephemeral; their root will be re-processed on recovery)
-        if (yield_tree.count(c.cluster_id) && yield_tree.at(c.cluster_id).parent_id != -1) continue;
+        uint32_t slot = yield_tree.find(c.cluster_id);
+        if (slot != YieldTree::NONE && yield_tree.node(slot).parent_id != -1) return;
         out << c.cluster_id << "," << c.node_count << "," << c.edge_count << "\n";
         ++queued;
-    }
+    });
     for (const auto& [k, c] : in_flight_clusters) {
         // in_flight only contains roots (children are removed from in_flight on creation)
         out << c.cluster_id << "," << c.node_count << "," << c.edge_count << "\n";
@@ -994,6 +943,13 @@ void LoadBalancer::save_checkpoint() {
 
     out.close();
     fs::rename(tmp_path, path);
+
+    // Keep the runtimes measured so far (finish_cost_model does not run when the job is killed)
+    try {
+        cost_model.save();
+    } catch (const std::exception& e) {
+        logger.error("Failed to save cost model: " + std::string(e.what()));
+    }
     logger.info("Checkpoint saved: " + std::to_string(queued) + " queued, "
                 + std::to_string(in_flight_clusters.size()) + " in-flight"
                 + ", " + std::to_string(aborted_clusters.size()) + " aborted");
@@ -1015,9 +971,7 @@ bool LoadBalancer::load_checkpoint() {
     }
 
     // Clear queue state
-    while (!job_queue.empty()) job_queue.pop();
-    job_queue_active = 0;
-    dropped_clusters.clear();
+    job_queue.clear();
     aborted_clusters.clear();
     yield_tree.clear();  // yield tree is ephemeral, not recoverable from checkpoint
     yield_to_root.clear();
@@ -1031,10 +985,9 @@ bool LoadBalancer::load_checkpoint() {
         std::getline(ss, cid, ',');
         std::getline(ss, nc, ',');
         std::getline(ss, ec, ',');
-        job_queue.push({std::stoi(cid), std::stoi(nc), std::stoll(ec)});
-        job_queue_active++;
+        enqueue({std::stoll(cid), std::stoi(nc), std::stoll(ec)});
     }
 
-    logger.info("Checkpoint loaded: " + std::to_string(job_queue_active) + " clusters to process");
+    logger.info("Checkpoint loaded: " + std::to_string(job_queue.size()) + " clusters to process");
     return true;
 }
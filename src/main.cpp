@@ -2,11 +2,14 @@
 #include <iostream>
 #include <thread>
 #include <filesystem>
+#include <algorithm>
 
 #include <mpi.h>
 #include <argparse.h>
 #include <load_balancer.hpp>
 #include <worker.hpp>
+#include <partition_cache.hpp>
+#include <input_shards.hpp>
 #include <utils.hpp>
 
 namespace fs = std::filesystem; // for brevity
@@ -20,6 +23,15 @@ void signal_handler(int signum) {
     _exit(0);
 }
 
+// True if the partition cache holds a partition of these inputs and options
+bool partition_cached(const PartitionOptions& options, const std::string& edgelist, const std::string& cluster_file,
+                      float min_batch_cost, int drop_cluster_under, bool auto_accept_clique) {
+    if (options.cache_dir.empty() || !input_exists(edgelist) || !input_exists(cluster_file)) return false;
+    std::string key = PartitionCache::partition_key(edgelist, cluster_file, min_batch_cost,
+                                                    drop_cluster_under, auto_accept_clique, options);
+    return PartitionCache::contains(options.cache_dir, key);
+}
+
 int main(int argc, char** argv) {
     // Initialize MPI
     int provided;
@@ -66,6 +78,12 @@ int main(int argc, char** argv) {
     int report_interval;
     int num_processors;
     int yield_node_threshold;
+    int64_t node_memory_mb = 0;
+    int prefetch_depth = 0;
+    PartitionOptions partition_options;
+    bool distributed_partition = false;
+    std::string cost_model_file;
+    CostModel cost_model;
 
     std::string algorithm;
     double clustering_parameter;
@@ -77,6 +95,25 @@ int main(int argc, char** argv) {
     std::string pending_dir;
     std::string partitioned_clusters_dir;
 
+    // Initialize LoadBalancer on rank 0 (this partitions clustering unless a summary exists, and initializes job queue),
+    // then spawn its runtime thread
+    auto launch_load_balancer = [&]() {
+        lb = std::make_unique<LoadBalancer>(method, edgelist, existing_clustering, work_dir, output_file, log_level, use_rank_0_worker, partitioned_clusters_dir, partition_only, min_batch_cost, drop_cluster_under, bypass_cluster, partition_options, cost_model);
+
+        // Signal handling - Slurm sends SIGTERM before SIGKILL a job
+        // Also handle SIGABRT for internal errors (e.g., memory corruption, assertion failures)
+        global_lb_ptr = lb.get();
+        std::signal(SIGTERM, signal_handler);   // register signal handler
+        std::signal(SIGABRT, signal_handler);   // save checkpoint on abort (e.g., free() errors)
+
+        if (partition_only) {
+            std::cerr << "Partition-only mode: won't start the load balancer" << std::endl;
+        } else {
+            // Spawn thread for runtime phase (job distribution)
+            lb_thread = std::thread(&LoadBalancer::run, lb.get());
+        }
+    };
+
     // Rank 0 (root) parses arguments and launches load balancer
     try {
         if (rank == 0) {
@@ -139,6 +176,36 @@ int main(int argc, char** argv) {
                 .default_value(int(0))
                 .help("Min node count for yielding sub-clusters back to LB for redistribution (0 = disabled)")
                 .scan<'d', int>();
+            common.add_argument("--partition-threads")
+                .default_value(int(1))
+                .help("Number of threads the load balancer uses to parse and partition the input (0 = all hardware threads)")
+                .scan<'d', int>();
+            common.add_argument("--partition-memory-limit")
+                .default_value(int64_t(0))
+                .help("Memory budget (MB) for intra-cluster edges during partitioning; beyond it edges are spilled to disk (0 = no limit)")
+                .scan<'d', int64_t>();
+            common.add_argument("--partition-cache-dir")
+                .default_value(std::string(""))
+                .help("Directory of partitions and binary edge lists reused across runs with matching inputs and options (empty = disabled)");
+            common.add_argument("--compress-clusters")
+                .default_value(false)
+                .implicit_value(true)
+                .help("Store partitioned cluster edges sorted and delta+varint encoded; workers decode them before processing");
+            common.add_argument("--cost-model")
+                .default_value(std::string(""))
+                .help("File of the runtime and memory model estimating cluster costs, refitted from measured runtimes and peak memory at the end of each run (default: <work-dir>/cost_model.txt, none = heuristic only)");
+            common.add_argument("--node-memory-mb")
+                .default_value(int64_t(0))
+                .help("Memory (MB) the clusters running on one node may use together; clusters are placed so their predicted peak memory fits (0 = the node's physical memory or cgroup limit)")
+                .scan<'d', int64_t>();
+            common.add_argument("--prefetch-depth")
+                .default_value(int(0))
+                .help("Batches each worker requests ahead of the one it is running, hiding the load balancer round trip (0 = request after each batch)")
+                .scan<'d', int>();
+            common.add_argument("--distributed-partition")
+                .default_value(false)
+                .implicit_value(true)
+                .help("Partition collectively on all ranks: each rank reads a slice of the edge list and writes the clusters it owns");
 
             /**
              * Finer control arguments
@@ -149,6 +216,18 @@ int main(int argc, char** argv) {
                 .default_value(-1)
                 .help("Drop cluster with less than (strictly) specified number of nodes")
                 .scan<'d', int>();
+            common.add_argument("--canonicalize-edges")
+                .default_value(false)
+                .implicit_value(true)
+                .help("Drop duplicate intra-cluster edges and self-loops during partitioning so edge counts and costs count distinct edges");
+            common.add_argument("--split-components")
+                .default_value(false)
+                .implicit_value(true)
+                .help("Partition each connected component of a cluster as its own job; singleton and under --drop-cluster-under components are dropped");
+            common.add_argument("--certificates")
+                .default_value(false)
+                .implicit_value(true)
+                .help("Settle clusters from degree data during partitioning: provably well-connected clusters are written directly to output, provably failing ones are reported");
             common.add_argument("--bypass-clique")
                 .default_value(false)
                 .implicit_value(true)
@@ -169,6 +248,10 @@ int main(int argc, char** argv) {
                     }
                     throw std::invalid_argument("--algorithm can only take in leiden-cpm, leiden-mod, or louvain.");
                 });
+            cm.add_argument("--peel")
+                .default_value(false)
+                .implicit_value(true)
+                .help("With --prune, peel nodes whose in-cluster degree is at most the connectedness threshold during partitioning, so only cluster cores are dispatched");
             cm.add_argument("--clustering-parameter")
                 .default_value(double(0.01))
                 .help("Clustering parameter e.g., 0.01 for Leiden-CPM")
@@ -223,6 +306,31 @@ int main(int argc, char** argv) {
                 report_interval = cm.get<int>("--report-interval");
                 num_processors = cm.get<int>("--num-processors");
                 yield_node_threshold = cm.get<int>("--yield-node-threshold");
+                node_memory_mb = cm.get<int64_t>("--node-memory-mb");
+                prefetch_depth = std::max(0, cm.get<int>("--prefetch-depth"));
+                partition_options.num_threads = cm.get<int>("--partition-threads");
+                partition_options.memory_limit_mb = cm.get<int64_t>("--partition-memory-limit");
+                partition_options.cache_dir = cm.get<std::string>("--partition-cache-dir");
+                partition_options.compress_clusters = cm.get<bool>("--compress-clusters");
+                partition_options.canonicalize_edges = cm.get<bool>("--canonicalize-edges");
+                partition_options.split_components = cm.get<bool>("--split-components");
+                partition_options.connectedness_criterion = connectedness_criterion;
+                partition_options.certificates = cm.get<bool>("--certificates");
+                partition_options.peel = cm.get<bool>("--peel");
+                if (partition_options.peel && !prune) {
+                    throw std::invalid_argument("--peel requires --prune");
+                }
+                if (partition_options.certificates || partition_options.peel) {
+                    ConnectednessCriterion validate(connectedness_criterion);  // reject a bad criterion up front
+                }
+                distributed_partition = cm.get<bool>("--distributed-partition");
+                if (partition_options.memory_limit_mb > 0 && !distributed_partition &&
+                    (partition_options.canonicalize_edges || partition_options.split_components ||
+                     partition_options.certificates || partition_options.peel)) {
+                    throw std::invalid_argument("--partition-memory-limit cannot be combined with --canonicalize-edges, "
+                                                "--split-components, --certificates or --peel");
+                }
+                cost_model_file = cm.get<std::string>("--cost-model");
 
                 // Ensure work-dir and sub-dir's exist
                 clusters_dir = work_dir + "/" + "clusters";
@@ -231,20 +339,19 @@ int main(int argc, char** argv) {
                 fs::create_directories(clusters_dir);
                 fs::create_directories(logs_clusters_dir);
 
-                // Initialize LoadBalancer (this partitions clustering and initializes job queue)
-                lb = std::make_unique<LoadBalancer>(method, edgelist, existing_clustering, work_dir, output_file, log_level, use_rank_0_worker, partitioned_clusters_dir, partition_only, min_batch_cost, drop_cluster_under, bypass_cluster);
-
-                // Signal handling - Slurm sends SIGTERM before SIGKILL a job
-                // Also handle SIGABRT for internal errors (e.g., memory corruption, assertion failures)
-                global_lb_ptr = lb.get();
-                std::signal(SIGTERM, signal_handler);   // register signal handler
-                std::signal(SIGABRT, signal_handler);   // save checkpoint on abort (e.g., free() errors)
-
-                if (partition_only) {
-                    std::cerr << "Partition-only mode: won't start the load balancer" << std::endl;
-                } else {
-                    // Spawn thread for runtime phase (job distribution)
-                    lb_thread = std::thread(&LoadBalancer::run, lb.get());
+                // Batches are planned with the cost model, so a refitted model repartitions
+                if (cost_model_file.empty()) cost_model_file = work_dir + "/cost_model.txt";
+                if (cost_model_file == "none") cost_model_file.clear();
+                cost_model = CostModel(cost_model_file, method, mincut_type);
+                partition_options.cost_model = cost_model.fingerprint();
+
+                // Collective partitioning needs every rank, so the load balancer is started after it (see below)
+                // A cached partition is restored by the load balancer instead
+                distributed_partition = distributed_partition && !fs::exists(partitioned_clusters_dir + "/summary.csv") &&
+                                        !partition_cached(partition_options, edgelist, existing_clustering,
+                                                          min_batch_cost, drop_cluster_under, bypass_cluster);
+                if (!distributed_partition) {
+                    launch_load_balancer();
                 }
             } else if (main_program.is_subcommand_used(wcc)) {
                 method = "WCC";
@@ -273,6 +380,27 @@ int main(int argc, char** argv) {
                 report_interval = wcc.get<int>("--report-interval");
                 num_processors = wcc.get<int>("--num-processors");
                 yield_node_threshold = wcc.get<int>("--yield-node-threshold");
+                node_memory_mb = wcc.get<int64_t>("--node-memory-mb");
+                prefetch_depth = std::max(0, wcc.get<int>("--prefetch-depth"));
+                partition_options.num_threads = wcc.get<int>("--partition-threads");
+                partition_options.memory_limit_mb = wcc.get<int64_t>("--partition-memory-limit");
+                partition_options.cache_dir = wcc.get<std::string>("--partition-cache-dir");
+                partition_options.compress_clusters = wcc.get<bool>("--compress-clusters");
+                partition_options.canonicalize_edges = wcc.get<bool>("--canonicalize-edges");
+                partition_options.split_components = wcc.get<bool>("--split-components");
+                partition_options.connectedness_criterion = connectedness_criterion;
+                partition_options.certificates = wcc.get<bool>("--certificates");
+                if (partition_options.certificates) {
+                    ConnectednessCriterion validate(connectedness_criterion);  // reject a bad criterion up front
+                }
+                distributed_partition = wcc.get<bool>("--distributed-partition");
+                if (partition_options.memory_limit_mb > 0 && !distributed_partition &&
+                    (partition_options.canonicalize_edges || partition_options.split_components ||
+                     partition_options.certificates)) {
+                    throw std::invalid_argument("--partition-memory-limit cannot be combined with --canonicalize-edges, "
+                                                "--split-components or --certificates");
+                }
+                cost_model_file = wcc.get<std::string>("--cost-model");
 
                 // Ensure work-dir and sub-dir's exist
                 clusters_dir = work_dir + "/" + "clusters";
@@ -281,20 +409,19 @@ int main(int argc, char** argv) {
                 fs::create_directories(clusters_dir);
                 fs::create_directories(logs_clusters_dir);
 
-                // Initialize LoadBalancer (this partitions clustering and initializes job queue)
-                lb = std::make_unique<LoadBalancer>(method, edgelist, existing_clustering, work_dir, output_file, log_level, use_rank_0_worker, partitioned_clusters_dir, partition_only, min_batch_cost, drop_cluster_under, bypass_cluster);
-
-                // Signal handling - Slurm sends SIGTERM before SIGKILL a job
-                // Also handle SIGABRT for internal errors (e.g., memory corruption, assertion failures)
-                global_lb_ptr = lb.get();
-                std::signal(SIGTERM, signal_handler);   // register signal handler
-                std::signal(SIGABRT, signal_handler);   // save checkpoint on abort (e.g., free() errors)
-
-                if (partition_only) {
-                    std::cerr << "Partition-only mode: won't start the load balancer" << std::endl;
-                } else {
-                    // Spawn thread for runtime phase (job distribution)
-                    lb_thread = std::thread(&LoadBalancer::run, lb.get());
+                // Batches are planned with the cost model, so a refitted model repartitions
+                if (cost_model_file.empty()) cost_model_file = work_dir + "/cost_model.txt";
+                if (cost_model_file == "none") cost_model_file.clear();
+                cost_model = CostModel(cost_model_file, method, mincut_type);
+                partition_options.cost_model = cost_model.fingerprint();
+
+                // Collective partitioning needs every rank, so the load balancer is started after it (see below)
+                // A cached partition is restored by the load balancer instead
+                distributed_partition = distributed_partition && !fs::exists(partitioned_clusters_dir + "/summary.csv") &&
+                                        !partition_cached(partition_options, edgelist, existing_clustering,
+                                                          min_batch_cost, drop_cluster_under, bypass_cluster);
+                if (!distributed_partition) {
+                    launch_load_balancer();
                 }
             }
 
@@ -322,6 +449,8 @@ int main(int argc, char** argv) {
     MPI_Bcast(&report_interval, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&num_processors, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&yield_node_threshold, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&node_memory_mb, 1, MPI_INT64_T, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&prefetch_depth, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&partition_only, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
 
     clusters_dir = work_dir + "/" + "clusters";
@@ -331,6 +460,61 @@ int main(int argc, char** argv) {
     logs_dir = work_dir + "/" + "logs";
     pending_dir = work_dir + "/" + "pending";
 
+    // Collective partitioning: every rank partitions a slice of the edge list, then rank 0
+    // starts the load balancer, which loads the summary written by the partitioning
+    MPI_Bcast(&distributed_partition, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+    if (distributed_partition) {
+        bcast_string(edgelist, 0, MPI_COMM_WORLD);
+        bcast_string(existing_clustering, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&min_batch_cost, 1, MPI_FLOAT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&drop_cluster_under, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&bypass_cluster, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&partition_options.num_threads, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        bcast_string(partition_options.cache_dir, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&partition_options.compress_clusters, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+        bcast_string(partition_options.connectedness_criterion, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&partition_options.certificates, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&partition_options.peel, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&partition_options.canonicalize_edges, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&partition_options.split_components, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+        bcast_string(cost_model_file, 0, MPI_COMM_WORLD);
+
+        try {
+            if (rank != 0) cost_model = CostModel(cost_model_file, method, mincut_type);
+            std::string partition_log = (rank == 0) ? logs_dir + "/load_balancer.log"
+                                                    : logs_dir + "/partition_" + std::to_string(rank) + ".log";
+            Logger partition_logger(partition_log, log_level);
+            Partitioner partitioner(partition_logger, work_dir, min_batch_cost, drop_cluster_under, bypass_cluster,
+                                    partition_options,
+                                    [&](const ClusterInfo& cluster_info) {
+                                        return cost_model.cost(cluster_info.node_count, cluster_info.edge_count);
+                                    });
+
+            // With a cache, rank 0 converts the edge list once and every rank reads the binary copy
+            std::unique_ptr<PartitionCache> cache;
+            std::string partition_edgelist = edgelist;
+            if (!partition_options.cache_dir.empty()) {
+                cache = std::make_unique<PartitionCache>(partition_logger, partition_options.cache_dir);
+                if (rank == 0) partition_edgelist = cache->binary_edgelist(edgelist, partitioner);
+                bcast_string(partition_edgelist, 0, MPI_COMM_WORLD);
+            }
+            partitioner.partition_distributed(partition_edgelist, existing_clustering, partitioned_clusters_dir,
+                                              MPI_COMM_WORLD);
+
+            if (rank == 0) {
+                if (cache) {
+                    cache->store(PartitionCache::partition_key(edgelist, existing_clustering, min_batch_cost,
+                                                               drop_cluster_under, bypass_cluster, partition_options),
+                                 partitioned_clusters_dir, work_dir);
+                }
+                launch_load_balancer();
+            }
+        } catch (const std::exception& err) {
+            std::cerr << err.what() << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);   // TODO: error handling
+        }
+    }
+
     bool is_worker = (rank != 0) || use_rank_0_worker;
 
     if (is_worker) {
@@ -345,7 +529,7 @@ int main(int argc, char** argv) {
         if (is_worker) {
             Logger worker_logger(logs_dir + "/" + "worker_" + std::to_string(rank) + ".log", log_level);
             std::unique_ptr<Worker> worker = std::make_unique<Worker>(
-                method, worker_logger, work_dir, clusters_dir, algorithm, clustering_parameter, log_level, connectedness_criterion, mincut_type, prune, time_limit_per_cluster, report_interval, num_processors, yield_node_threshold);
+                method, worker_logger, work_dir, clusters_dir, algorithm, clustering_parameter, log_level, connectedness_criterion, mincut_type, prune, time_limit_per_cluster, report_interval, num_processors, yield_node_threshold, node_memory_mb, prefetch_depth);
 
             worker->run();
         }
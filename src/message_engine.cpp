@@ -0,0 +1,114 @@
+#include <message_engine.hpp>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Empty polls spent spinning before the wait starts sleeping
+constexpr int SPIN_POLLS = 256;
+
+// Sleep between empty polls, doubling from the first to the longest
+constexpr std::chrono::microseconds FIRST_SLEEP(10);
+constexpr std::chrono::microseconds LONGEST_SLEEP(50);
+
+}  // namespace
+
+void MessageEngine::add_tag(int tag, MPI_Datatype type, int count, int depth) {
+    if (!requests.empty()) {
+        throw std::runtime_error("MessageEngine: tag " + std::to_string(tag) + " added after start()");
+    }
+    int type_size;
+    MPI_Type_size(type, &type_size);
+    tags.push_back({tag, type, count, std::max(depth, 1), static_cast<size_t>(type_size) * count, {}});
+}
+
+void MessageEngine::start() {
+    size_t total = 0;
+    for (uint32_t t = 0; t < tags.size(); ++t) {
+        for (int i = 0; i < tags[t].depth; ++i) {
+            slots.push_back({t, total});
+            // Keep every slot aligned for the widest element type
+            total += (tags[t].bytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        }
+    }
+    buffer.assign(total, 0);
+    requests.assign(slots.size(), MPI_REQUEST_NULL);
+    completed.resize(slots.size());
+    statuses.resize(slots.size());
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) post(slot);
+}
+
+void MessageEngine::post(uint32_t slot) {
+    Tag& tag = tags[slots[slot].tag_index];
+    MPI_Irecv(buffer.data() + slots[slot].offset, tag.count, tag.type, MPI_ANY_SOURCE, tag.tag, comm, &requests[slot]);
+    tag.posted.push_back(slot);
+}
+
+void MessageEngine::collect(std::vector<Message>& messages) {
+    for (Tag& tag : tags) {
+        // Receives with the same source and tag match in posting order, so a later slot
+        // completing first (possible for long messages) waits for the ones before it
+        while (!tag.posted.empty() && slots[tag.posted.front()].ready) {
+            uint32_t slot = tag.posted.front();
+            tag.posted.pop_front();
+            slots[slot].ready = false;
+            messages.push_back({slots[slot].source, tag.tag, buffer.data() + slots[slot].offset});
+            handed_out.push_back(slot);
+        }
+    }
+}
+
+void MessageEngine::poll(std::vector<Message>& messages, const std::function<void()>& on_idle) {
+    messages.clear();
+    for (uint32_t slot : handed_out) post(slot);
+    handed_out.clear();
+    if (requests.empty()) return;
+
+    int empty_polls = 0;
+    auto sleep = FIRST_SLEEP;
+    while (true) {
+        int num_completed;
+        MPI_Testsome(static_cast<int>(requests.size()), requests.data(), &num_completed, completed.data(), statuses.data());
+        if (num_completed == MPI_UNDEFINED) return;     // nothing posted
+        for (int i = 0; i < num_completed; ++i) {
+            slots[completed[i]].ready = true;
+            slots[completed[i]].source = statuses[i].MPI_SOURCE;
+        }
+        collect(messages);
+        if (!messages.empty()) return;
+
+        if (empty_polls < SPIN_POLLS) {
+            ++empty_polls;
+            continue;
+        }
+        if (empty_polls == SPIN_POLLS) {
+            ++empty_polls;
+            if (on_idle) on_idle();
+        }
+        std::this_thread::sleep_for(sleep);
+        sleep = std::min(sleep * 2, LONGEST_SLEEP);
+    }
+}
+
+int MessageEngine::cancel() {
+    int unhandled = 0;
+    for (uint32_t slot = 0; slot < slots.size(); ++slot) {
+        if (requests[slot] != MPI_REQUEST_NULL) {
+            MPI_Cancel(&requests[slot]);
+            MPI_Status status;
+            MPI_Wait(&requests[slot], &status);
+            int cancelled;
+            MPI_Test_cancelled(&status, &cancelled);
+            if (!cancelled) ++unhandled;
+        } else if (slots[slot].ready) {
+            ++unhandled;
+        }
+        slots[slot].ready = false;
+    }
+    for (Tag& tag : tags) tag.posted.clear();
+    handed_out.clear();
+    return unhandled;
+}
@@ -0,0 +1,284 @@
+#include <parser.hpp>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DCC_PARSER_X86 1
+#endif
+
+namespace {
+
+// Parse an optionally negative decimal integer starting at data, advancing data past it
+inline int32_t parse_int(const char*& data, const char* end) {
+    uint32_t value = 0;
+    bool neg = false;
+    if (data < end && *data == '-') { neg = true; ++data; }
+    while (data < end && *data >= '0' && *data <= '9') {
+        value = value * 10 + (*data - '0');
+        ++data;
+    }
+    return static_cast<int32_t>(neg ? 0u - value : value);
+}
+
+// Parse one "<int><delimiter><int>" line and skip to the start of the next one
+inline void parse_line(const char*& data, const char* end, char delimiter, int32_t* out) {
+    out[0] = parse_int(data, end);
+    if (data < end && *data == delimiter) ++data;
+    out[1] = parse_int(data, end);
+
+    // Skip to next line
+    while (data < end && *data != '\n') ++data;
+    if (data < end) ++data;
+}
+
+size_t parse_scalar(const char*& data, const char* end, char delimiter, int32_t* out, size_t max_pairs) {
+    size_t num_pairs = 0;
+    while (num_pairs < max_pairs && data < end) {
+        parse_line(data, end, delimiter, out + 2 * num_pairs);
+        ++num_pairs;
+    }
+    return num_pairs;
+}
+
+#ifdef DCC_PARSER_X86
+
+constexpr size_t WINDOW = 64;
+
+// Byte classes of a 64-byte window, one bit per byte
+struct WindowMasks {
+    uint64_t newline;
+    uint64_t delimiter;
+    uint64_t digit;
+};
+
+__attribute__((target("avx2"))) inline
+WindowMasks classify_avx2(const char* p, char delimiter) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i delim = _mm256_set1_epi8(delimiter);
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+    WindowMasks masks{0, 0, 0};
+    for (int half = 0; half < 2; ++half) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * half));
+        __m256i d = _mm256_sub_epi8(v, zero);
+        int shift = 32 * half;
+        masks.newline |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)))) << shift;
+        masks.delimiter |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, delim)))) << shift;
+        masks.digit |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(d, nine), d)))) << shift;
+    }
+    return masks;
+}
+
+__attribute__((target("sse4.2"))) inline
+WindowMasks classify_sse42(const char* p, char delimiter) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    WindowMasks masks{0, 0, 0};
+    for (int quarter = 0; quarter < 4; ++quarter) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * quarter));
+        __m128i d = _mm_sub_epi8(v, zero);
+        int shift = 16 * quarter;
+        masks.newline |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)))) << shift;
+        masks.delimiter |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, delim)))) << shift;
+        masks.digit |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d)))) << shift;
+    }
+    return masks;
+}
+
+// Convert eight ASCII digits (first digit in the lowest byte) with SWAR multiplies
+inline uint32_t convert_eight_digits(uint64_t chunk) {
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    return static_cast<uint32_t>(((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+// Convert a run of 1..10 digits ending at field + length. Short runs are loaded as the
+// eight bytes ending at the run with the leading bytes replaced by '0', which needs
+// field + length - 8 to be readable (>= begin); otherwise the scalar loop is used.
+inline uint32_t convert_digits(const char* field, unsigned length, const char* begin) {
+    uint32_t head = 0;
+    if (length > 8) {
+        for (unsigned i = 0; i < length - 8; ++i) head = head * 10 + (field[i] - '0');
+        field += length - 8;
+        length = 8;
+    } else if (field + length < begin + 8) {
+        uint32_t value = 0;
+        for (unsigned i = 0; i < length; ++i) value = value * 10 + (field[i] - '0');
+        return value;
+    }
+
+    uint64_t chunk;
+    memcpy(&chunk, field + length - 8, sizeof(chunk));
+    uint64_t keep = ~uint64_t(0) << (8 * (8 - length));
+    chunk = (chunk & keep) | (0x3030303030303030ULL & ~keep);
+    return head * 100000000u + convert_eight_digits(chunk);
+}
+
+// Bits [first, last) of a window mask
+inline uint64_t bit_range(unsigned first, unsigned last) {
+    uint64_t below_last = last >= 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1;
+    return below_last & ~((uint64_t(1) << first) - 1);
+}
+
+// Parse the field [first, last) of a window if it is "[-]digits" with at most 10 digits
+inline bool parse_field(const char* window, unsigned first, unsigned last, uint64_t digit_mask,
+                        const char* begin, int32_t& value) {
+    bool neg = first < last && window[first] == '-';
+    if (neg) ++first;
+    unsigned length = last - first;
+    if (length == 0 || length > 10) return false;
+    uint64_t field_mask = bit_range(first, last);
+    if ((digit_mask & field_mask) != field_mask) return false;
+    uint32_t magnitude = convert_digits(window + first, length, begin);
+    value = static_cast<int32_t>(neg ? 0u - magnitude : magnitude);
+    return true;
+}
+
+// Window loop shared by the vectorized kernels; classify() supplies the byte masks.
+// Always inlined into the target-specific entry points so classify() is inlined as well.
+template <WindowMasks (*classify)(const char*, char)>
+__attribute__((always_inline)) inline
+size_t parse_windows(const char* begin, const char*& data, const char* end, char delimiter,
+                     int32_t* out, size_t max_pairs) {
+    size_t num_pairs = 0;
+    const char* window = data;
+    while (num_pairs < max_pairs && window < end) {
+        if (static_cast<size_t>(end - window) < WINDOW) {
+            parse_line(window, end, delimiter, out + 2 * num_pairs);
+            ++num_pairs;
+            continue;
+        }
+
+        WindowMasks masks = classify(window, delimiter);
+        uint64_t newlines = masks.newline;
+        if (newlines == 0) {    // line longer than a window
+            parse_line(window, end, delimiter, out + 2 * num_pairs);
+            ++num_pairs;
+            continue;
+        }
+
+        unsigned line_start = 0;
+        while (newlines != 0 && num_pairs < max_pairs) {
+            unsigned line_end = __builtin_ctzll(newlines);
+            newlines &= newlines - 1;
+            int32_t* pair = out + 2 * num_pairs;
+
+            bool parsed = false;
+            uint64_t delimiters = masks.delimiter & bit_range(line_start, line_end);
+            if (delimiters != 0 && (delimiters & (delimiters - 1)) == 0) {
+                unsigned split = __builtin_ctzll(delimiters);
+                unsigned value_end = line_end;
+                if (value_end > split + 1 && window[value_end - 1] == '\r') --value_end;
+                parsed = parse_field(window, line_start, split, masks.digit, begin, pair[0]) &&
+                         parse_field(window, split + 1, value_end, masks.digit, begin, pair[1]);
+            }
+            if (!parsed) {
+                const char* line = window + line_start;
+                parse_line(line, end, delimiter, pair);
+            }
+            ++num_pairs;
+            line_start = line_end + 1;
+        }
+        window += line_start;
+    }
+    data = window;
+    return num_pairs;
+}
+
+__attribute__((target("avx2")))
+size_t parse_avx2(const char* begin, const char*& data, const char* end, char delimiter,
+                  int32_t* out, size_t max_pairs) {
+    return parse_windows<classify_avx2>(begin, data, end, delimiter, out, max_pairs);
+}
+
+__attribute__((target("sse4.2")))
+size_t parse_sse42(const char* begin, const char*& data, const char* end, char delimiter,
+                   int32_t* out, size_t max_pairs) {
+    return parse_windows<classify_sse42>(begin, data, end, delimiter, out, max_pairs);
+}
+
+#endif  // DCC_PARSER_X86
+
+}  // namespace
+
+bool parse_kernel_supported(ParseKernel kernel) {
+    switch (kernel) {
+        case ParseKernel::Scalar:
+            return true;
+#ifdef DCC_PARSER_X86
+        case ParseKernel::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case ParseKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+ParseKernel best_parse_kernel() {
+    static const ParseKernel kernel = parse_kernel_supported(ParseKernel::AVX2)  ? ParseKernel::AVX2
+                                    : parse_kernel_supported(ParseKernel::SSE42) ? ParseKernel::SSE42
+                                                                                 : ParseKernel::Scalar;
+    return kernel;
+}
+
+const char* parse_kernel_name(ParseKernel kernel) {
+    switch (kernel) {
+        case ParseKernel::SSE42: return "sse4.2";
+        case ParseKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+size_t parse_pair_batch(ParseKernel kernel, const char* begin, const char*& data, const char* end,
+                        char delimiter, int32_t* out, size_t max_pairs) {
+    switch (kernel) {
+#ifdef DCC_PARSER_X86
+        case ParseKernel::AVX2:
+            return parse_avx2(begin, data, end, delimiter, out, max_pairs);
+        case ParseKernel::SSE42:
+            return parse_sse42(begin, data, end, delimiter, out, max_pairs);
+#endif
+        default:
+            return parse_scalar(data, end, delimiter, out, max_pairs);
+    }
+}
+
+char detect_delimiter(const char* data, const char* end, const std::string& filepath) {
+    const char* line_end = data;
+    while (line_end < end && *line_end != '\n') ++line_end;
+    if (line_end == data) {
+        // Empty first line; nothing to detect from
+    } else if (memchr(data, ',', line_end - data)) {
+        return ',';
+    } else if (memchr(data, '\t', line_end - data)) {
+        return '\t';
+    } else if (memchr(data, ' ', line_end - data)) {
+        return ' ';
+    }
+    throw std::invalid_argument("Could not detect filetype for " + filepath);
+}
+
+const char* skip_header(const char* data, const char* end) {
+    while (data < end && *data != '\n') ++data;
+    if (data < end) ++data;
+    return data;
+}
+
+std::vector<TextChunk> split_lines(const char* begin, const char* end, int num_chunks) {
+    std::vector<TextChunk> chunks;
+    size_t target = static_cast<size_t>(end - begin) / num_chunks + 1;
+    const char* chunk_begin = begin;
+    while (chunk_begin < end) {
+        const char* chunk_end = chunk_begin + std::min(target, static_cast<size_t>(end - chunk_begin));
+        while (chunk_end < end && *(chunk_end - 1) != '\n') ++chunk_end;
+        chunks.emplace_back(chunk_begin, chunk_end);
+        chunk_begin = chunk_end;
+    }
+    return chunks;
+}
@@ -0,0 +1,187 @@
+#include <partition_cache.hpp>
+#include <cluster_pack.hpp>
+#include <input_shards.hpp>
+#include <hash.hpp>
+#include <utils.hpp>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump when the partition output format or batching changes, to invalidate old entries
+constexpr char PARTITION_FORMAT_VERSION[] = "pack-v2";
+
+constexpr size_t SAMPLE_BLOCK = 4096;
+constexpr size_t SAMPLE_BLOCKS = 16;
+
+// Hard-link src to dst, copying when linking is not possible (e.g. across file systems)
+void link_or_copy(const fs::path& src, const fs::path& dst) {
+    fs::remove(dst);
+    std::error_code ec;
+    fs::create_hard_link(src, dst, ec);
+    if (ec) fs::copy_file(src, dst, fs::copy_options::overwrite_existing);
+}
+
+std::string temporary_name(const fs::path& path) {
+    return path.string() + ".tmp." + std::to_string(getpid());
+}
+
+}  // namespace
+
+PartitionCache::PartitionCache(Logger& logger, const std::string& cache_dir)
+    : logger(logger), cache_dir(cache_dir) {}
+
+uint64_t PartitionCache::file_fingerprint(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + " for fingerprinting");
+    }
+    struct stat st;
+    fstat(fd, &st);
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    uint64_t hash = hash_combine(FNV_OFFSET_BASIS, size);
+    hash = hash_combine(hash, static_cast<int64_t>(st.st_mtim.tv_sec));
+    hash = hash_combine(hash, static_cast<int64_t>(st.st_mtim.tv_nsec));
+
+    // Blocks spread evenly from the first to the last byte; small files are hashed whole
+    char block[SAMPLE_BLOCK];
+    uint64_t span = size > SAMPLE_BLOCK ? size - SAMPLE_BLOCK : 0;
+    size_t num_blocks = size > SAMPLE_BLOCK * SAMPLE_BLOCKS ? SAMPLE_BLOCKS : (size + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+    for (size_t i = 0; i < num_blocks; ++i) {
+        uint64_t offset = num_blocks == SAMPLE_BLOCKS ? span * i / (SAMPLE_BLOCKS - 1) : i * SAMPLE_BLOCK;
+        ssize_t read = pread(fd, block, sizeof(block), static_cast<off_t>(offset));
+        if (read > 0) hash = fnv1a64(block, static_cast<size_t>(read), hash);
+    }
+    close(fd);
+    return hash;
+}
+
+uint64_t PartitionCache::input_fingerprint(const std::string& input) {
+    if (!is_sharded_input(input)) return file_fingerprint(input);
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (const std::string& shard : expand_input(input)) {
+        hash = fnv1a64(fs::path(shard).filename().string(), hash);
+        hash = hash_combine(hash, file_fingerprint(shard));
+    }
+    return hash;
+}
+
+std::string PartitionCache::partition_key(const std::string& edgelist, const std::string& cluster_file,
+                                          float min_batch_cost, int drop_cluster_under, bool auto_accept_clique,
+                                          const PartitionOptions& options) {
+    uint64_t hash = fnv1a64(std::string(PARTITION_FORMAT_VERSION));
+    hash = hash_combine(hash, input_fingerprint(edgelist));
+    hash = hash_combine(hash, input_fingerprint(cluster_file));
+    hash = hash_combine(hash, min_batch_cost);
+    hash = hash_combine(hash, drop_cluster_under);
+    hash = hash_combine(hash, auto_accept_clique);
+    hash = hash_combine(hash, options.compress_clusters);
+    hash = hash_combine(hash, options.canonicalize_edges);
+    hash = hash_combine(hash, options.split_components);
+    hash = hash_combine(hash, options.certificates);
+    hash = hash_combine(hash, options.peel);
+    hash = hash_combine(hash, options.cost_model);
+    hash = hash_combine(hash, options.memory_limit_mb > 0);    // spilled partitioning
+    if (options.certificates || options.peel) hash = fnv1a64(options.connectedness_criterion, hash);
+    return hash_hex(hash);
+}
+
+bool PartitionCache::contains(const std::string& cache_dir, const std::string& key) {
+    return fs::exists(fs::path(cache_dir) / "partitions" / key / "summary.csv");
+}
+
+bool PartitionCache::restore(const std::string& key, const std::string& clusters_dir, const std::string& work_dir) {
+    fs::path entry = fs::path(cache_dir) / "partitions" / key;
+    if (!contains(cache_dir, key)) {
+        logger.info("Partition cache miss (key " + key + ")");
+        return false;
+    }
+
+    logger.info("Partition cache hit (key " + key + "), restoring from " + entry.string());
+    fs::create_directories(clusters_dir);
+    link_or_copy(entry / PACK_DATA_FILE, fs::path(clusters_dir) / PACK_DATA_FILE);
+    link_or_copy(entry / PACK_INDEX_FILE, fs::path(clusters_dir) / PACK_INDEX_FILE);
+    for (const char* name : {"bypass.out", PEELED_FILE}) {
+        if (!fs::exists(entry / name)) continue;
+        // Copied, not linked: bypass.out is appended to later in the run
+        fs::create_directories(work_dir + "/output");
+        fs::copy_file(entry / name, fs::path(work_dir) / "output" / name, fs::copy_options::overwrite_existing);
+    }
+    std::ofstream(fs::path(clusters_dir) / PARTITION_KEY_FILE) << key << "\n";
+
+    // summary.csv last: it marks the partition as complete
+    fs::copy_file(entry / "summary.csv", fs::path(clusters_dir) / "summary.csv", fs::copy_options::overwrite_existing);
+    return true;
+}
+
+void PartitionCache::store(const std::string& key, const std::string& clusters_dir, const std::string& work_dir) {
+    std::ofstream(fs::path(clusters_dir) / PARTITION_KEY_FILE) << key << "\n";
+    if (contains(cache_dir, key)) return;
+
+    fs::path entry = fs::path(cache_dir) / "partitions" / key;
+    fs::path staging = temporary_name(entry);
+    try {
+        fs::create_directories(staging);
+        link_or_copy(fs::path(clusters_dir) / PACK_DATA_FILE, staging / PACK_DATA_FILE);
+        link_or_copy(fs::path(clusters_dir) / PACK_INDEX_FILE, staging / PACK_INDEX_FILE);
+        fs::copy_file(fs::path(clusters_dir) / "summary.csv", staging / "summary.csv");
+        for (const char* name : {"bypass.out", PEELED_FILE}) {
+            if (fs::exists(fs::path(work_dir) / "output" / name)) {
+                fs::copy_file(fs::path(work_dir) / "output" / name, staging / name);
+            }
+        }
+
+        // Another run may have stored the same key meanwhile; either copy is valid
+        std::error_code ec;
+        fs::rename(staging, entry, ec);
+        if (ec) {
+            fs::remove_all(staging);
+        } else {
+            logger.info("Stored partition in cache as " + entry.string());
+        }
+    } catch (const fs::filesystem_error& e) {
+        // Caching is best effort and never fails the run
+        logger.error("Failed to store partition in cache: " + std::string(e.what()));
+        std::error_code ec;
+        fs::remove_all(staging, ec);
+    }
+}
+
+std::string PartitionCache::binary_edgelist(const std::string& edgelist, Partitioner& partitioner) {
+    if (is_binary_edgelist(edgelist)) return edgelist;
+    if (is_sharded_input(edgelist)) {
+        // Shards are parsed in parallel directly; a merged copy would double the disk footprint
+        logger.info("Sharded edge list " + edgelist + " is read directly, not cached as .bedgelist");
+        return edgelist;
+    }
+    if (file_compression(edgelist) != Compression::None) {
+        // The converter reads mapped text; compressed edge lists are decompressed while parsing
+        logger.info("Compressed edge list " + edgelist + " is read directly, not cached as .bedgelist");
+        return edgelist;
+    }
+
+    fs::path cached = fs::path(cache_dir) / "edgelists" / (hash_hex(file_fingerprint(edgelist)) + ".bedgelist");
+    if (fs::exists(cached)) {
+        logger.info("Using cached binary edgelist " + cached.string());
+        return cached.string();
+    }
+
+    std::string staging = temporary_name(cached);
+    try {
+        fs::create_directories(cached.parent_path());
+        partitioner.convert_edgelist(edgelist, staging);
+        fs::rename(staging, cached);
+    } catch (const std::exception& e) {
+        // Fall back to the text edge list; the partitioning itself is unaffected
+        logger.error("Failed to cache binary edgelist: " + std::string(e.what()));
+        std::error_code ec;
+        fs::remove(staging, ec);
+        return edgelist;
+    }
+    return cached.string();
+}
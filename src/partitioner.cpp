@@ -0,0 +1,1097 @@
+#include <partitioner.hpp>
+#include <parser.hpp>
+#include <utils.hpp>
+#include <parallel.hpp>
+#include <binary_format.hpp>
+#include <edge_codec.hpp>
+#include <radix_sort.hpp>
+#include <batch_packer.hpp>
+#include <input_shards.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <exception>
+#include <cstring>
+#include <limits>
+#include <cmath>
+#include <queue>
+namespace fs = std::filesystem;
+
+namespace {
+
+bool is_clique(int node_count, int64_t edge_count) {
+    return ((int64_t)node_count * (node_count - 1) / 2) == edge_count;
+}
+
+bool is_clique(ClusterInfo& cluster_info) {
+    return is_clique(cluster_info.node_count, cluster_info.edge_count);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int resolve_num_threads(int requested) {
+    if (requested > 0) return requested;
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? static_cast<int>(hardware) : 1;
+}
+
+std::string speedup_summary(int num_threads, double wall_seconds, double thread_seconds) {
+    double speedup = wall_seconds > 0 ? thread_seconds / wall_seconds : 1.0;
+    return std::to_string(num_threads) + " thread(s) in " + std::to_string(wall_seconds) + "s (" +
+           std::to_string(thread_seconds) + "s thread time, speedup " + std::to_string(speedup) + "x)";
+}
+
+// Owner rank of a cluster in distributed partitioning
+int owner_rank(int cluster_id, int num_ranks) {
+    return ((cluster_id % num_ranks) + num_ranks) % num_ranks;
+}
+
+// Upper bound on ints sent per rank in one MPI_Alltoallv round (counts are int)
+constexpr int64_t MAX_EXCHANGE_INTS = int64_t(1) << 26;
+
+// Smallest write buffer (in edges) per chunk and spill bucket; a memory limit that cannot give
+// every pair at least this much is rejected rather than exceeded
+constexpr int64_t MIN_SPILL_BUFFER_EDGES = 1024;
+
+}  // namespace
+
+// Constructor
+Partitioner::Partitioner(Logger& logger,
+                         const std::string& work_dir,
+                         float min_batch_cost,
+                         int drop_cluster_under,
+                         bool auto_accept_clique,
+                         const PartitionOptions& options,
+                         std::function<float(const ClusterInfo&)> cost_fn)
+    : logger(logger),
+      work_dir(work_dir),
+      min_batch_cost(min_batch_cost),
+      drop_cluster_under(drop_cluster_under),
+      auto_accept_clique(auto_accept_clique),
+      options(options),
+      cost_fn(std::move(cost_fn)),
+      num_threads(resolve_num_threads(options.num_threads)) {
+    if (options.certificates || options.peel) {
+        criterion.emplace(options.connectedness_criterion);
+    }
+}
+
+// Bypass a cluster - buffer its output until flush_output()
+void Partitioner::bypass_cluster(const ClusterInfo& cluster_info, std::span<const int32_t> nodes) {
+    for (const int node : nodes) {
+        pending_bypass += std::to_string(node) + "," + std::to_string(cluster_info.cluster_id) + "\n";
+    }
+
+    logger.info("Bypassed cluster " + std::to_string(cluster_info.cluster_id) +
+                " (nodes=" + std::to_string(cluster_info.node_count) + ")");
+}
+
+// Append "node_id,cluster_id" lines to <work_dir>/output/<name> (bypass.out, peeled.csv)
+void Partitioner::flush_output(const std::string& name, const std::string& output) {
+    if (output.empty()) return;
+
+    fs::create_directories(work_dir + "/output");
+
+    std::string filename = work_dir + "/output/" + name;
+    bool file_exists = fs::exists(filename);
+
+    std::ofstream out(filename, std::ios::app);
+
+    if (!out.is_open()) {
+        logger.error("Failed to create output file: " + filename);
+        throw std::runtime_error("Failed to create output file: " + filename);
+    }
+
+    if (!file_exists) {
+        out << "node_id,cluster_id\n";
+    }
+    out << output;
+    out.close();
+}
+
+// Read the clustering file into the dense cluster index
+void Partitioner::load_clustering(const std::string& cluster_file) {
+    logger.debug("Reading clustering file...");
+
+    std::vector<std::pair<int, int>> entries;  // (node_id, cluster_id) in file order
+    auto phase_start = std::chrono::steady_clock::now();
+    try {
+        InputShards shards(cluster_file, BinaryKind::Cluster, 0, 1, num_threads, "clustering file");
+        const std::vector<InputChunk>& chunks = shards.chunks();
+
+        // Parse chunks in parallel; entries are concatenated afterwards in file order
+        std::vector<std::vector<std::pair<int, int>>> chunk_entries(chunks.size());
+        std::atomic<size_t> next_chunk{0};
+        double thread_seconds = run_parallel(std::min<size_t>(num_threads, chunks.size()), [&](size_t) {
+            for (size_t i; (i = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks.size();) {
+                parse_chunk(chunks[i], [&](int node_id, int cluster_id) { chunk_entries[i].emplace_back(node_id, cluster_id); });
+            }
+        });
+        logger.info("Parsed clustering (" + std::to_string(shards.num_shards()) + " file(s)) with " +
+                    speedup_summary(num_threads, seconds_since(phase_start), thread_seconds));
+
+        size_t num_entries = 0;
+        for (const auto& chunk : chunk_entries) num_entries += chunk.size();
+        entries.reserve(num_entries);
+        for (auto& chunk : chunk_entries) {
+            entries.insert(entries.end(), chunk.begin(), chunk.end());
+            std::vector<std::pair<int, int>>().swap(chunk);
+        }
+    } catch (const std::runtime_error& e) {
+        logger.error(e.what());
+        throw;
+    }
+
+    size_t clustering_lines = entries.size();
+    phase_start = std::chrono::steady_clock::now();
+    index.build(entries);
+    logger.info("Built cluster index in " + std::to_string(seconds_since(phase_start)) + "s (" +
+                std::to_string(index.memory_bytes() / (1024 * 1024)) + " MB)");
+    logger.debug("Read " + std::to_string(clustering_lines) + " nodes in " +
+                std::to_string(index.num_clusters()) + " clusters");
+}
+
+namespace {
+
+// Group chunked intra-cluster edges by group_of(dense cluster index) with a counting sort:
+// one pass counts the edges of each group, a second scatters them in chunk order, so every
+// group keeps the order in which its edges were read.
+template <typename GroupOf>
+EdgeGroups group_edges(std::vector<std::vector<std::pair<int, int>>>& chunks, size_t num_groups,
+                       const ClusterIndex& index, GroupOf&& group_of, Logger& logger) {
+    auto phase_start = std::chrono::steady_clock::now();
+    EdgeGroups groups;
+    std::vector<int64_t> cursor(num_groups + 1, 0);
+    for (const auto& chunk : chunks) {
+        for (const auto& edge : chunk) ++cursor[group_of(index.cluster_of(edge.first)) + 1];
+    }
+    for (size_t g = 0; g < num_groups; ++g) cursor[g + 1] += cursor[g];
+    groups.offsets = cursor;
+
+    groups.edges.resize(cursor[num_groups]);
+    for (auto& chunk : chunks) {
+        for (const auto& edge : chunk) groups.edges[cursor[group_of(index.cluster_of(edge.first))]++] = edge;
+        std::vector<std::pair<int, int>>().swap(chunk);
+    }
+    logger.info("Grouped " + std::to_string(groups.edges.size()) + " intra-cluster edges into " +
+                std::to_string(num_groups) + " groups in " + std::to_string(seconds_since(phase_start)) + "s");
+    return groups;
+}
+
+}  // namespace
+
+// Parse one slice of the edge list and visit its intra-cluster edges
+template <typename Init, typename Visit>
+void Partitioner::scan_edges(const std::string& edgelist, int part, int num_parts, Init&& init, Visit&& visit) {
+    logger.debug("Reading edgelist file...");
+    std::vector<int64_t> chunk_edges;   // edges read per chunk
+    auto phase_start = std::chrono::steady_clock::now();
+    double thread_seconds = 0;
+
+    size_t num_shards = 0;
+    try {
+        // Shards (or the single file) of this slice, as chunks claimed by num_threads threads.
+        // Lookups only read the flat node -> cluster array, so they are safe from any thread.
+        InputShards shards(edgelist, BinaryKind::Edgelist, part, num_parts, num_threads, "edgelist file");
+        const std::vector<InputChunk>& chunks = shards.chunks();
+        num_shards = shards.num_shards();
+        init(chunks.size());
+        chunk_edges.assign(chunks.size(), 0);
+        std::atomic<size_t> next_chunk{0};
+        thread_seconds = run_parallel(std::min<size_t>(num_threads, chunks.size()), [&](size_t) {
+            for (size_t c; (c = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks.size();) {
+                int64_t edges = 0;
+                parse_chunk(chunks[c], [&](int source, int target) {
+                    ++edges;
+                    int32_t cluster = index.cluster_of(source);
+                    if (cluster >= 0 && cluster == index.cluster_of(target)) {
+                        visit(c, source, target, cluster);
+                    }
+                });
+                chunk_edges[c] = edges;
+            }
+        });
+    } catch (const std::runtime_error& e) {
+        logger.error(e.what());
+        throw;
+    }
+
+    int64_t total_edges = 0;
+    for (int64_t edges : chunk_edges) total_edges += edges;
+    logger.info("Scanned edges (" + std::to_string(num_shards) + " file(s)) with " +
+                speedup_summary(num_threads, seconds_since(phase_start), thread_seconds));
+    logger.debug("Read " + std::to_string(total_edges) + " edges");
+}
+
+// Read one slice of the edge list and keep its intra-cluster edges
+std::vector<std::vector<std::pair<int, int>>> Partitioner::read_edges(const std::string& edgelist,
+                                                                      int part, int num_parts) {
+    std::vector<std::vector<std::pair<int, int>>> chunks;
+    scan_edges(edgelist, part, num_parts,
+               [&](size_t num_chunks) { chunks.resize(num_chunks); },
+               [&](size_t c, int source, int target, int32_t) { chunks[c].emplace_back(source, target); });
+
+    int64_t intra_cluster_edges = 0;
+    for (const auto& chunk : chunks) intra_cluster_edges += chunk.size();
+    logger.debug("Kept " + std::to_string(intra_cluster_edges) + " intra-cluster edges");
+
+    return chunks;
+}
+
+// Route each rank's buckets to their destination ranks
+std::vector<std::pair<int, int>> Partitioner::exchange_edges(const EdgeGroups& outgoing, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    // Counts are in ints (two per edge). Large exchanges are split into rounds so that
+    // no rank sends more than MAX_EXCHANGE_INTS ints per round.
+    int64_t per_destination = std::max<int64_t>(2, (MAX_EXCHANGE_INTS / size) & ~int64_t(1));
+    int64_t local_rounds = 1;
+    for (int d = 0; d < size; ++d) {
+        local_rounds = std::max(local_rounds, (2 * outgoing.group_size(d) + per_destination - 1) / per_destination);
+    }
+    int64_t rounds = 0;
+    MPI_Allreduce(&local_rounds, &rounds, 1, MPI_INT64_T, MPI_MAX, comm);
+
+    std::vector<std::vector<int32_t>> received(size);   // per source rank, appended round by round
+    std::vector<int> send_counts(size), send_displs(size), recv_counts(size), recv_displs(size);
+    std::vector<int64_t> sent(size, 0);   // ints already sent to each destination
+    std::vector<int32_t> send_buffer, recv_buffer;
+
+    for (int64_t round = 0; round < rounds; ++round) {
+        send_buffer.clear();
+        for (int d = 0; d < size; ++d) {
+            int64_t remaining = 2 * outgoing.group_size(d) - sent[d];
+            send_counts[d] = static_cast<int>(std::min(remaining, per_destination));
+            send_displs[d] = static_cast<int>(send_buffer.size());
+            const int32_t* edges = reinterpret_cast<const int32_t*>(outgoing.group(d).data());
+            send_buffer.insert(send_buffer.end(), edges + sent[d], edges + sent[d] + send_counts[d]);
+            sent[d] += send_counts[d];
+        }
+
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+        int total_recv = 0;
+        for (int s = 0; s < size; ++s) {
+            recv_displs[s] = total_recv;
+            total_recv += recv_counts[s];
+        }
+        recv_buffer.resize(total_recv);
+
+        MPI_Alltoallv(send_buffer.data(), send_counts.data(), send_displs.data(), MPI_INT,
+                      recv_buffer.data(), recv_counts.data(), recv_displs.data(), MPI_INT, comm);
+
+        for (int s = 0; s < size; ++s) {
+            received[s].insert(received[s].end(), recv_buffer.begin() + recv_displs[s],
+                               recv_buffer.begin() + recv_displs[s] + recv_counts[s]);
+        }
+    }
+
+    // Concatenate by source rank: ranks read consecutive slices, so this restores edge-list order
+    size_t total = 0;
+    for (const auto& r : received) total += r.size();
+    std::vector<std::pair<int, int>> pairs(total / 2);
+    int32_t* out = reinterpret_cast<int32_t*>(pairs.data());
+    for (auto& r : received) {
+        out = std::copy(r.begin(), r.end(), out);
+        std::vector<int32_t>().swap(r);
+    }
+
+    logger.info("Exchanged intra-cluster edges in " + std::to_string(rounds) + " round(s), received " +
+                std::to_string(pairs.size()) + " edges");
+    return pairs;
+}
+
+// Decide which of the selected clusters are bypassed, dropped or batched together
+std::vector<Partitioner::BatchPlan> Partitioner::plan_batches(const std::vector<int64_t>& edge_counts,
+                                                              const std::function<bool(int)>& owns) {
+    int64_t certified_pass = 0, certified_fail = 0;
+
+    // Clusters to dispatch, by dense index, and their estimated costs
+    std::vector<int32_t> candidates;
+    std::vector<float> costs;
+    for (size_t cluster = 0; cluster < index.num_clusters(); ++cluster) {
+        int cluster_id = index.cluster_id(cluster);
+        if (!owns(cluster_id)) continue;
+
+        std::span<const int32_t> nodes = index.members(cluster);
+        int64_t edge_count = edge_counts[cluster];
+        ClusterInfo cluster_info{cluster_id, static_cast<int>(nodes.size()), edge_count};
+
+        // Clique bypass
+        if (auto_accept_clique && is_clique(cluster_info)) {
+            bypass_cluster(cluster_info, nodes);
+            continue;
+        }
+
+        if (edge_count == 0) {
+            logger.debug("Dropping cluster " + std::to_string(cluster_id) +
+                " (no edges, nodes=" + std::to_string(cluster_info.node_count) + ")");
+            continue;
+        }
+        if (cluster_info.node_count < drop_cluster_under) {
+            logger.debug("Dropping cluster " + std::to_string(cluster_id) +
+                " (nodes=" + std::to_string(cluster_info.node_count) +
+                " < drop_cluster_under=" + std::to_string(drop_cluster_under) + ")");
+            continue;
+        }
+
+        // Degree certificates: passing clusters are accepted as is, failing ones still need
+        // CM/WCC to split them
+        Certificate certificate = certificates.empty() ? Certificate::None : certificates[cluster];
+        if (certificate == Certificate::Pass) {
+            ++certified_pass;
+            bypass_cluster(cluster_info, nodes);
+            continue;
+        }
+        if (certificate == Certificate::Fail) {
+            ++certified_fail;
+            logger.debug("Cluster " + std::to_string(cluster_id) + " is certified not well connected");
+        }
+
+        candidates.push_back(static_cast<int32_t>(cluster));
+        costs.push_back(cost_fn(cluster_info));
+    }
+
+    // Pack small clusters together toward min_batch_cost; each batch is headed by its largest cluster
+    std::vector<BatchPlan> plans;
+    double cost_sum = 0, cost_square_sum = 0;
+    for (const std::vector<int32_t>& members : pack_batches(costs, min_batch_cost)) {
+        BatchPlan batch;
+        double batch_cost = 0;
+        for (int32_t item : members) {
+            int32_t cluster = candidates[item];
+            batch.head.node_count += static_cast<int>(index.members(cluster).size());
+            batch.head.edge_count += edge_counts[cluster];
+            batch.clusters.push_back(cluster);
+            batch_cost += costs[item];
+        }
+        batch.head.cluster_id = index.cluster_id(batch.clusters.front());
+        plans.push_back(std::move(batch));
+        cost_sum += batch_cost;
+        cost_square_sum += batch_cost * batch_cost;
+    }
+    if (!plans.empty()) {
+        double mean = cost_sum / plans.size();
+        double variance = std::max(0.0, cost_square_sum / plans.size() - mean * mean);
+        logger.info("Packed " + std::to_string(candidates.size()) + " cluster(s) into " + std::to_string(plans.size()) +
+                    " batch(es), batch cost mean " + std::to_string(mean) + ", stddev " +
+                    std::to_string(std::sqrt(variance)));
+    }
+
+    if (options.certificates) {
+        logger.info("Degree certificates: " + std::to_string(certified_pass) + " cluster(s) pass (bypassed), " +
+                    std::to_string(certified_fail) + " fail (dispatched to be split)");
+    }
+
+    return plans;
+}
+
+// Normalize, sort and deduplicate the edges of the selected clusters of cluster_edges
+void Partitioner::canonicalize_edges(const std::function<bool(int)>& owns) {
+    auto start = std::chrono::steady_clock::now();
+    size_t num_clusters = index.num_clusters();
+
+    // Each cluster is rewritten at the front of its own group, then the groups are compacted
+    std::vector<int64_t> kept(num_clusters);
+    std::vector<int64_t> self_loops(num_clusters, 0);
+    std::atomic<size_t> next_cluster{0};
+    double thread_seconds = run_parallel(num_threads, [&](size_t) {
+        std::vector<uint64_t> keys, scratch;
+        for (size_t cluster; (cluster = next_cluster.fetch_add(1, std::memory_order_relaxed)) < num_clusters;) {
+            kept[cluster] = cluster_edges.group_size(cluster);
+            if (!owns(index.cluster_id(cluster))) continue;
+            std::pair<int, int>* edges = cluster_edges.edges.data() + cluster_edges.offsets[cluster];
+
+            keys.clear();
+            for (int64_t e = 0; e < kept[cluster]; ++e) {
+                auto [source, target] = edges[e];
+                if (source == target) {
+                    ++self_loops[cluster];
+                    continue;
+                }
+                keys.push_back(edge_key(std::min(source, target), std::max(source, target)));
+            }
+            radix_sort(keys, scratch);
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            for (size_t e = 0; e < keys.size(); ++e) edges[e] = edge_of_key(keys[e]);
+            kept[cluster] = static_cast<int64_t>(keys.size());
+        }
+    });
+
+    int64_t total_before = static_cast<int64_t>(cluster_edges.edges.size());
+    int64_t write_at = 0;
+    for (size_t cluster = 0; cluster < num_clusters; ++cluster) {
+        auto first = cluster_edges.edges.begin() + cluster_edges.offsets[cluster];
+        std::copy(first, first + kept[cluster], cluster_edges.edges.begin() + write_at);
+        cluster_edges.offsets[cluster] = write_at;
+        write_at += kept[cluster];
+    }
+    cluster_edges.offsets[num_clusters] = write_at;
+    cluster_edges.edges.resize(write_at);
+
+    int64_t total_loops = 0;
+    for (int64_t loops : self_loops) total_loops += loops;
+    int64_t duplicates = total_before - write_at - total_loops;
+    logger.info("Canonicalized edges: removed " + std::to_string(duplicates) + " duplicate(s) and " +
+                std::to_string(total_loops) + " self-loop(s), " + std::to_string(write_at) + " edge(s) left, on " +
+                speedup_summary(num_threads, seconds_since(start), thread_seconds));
+}
+
+// Split the selected clusters of cluster_edges into their connected components
+void Partitioner::split_components(const std::function<bool(int)>& owns, int rank, int num_ranks) {
+    auto start = std::chrono::steady_clock::now();
+    size_t num_clusters = index.num_clusters();
+
+    // Component of every member of each disconnected cluster (empty when connected), numbered
+    // in order of their smallest node
+    std::vector<std::vector<int32_t>> components(num_clusters);
+    std::vector<int32_t> num_components(num_clusters, 1);
+    std::atomic<size_t> next_cluster{0};
+    double thread_seconds = run_parallel(num_threads, [&](size_t) {
+        std::vector<int32_t> parent;
+        for (size_t cluster; (cluster = next_cluster.fetch_add(1, std::memory_order_relaxed)) < num_clusters;) {
+            if (!owns(index.cluster_id(cluster))) continue;
+            std::span<const int32_t> members = index.members(cluster);
+            auto local_id = [&](int node) {
+                return static_cast<int32_t>(std::lower_bound(members.begin(), members.end(), node) - members.begin());
+            };
+            auto find = [&](int32_t x) {
+                while (parent[x] != x) x = parent[x] = parent[parent[x]];
+                return x;
+            };
+
+            parent.resize(members.size());
+            for (size_t i = 0; i < members.size(); ++i) parent[i] = static_cast<int32_t>(i);
+            size_t unions = 0;
+            for (const auto& [source, target] : cluster_edges.group(cluster)) {
+                int32_t a = find(local_id(source)), b = find(local_id(target));
+                if (a == b) continue;
+                parent[std::max(a, b)] = std::min(a, b);
+                ++unions;
+            }
+            if (unions + 1 >= members.size()) continue;
+
+            std::vector<int32_t>& component = components[cluster];
+            component.assign(members.size(), -1);
+            int32_t count = 0;
+            for (size_t i = 0; i < members.size(); ++i) {
+                int32_t root = find(static_cast<int32_t>(i));
+                if (component[root] < 0) component[root] = count++;
+                component[i] = component[root];
+            }
+            num_components[cluster] = count;
+        }
+    });
+
+    size_t split_clusters = 0;
+    for (const auto& component : components) split_clusters += component.empty() ? 0 : 1;
+    if (split_clusters == 0) {
+        logger.info("All clusters are connected (checked with " +
+                    speedup_summary(num_threads, seconds_since(start), thread_seconds) + ")");
+        return;
+    }
+
+    // New ids continue after the largest cluster id, interleaved by owner rank
+    int64_t max_cluster_id = num_clusters > 0 ? index.cluster_id(static_cast<int32_t>(num_clusters - 1)) : 0;
+    int64_t base_id = (max_cluster_id + 1 + num_ranks - 1) / num_ranks * num_ranks;
+    int64_t new_components = 0;
+    auto next_id = [&]() {
+        int64_t id = base_id + new_components++ * num_ranks + rank;
+        if (id > std::numeric_limits<int32_t>::max()) {
+            logger.error("Cluster ids overflow while splitting components");
+            throw std::runtime_error("Cluster ids overflow while splitting components");
+        }
+        return static_cast<int>(id);
+    };
+
+    std::vector<std::pair<int, int>> entries;
+    entries.reserve(index.num_memberships());
+    int64_t kept_components = 0, dropped_components = 0, dropped_nodes = 0;
+    for (size_t cluster = 0; cluster < num_clusters; ++cluster) {
+        std::span<const int32_t> members = index.members(cluster);
+        const std::vector<int32_t>& component = components[cluster];
+        if (component.empty()) {
+            for (int node : members) entries.emplace_back(node, index.cluster_id(cluster));
+            continue;
+        }
+
+        std::vector<int32_t> sizes(num_components[cluster], 0);
+        for (int32_t c : component) ++sizes[c];
+        std::vector<int> ids(sizes.size(), -1);   // -1: dropped
+        for (size_t c = 0; c < sizes.size(); ++c) {
+            if (sizes[c] < 2 || sizes[c] < drop_cluster_under) {
+                ++dropped_components;
+                dropped_nodes += sizes[c];
+                continue;
+            }
+            ids[c] = c == 0 ? index.cluster_id(cluster) : next_id();
+            ++kept_components;
+        }
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (ids[component[i]] >= 0) entries.emplace_back(members[i], ids[component[i]]);
+        }
+    }
+    rebuild_clusters(entries);
+
+    logger.info("Split " + std::to_string(split_clusters) + " disconnected cluster(s) into " +
+                std::to_string(kept_components) + " component(s), dropped " +
+                std::to_string(dropped_components) + " singleton or small component(s) with " +
+                std::to_string(dropped_nodes) + " node(s), in " +
+                speedup_summary(num_threads, seconds_since(start), thread_seconds));
+}
+
+// Peel the selected clusters of cluster_edges down to the cores CM's prune mode would keep
+void Partitioner::peel_clusters(const std::function<bool(int)>& owns) {
+    auto start = std::chrono::steady_clock::now();
+    size_t num_clusters = index.num_clusters();
+
+    // Members that survive peeling, per cluster (empty when nothing is peeled)
+    std::vector<std::vector<char>> survivors(num_clusters);
+    std::atomic<size_t> next_cluster{0};
+    double thread_seconds = run_parallel(num_threads, [&](size_t) {
+        for (size_t cluster; (cluster = next_cluster.fetch_add(1, std::memory_order_relaxed)) < num_clusters;) {
+            if (!owns(index.cluster_id(cluster))) continue;
+            std::span<const int32_t> members = index.members(cluster);
+            std::span<const std::pair<int, int>> edges = cluster_edges.group(cluster);
+            auto local_id = [&](int node) {
+                return static_cast<int32_t>(std::lower_bound(members.begin(), members.end(), node) - members.begin());
+            };
+
+            // Local adjacency in CSR form; a self-loop adds 2 to its node's degree
+            size_t n = members.size();
+            std::vector<int64_t> offsets(n + 1, 0);
+            for (const auto& [source, target] : edges) {
+                ++offsets[local_id(source) + 1];
+                ++offsets[local_id(target) + 1];
+            }
+            std::vector<int64_t> degree(n);
+            for (size_t u = 0; u < n; ++u) degree[u] = offsets[u + 1];
+            for (size_t u = 0; u < n; ++u) offsets[u + 1] += offsets[u];
+            std::vector<int32_t> neighbors(offsets[n]);
+            std::vector<int64_t> next(offsets.begin(), offsets.end() - 1);
+            for (const auto& [source, target] : edges) {
+                int32_t u = local_id(source), v = local_id(target);
+                neighbors[next[u]++] = v;
+                neighbors[next[v]++] = u;
+            }
+
+            // Remove the lowest-degree node while it is a cut no larger than the threshold
+            using Entry = std::pair<int64_t, int32_t>;  // (degree, node)
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+            for (size_t u = 0; u < n; ++u) queue.emplace(degree[u], static_cast<int32_t>(u));
+            std::vector<char> alive(n, 1);
+            size_t num_alive = n;
+            while (!queue.empty()) {
+                auto [d, u] = queue.top();
+                if (!alive[u] || d != degree[u]) {
+                    queue.pop();
+                    continue;
+                }
+                if (static_cast<double>(d) > criterion->threshold(static_cast<int64_t>(num_alive))) break;
+                queue.pop();
+                alive[u] = 0;
+                --num_alive;
+                for (int64_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+                    int32_t v = neighbors[i];
+                    if (v == u || !alive[v]) continue;
+                    queue.emplace(--degree[v], v);
+                }
+            }
+            if (num_alive < n) survivors[cluster] = std::move(alive);
+        }
+    });
+
+    int64_t peeled_clusters = 0, peeled_nodes = 0;
+    std::vector<std::pair<int, int>> entries;
+    entries.reserve(index.num_memberships());
+    for (size_t cluster = 0; cluster < num_clusters; ++cluster) {
+        std::span<const int32_t> members = index.members(cluster);
+        const std::vector<char>& alive = survivors[cluster];
+        int cluster_id = index.cluster_id(cluster);
+        if (!alive.empty()) ++peeled_clusters;
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (alive.empty() || alive[i]) {
+                entries.emplace_back(members[i], cluster_id);
+            } else {
+                pending_peeled += std::to_string(members[i]) + "," + std::to_string(cluster_id) + "\n";
+                ++peeled_nodes;
+            }
+        }
+    }
+    if (peeled_clusters > 0) rebuild_clusters(entries);
+
+    logger.info("Peeled " + std::to_string(peeled_nodes) + " node(s) from " + std::to_string(peeled_clusters) +
+                " cluster(s) on " + speedup_summary(num_threads, seconds_since(start), thread_seconds));
+}
+
+// Rebuild the index from new memberships and drop the edges that no longer lie inside a cluster
+void Partitioner::rebuild_clusters(std::vector<std::pair<int, int>>& entries) {
+    index.build(entries);
+
+    std::vector<std::vector<std::pair<int, int>>> chunks(1);
+    chunks[0] = std::move(cluster_edges.edges);
+    cluster_edges = EdgeGroups{};
+    std::erase_if(chunks[0], [&](const std::pair<int, int>& edge) {
+        int32_t cluster = index.cluster_of(edge.first);
+        return cluster < 0 || cluster != index.cluster_of(edge.second);
+    });
+    cluster_edges = group_edges(chunks, index.num_clusters(), index, [](int32_t cluster) { return cluster; }, logger);
+}
+
+// Batch the selected clusters of cluster_edges
+std::vector<Partitioner::BatchPlan> Partitioner::plan_grouped_batches(const std::function<bool(int)>& owns,
+                                                                      int rank, int num_ranks) {
+    if (options.canonicalize_edges) {
+        canonicalize_edges(owns);
+    }
+    if (options.split_components) {
+        split_components(owns, rank, num_ranks);
+    }
+    if (options.peel) {
+        peel_clusters(owns);
+    }
+
+    std::vector<int64_t> edge_counts(index.num_clusters());
+    for (size_t cluster = 0; cluster < edge_counts.size(); ++cluster) {
+        edge_counts[cluster] = cluster_edges.group_size(cluster);
+    }
+
+    if (options.certificates) {
+        // Clusters are claimed one at a time so a few large ones do not serialize the pass
+        auto start = std::chrono::steady_clock::now();
+        certificates.assign(index.num_clusters(), Certificate::None);
+        std::atomic<size_t> next_cluster{0};
+        double thread_seconds = run_parallel(num_threads, [&](size_t) {
+            for (size_t cluster; (cluster = next_cluster.fetch_add(1, std::memory_order_relaxed)) < certificates.size();) {
+                if (!owns(index.cluster_id(cluster))) continue;
+                certificates[cluster] = certify_cluster(*criterion, index.members(cluster), cluster_edges.group(cluster));
+            }
+        });
+        logger.info("Checked degree certificates on " + speedup_summary(num_threads, seconds_since(start), thread_seconds));
+    }
+    std::vector<BatchPlan> plans = plan_batches(edge_counts, owns);
+    certificates.clear();
+    return plans;
+}
+
+// Open the cluster pack batches are appended to
+void Partitioner::open_pack(const std::string& output_dir, uint64_t base_offset, bool truncate) {
+    logger.info("Writing cluster pack to " + output_dir);
+    fs::create_directories(output_dir);
+    pack = std::make_unique<ClusterPackWriter>(output_dir, base_offset, truncate, pack_edge_format());
+}
+
+// Edge encoding of pack payloads selected by the options
+PackEdgeFormat Partitioner::pack_edge_format() const {
+    return options.compress_clusters ? PackEdgeFormat::Compressed : PackEdgeFormat::Raw;
+}
+
+// Pack payload size of a batch of cluster_edges
+uint64_t Partitioner::payload_length(const BatchPlan& batch) const {
+    if (!options.compress_clusters) {
+        return pack_payload_length(batch.head.node_count, batch.head.edge_count);
+    }
+    std::vector<std::pair<int, int>> batch_edges;
+    batch_edges.reserve(batch.head.edge_count);
+    for (int32_t cluster : batch.clusters) {
+        std::span<const std::pair<int, int>> edges = cluster_edges.group(cluster);
+        batch_edges.insert(batch_edges.end(), edges.begin(), edges.end());
+    }
+    return compressed_edges_length(batch_edges) + pack_cluster_length(batch.head.node_count);
+}
+
+// Append one batch to the cluster pack
+void Partitioner::write_batch(const BatchPlan& batch,
+                              const std::function<std::span<const std::pair<int, int>>(int32_t)>& edges_of) {
+    std::vector<std::pair<int, int>> batch_edges;
+    std::vector<std::pair<int, int>> batch_cluster_entries;  // (node_id, cluster_id)
+    batch_edges.reserve(batch.head.edge_count);
+    batch_cluster_entries.reserve(batch.head.node_count);
+    for (int32_t cluster : batch.clusters) {
+        std::span<const std::pair<int, int>> edges = edges_of(cluster);
+        batch_edges.insert(batch_edges.end(), edges.begin(), edges.end());
+        for (int node : index.members(cluster)) {
+            batch_cluster_entries.emplace_back(node, index.cluster_id(cluster));
+        }
+    }
+
+    pack->append(batch.head, batch_edges, batch_cluster_entries);
+}
+
+// Append the planned batches of cluster_edges to the cluster pack
+void Partitioner::write_batches(const std::vector<BatchPlan>& plans) {
+    for (const BatchPlan& batch : plans) {
+        write_batch(batch, [&](int32_t cluster) { return cluster_edges.group(cluster); });
+    }
+}
+
+// Write the pack index and summary; summary.csv is written last and marks Phase 1 as complete
+std::vector<ClusterInfo> Partitioner::finish_pack(const std::string& output_dir,
+                                                  const std::vector<PackIndexEntry>& entries) {
+    write_pack_index(output_dir, entries);
+
+    std::vector<ClusterInfo> created_clusters;
+    created_clusters.reserve(entries.size());
+    for (const PackIndexEntry& entry : entries) {
+        created_clusters.push_back({entry.cluster_id, entry.node_count, entry.edge_count});
+    }
+    pack.reset();
+    write_summary(output_dir, created_clusters);
+    return created_clusters;
+}
+
+// Partition with intra-cluster edges spilled to disk, keeping memory within the limit
+void Partitioner::partition_out_of_core(const std::string& edgelist) {
+    using Edge = std::pair<int, int>;
+    int64_t budget = options.memory_limit_mb * 1024 * 1024;
+    size_t num_clusters = index.num_clusters();
+
+    // Pass 1: count the intra-cluster edges of every cluster
+    std::vector<std::atomic<int64_t>> shared_counts(num_clusters);
+    size_t num_chunks = 0;
+    scan_edges(edgelist, 0, 1, [&](size_t chunks) { num_chunks = chunks; },
+               [&](size_t, int, int, int32_t cluster) { shared_counts[cluster].fetch_add(1, std::memory_order_relaxed); });
+    std::vector<int64_t> edge_counts(num_clusters);
+    int64_t intra_cluster_edges = 0;
+    for (size_t cluster = 0; cluster < num_clusters; ++cluster) {
+        edge_counts[cluster] = shared_counts[cluster].load(std::memory_order_relaxed);
+        intra_cluster_edges += edge_counts[cluster];
+    }
+    std::vector<std::atomic<int64_t>>().swap(shared_counts);
+
+    if (intra_cluster_edges * static_cast<int64_t>(2 * sizeof(Edge)) <= budget) {
+        logger.info(std::to_string(intra_cluster_edges) + " intra-cluster edges fit in the " +
+                    std::to_string(options.memory_limit_mb) + " MB partition memory limit, partitioning in memory");
+        std::vector<std::vector<Edge>> chunks = read_edges(edgelist, 0, 1);
+        cluster_edges = group_edges(chunks, num_clusters, index, [](int32_t cluster) { return cluster; }, logger);
+        write_batches(plan_grouped_batches([](int) { return true; }));
+        cluster_edges = EdgeGroups{};
+        return;
+    }
+
+    // The per-cluster passes of plan_grouped_batches need every cluster's edges in memory
+    if (options.canonicalize_edges || options.split_components || options.peel || options.certificates) {
+        std::string message = "Edge canonicalization, component splitting, peeling and degree certificates "
+                              "cannot run when intra-cluster edges exceed the partition memory limit of " +
+                              std::to_string(options.memory_limit_mb) + " MB";
+        logger.error(message);
+        throw std::runtime_error(message);
+    }
+
+    // Plan batches from the counts, then group consecutive batches into spill buckets whose
+    // edges fit in half the budget (the rest covers write buffers and the batch being written)
+    std::vector<BatchPlan> plans = plan_batches(edge_counts, [](int) { return true; });
+    int64_t bucket_capacity = std::max<int64_t>(1, budget / 2 / static_cast<int64_t>(sizeof(Edge)));
+    std::vector<size_t> bucket_first_batch;
+    std::vector<int32_t> cluster_bucket(num_clusters, -1);  // -1: bypassed or dropped
+    int64_t bucket_edges = 0;
+    for (size_t b = 0; b < plans.size(); ++b) {
+        if (bucket_first_batch.empty() || (bucket_edges > 0 && bucket_edges + plans[b].head.edge_count > bucket_capacity)) {
+            bucket_first_batch.push_back(b);
+            bucket_edges = 0;
+        }
+        bucket_edges += plans[b].head.edge_count;
+        for (int32_t cluster : plans[b].clusters) {
+            cluster_bucket[cluster] = static_cast<int32_t>(bucket_first_batch.size() - 1);
+        }
+    }
+    size_t num_buckets = bucket_first_batch.size();
+    bucket_first_batch.push_back(plans.size());
+
+    // Write buffers share a quarter of the budget, one per chunk and bucket
+    int64_t buffer_pool = budget / 4 / static_cast<int64_t>(sizeof(Edge));
+    int64_t fan_out = static_cast<int64_t>(std::max<size_t>(1, num_chunks) * num_buckets);
+    if (buffer_pool / fan_out < MIN_SPILL_BUFFER_EDGES) {
+        std::string message = "Partition memory limit of " + std::to_string(options.memory_limit_mb) +
+            " MB is too small to spill " + std::to_string(intra_cluster_edges) + " intra-cluster edges (" +
+            std::to_string(num_buckets) + " buckets x " + std::to_string(num_chunks) +
+            " chunks of write buffers do not fit in a quarter of it); raise --partition-memory-limit" +
+            " or lower --partition-threads";
+        logger.error(message);
+        throw std::runtime_error(message);
+    }
+    size_t buffer_edges = static_cast<size_t>(buffer_pool / fan_out);
+
+    std::string spill_dir = work_dir + "/partition_spill";
+    fs::remove_all(spill_dir);
+    fs::create_directories(spill_dir);
+    auto spill_file = [&](size_t chunk) { return spill_dir + "/" + std::to_string(chunk) + ".bin"; };
+
+    // Pass 2: every chunk appends its buffers to one file of its own, kept open, and records
+    // where each bucket's blocks landed; reading a bucket's blocks in chunk order restores
+    // edge-list order
+    struct SpillBlock {
+        uint64_t offset;    // in the chunk's spill file
+        uint64_t edges;
+    };
+    std::vector<std::vector<std::vector<SpillBlock>>> blocks;   // [chunk][bucket]
+    std::vector<std::ofstream> spill_out;                       // by chunk
+    std::vector<uint64_t> spill_size;                           // by chunk
+    std::vector<std::vector<std::vector<Edge>>> buffers;        // [chunk][bucket]
+    auto flush_spill = [&](size_t chunk, size_t bucket) {
+        std::vector<Edge>& buffer = buffers[chunk][bucket];
+        if (buffer.empty()) return;
+        std::ofstream& out = spill_out[chunk];
+        if (!out.is_open()) {
+            out.open(spill_file(chunk), std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                logger.error("Failed to open spill file: " + spill_file(chunk));
+                throw std::runtime_error("Failed to open spill file: " + spill_file(chunk));
+            }
+        }
+        out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(Edge));
+        if (!out) throw std::runtime_error("Failed to write spill file: " + spill_file(chunk));
+        blocks[chunk][bucket].push_back({spill_size[chunk], buffer.size()});
+        spill_size[chunk] += buffer.size() * sizeof(Edge);
+        buffer.clear();
+    };
+
+    auto phase_start = std::chrono::steady_clock::now();
+    scan_edges(edgelist, 0, 1,
+        [&](size_t chunks) {
+            if (chunks != num_chunks) throw std::runtime_error("Edge list changed between partitioning passes");
+            blocks.assign(num_chunks, std::vector<std::vector<SpillBlock>>(num_buckets));
+            spill_out = std::vector<std::ofstream>(num_chunks);
+            spill_size.assign(num_chunks, 0);
+            buffers.assign(num_chunks, std::vector<std::vector<Edge>>(num_buckets));
+        },
+        [&](size_t chunk, int source, int target, int32_t cluster) {
+            int32_t bucket = cluster_bucket[cluster];
+            if (bucket < 0) return;
+            std::vector<Edge>& buffer = buffers[chunk][bucket];
+            if (buffer.capacity() == 0) buffer.reserve(buffer_edges);
+            buffer.emplace_back(source, target);
+            if (buffer.size() >= buffer_edges) flush_spill(chunk, bucket);
+        });
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        for (size_t bucket = 0; bucket < num_buckets; ++bucket) flush_spill(chunk, bucket);
+        spill_out[chunk].close();
+    }
+    buffers.clear();
+    logger.info("Spilled " + std::to_string(intra_cluster_edges) + " intra-cluster edges into " +
+                std::to_string(num_buckets) + " bucket(s) in " + std::to_string(seconds_since(phase_start)) +
+                "s (memory limit " + std::to_string(options.memory_limit_mb) + " MB)");
+
+    // Finalize each bucket: read its blocks back in chunk order, group the edges per cluster
+    // in that order and append the bucket's batches to the pack
+    phase_start = std::chrono::steady_clock::now();
+
+    std::vector<int32_t> cluster_slot(num_clusters, -1);    // position of a cluster within its bucket
+    std::vector<Edge> read_buffer(static_cast<size_t>(std::clamp<int64_t>(bucket_capacity / 16, 1, buffer_pool)));
+    std::vector<std::ifstream> spill_in(num_chunks);
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        if (spill_size[chunk] > 0) spill_in[chunk].open(spill_file(chunk), std::ios::binary);
+    }
+    for (size_t bucket = 0; bucket < num_buckets; ++bucket) {
+        std::vector<int64_t> slot_offsets{0};
+        for (size_t b = bucket_first_batch[bucket]; b < bucket_first_batch[bucket + 1]; ++b) {
+            for (int32_t cluster : plans[b].clusters) {
+                cluster_slot[cluster] = static_cast<int32_t>(slot_offsets.size() - 1);
+                slot_offsets.push_back(slot_offsets.back() + edge_counts[cluster]);
+            }
+        }
+
+        std::vector<Edge> edges(slot_offsets.back());
+        std::vector<int64_t> cursor(slot_offsets.begin(), slot_offsets.end() - 1);
+        for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+            std::ifstream& in = spill_in[chunk];
+            for (const SpillBlock& block : blocks[chunk][bucket]) {
+                in.seekg(static_cast<std::streamoff>(block.offset));
+                for (uint64_t done = 0; done < block.edges;) {
+                    size_t count = static_cast<size_t>(std::min<uint64_t>(read_buffer.size(), block.edges - done));
+                    in.read(reinterpret_cast<char*>(read_buffer.data()), count * sizeof(Edge));
+                    if (static_cast<size_t>(in.gcount()) != count * sizeof(Edge)) {
+                        throw std::runtime_error("Truncated spill file: " + spill_file(chunk));
+                    }
+                    for (size_t i = 0; i < count; ++i) {
+                        const Edge& edge = read_buffer[i];
+                        edges[cursor[cluster_slot[index.cluster_of(edge.first)]]++] = edge;
+                    }
+                    done += count;
+                }
+            }
+            std::vector<SpillBlock>().swap(blocks[chunk][bucket]);
+        }
+
+        for (size_t b = bucket_first_batch[bucket]; b < bucket_first_batch[bucket + 1]; ++b) {
+            write_batch(plans[b], [&](int32_t cluster) {
+                int32_t slot = cluster_slot[cluster];
+                return std::span<const Edge>(edges.data() + slot_offsets[slot],
+                                             static_cast<size_t>(slot_offsets[slot + 1] - slot_offsets[slot]));
+            });
+        }
+    }
+    spill_in.clear();
+    fs::remove_all(spill_dir);
+    logger.info("Wrote " + std::to_string(num_buckets) + " spill bucket(s) in " +
+                std::to_string(seconds_since(phase_start)) + "s");
+}
+
+// Write summary file for quicker load
+void Partitioner::write_summary(const std::string& output_dir, const std::vector<ClusterInfo>& created_clusters) {
+    std::string summary_filename = output_dir + "/summary.csv";
+    std::ofstream out_summary(summary_filename);
+    out_summary << "cluster_id,node_count,edge_count\n";
+    for (const auto& cluster : created_clusters)
+        out_summary << cluster.cluster_id << "," << cluster.node_count << "," << cluster.edge_count << "\n";
+}
+
+// Write a text edge list as a .bedgelist (see convert_text_pairs)
+int64_t Partitioner::convert_edgelist(const std::string& edgelist, const std::string& output) {
+    auto phase_start = std::chrono::steady_clock::now();
+    ConvertOptions convert_options;
+    convert_options.num_threads = num_threads;
+    ConvertStats stats;
+    try {
+        stats = convert_text_pairs(edgelist, output, BinaryKind::Edgelist, convert_options);
+    } catch (const std::runtime_error& e) {
+        logger.error(e.what());
+        throw;
+    }
+
+    logger.info("Converted " + std::to_string(stats.num_records) + " edges to " + output + " with " +
+                speedup_summary(num_threads, seconds_since(phase_start), stats.thread_seconds));
+    return static_cast<int64_t>(stats.num_records);
+}
+
+// Partition clustering into separate cluster files
+std::vector<ClusterInfo> Partitioner::partition(const std::string& edgelist,
+                                                const std::string& cluster_file,
+                                                const std::string& output_dir) {
+    logger.debug("Start partitioning initial clustering");
+    logger.debug(">> Edgelist: " + edgelist);
+    logger.debug(">> Clustering: " + cluster_file);
+    logger.debug(">> Output directory: " + output_dir);
+    logger.info("Partitioning with " + std::to_string(num_threads) + " thread(s), " +
+                parse_kernel_name(best_parse_kernel()) + " parser");
+
+    load_clustering(cluster_file);
+
+    open_pack(output_dir, 0, true);
+    if (options.memory_limit_mb > 0) {
+        partition_out_of_core(edgelist);
+    } else {
+        std::vector<std::vector<std::pair<int, int>>> chunks = read_edges(edgelist, 0, 1);
+        cluster_edges = group_edges(chunks, index.num_clusters(), index,
+                                    [](int32_t cluster) { return cluster; }, logger);
+        write_batches(plan_grouped_batches([](int) { return true; }));
+    }
+    flush_output("bypass.out", pending_bypass);
+    flush_output(PEELED_FILE, pending_peeled);
+    pending_bypass.clear();
+    pending_peeled.clear();
+    std::vector<ClusterInfo> created_clusters = finish_pack(output_dir, pack->index());
+
+    logger.info("partition_clustering completed successfully. " +
+               std::to_string(index.num_clusters()) + " clusters written to " +
+               std::to_string(created_clusters.size()) + " batches in " + PACK_DATA_FILE);
+
+    return created_clusters;
+}
+
+// Concatenate the pending output of every rank on rank 0
+std::string Partitioner::gather_output(std::string& pending, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    int length = static_cast<int>(pending.size());
+    std::vector<int> lengths(size), displs(size);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+    std::string output;
+    if (rank == 0) {
+        int total = 0;
+        for (int r = 0; r < size; ++r) { displs[r] = total; total += lengths[r]; }
+        output.resize(total);
+    }
+    MPI_Gatherv(pending.data(), length, MPI_CHAR, output.data(), lengths.data(), displs.data(), MPI_CHAR, 0, comm);
+    pending.clear();
+    return output;
+}
+
+// Collective partitioning across all ranks of comm
+std::vector<ClusterInfo> Partitioner::partition_distributed(const std::string& edgelist,
+                                                            const std::string& cluster_file,
+                                                            const std::string& output_dir,
+                                                            MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    logger.debug("Start distributed partitioning of initial clustering");
+    logger.debug(">> Edgelist: " + edgelist);
+    logger.debug(">> Clustering: " + cluster_file);
+    logger.debug(">> Output directory: " + output_dir);
+    logger.info("Partitioning slice " + std::to_string(rank) + "/" + std::to_string(size) +
+                " with " + std::to_string(num_threads) + " thread(s), " +
+                parse_kernel_name(best_parse_kernel()) + " parser");
+
+    // Every rank holds the whole clustering so it can classify the edges of its slice. This is
+    // a per-rank memory floor that does not shrink with more ranks; only edge memory does.
+    load_clustering(cluster_file);
+
+    auto owner_of = [size](int cluster_id) { return owner_rank(cluster_id, size); };
+    std::vector<std::vector<std::pair<int, int>>> chunks = read_edges(edgelist, rank, size);
+    EdgeGroups outgoing = group_edges(chunks, size, index,
+                                      [&](int32_t cluster) { return owner_of(index.cluster_id(cluster)); }, logger);
+    std::vector<std::vector<std::pair<int, int>>> received(1);
+    received[0] = exchange_edges(outgoing, comm);
+    outgoing = EdgeGroups{};
+    cluster_edges = group_edges(received, index.num_clusters(), index,
+                                [](int32_t cluster) { return cluster; }, logger);
+
+    // Place this rank's payloads after those of lower ranks in the shared pack
+    std::vector<BatchPlan> plans = plan_grouped_batches([&](int cluster_id) { return owner_of(cluster_id) == rank; },
+                                                        rank, size);
+    uint64_t local_bytes = 0;
+    for (const BatchPlan& batch : plans) {
+        local_bytes += payload_length(batch);
+    }
+    uint64_t base_offset = 0;
+    MPI_Exscan(&local_bytes, &base_offset, 1, MPI_UINT64_T, MPI_SUM, comm);
+    if (rank == 0) {
+        base_offset = 0;    // MPI_Exscan leaves rank 0's result undefined
+        open_pack(output_dir, 0, true);
+    }
+    MPI_Barrier(comm);      // pack created and truncated before other ranks open it
+    if (rank != 0) open_pack(output_dir, base_offset, false);
+    write_batches(plans);
+    std::vector<PackIndexEntry> local_entries = pack->index();
+    if (rank != 0) pack.reset();
+    logger.info("Wrote " + std::to_string(local_entries.size()) + " batches for owned clusters");
+
+    // Gather bypass and peel output and created batches on rank 0
+    std::string bypass_output = gather_output(pending_bypass, comm);
+    std::string peeled_output = gather_output(pending_peeled, comm);
+
+    int created_bytes = static_cast<int>(local_entries.size() * sizeof(PackIndexEntry));
+    std::vector<int> created_lengths(size), created_displs(size);
+    MPI_Gather(&created_bytes, 1, MPI_INT, created_lengths.data(), 1, MPI_INT, 0, comm);
+    std::vector<PackIndexEntry> entries;
+    if (rank == 0) {
+        int total = 0;
+        for (int r = 0; r < size; ++r) { created_displs[r] = total; total += created_lengths[r]; }
+        entries.resize(total / sizeof(PackIndexEntry));
+    }
+    MPI_Gatherv(local_entries.data(), created_bytes, MPI_BYTE,
+                entries.data(), created_lengths.data(), created_displs.data(), MPI_BYTE, 0, comm);
+
+    std::vector<ClusterInfo> created_clusters;
+    if (rank == 0) {
+        flush_output("bypass.out", bypass_output);
+        flush_output(PEELED_FILE, peeled_output);
+        created_clusters = finish_pack(output_dir, entries);
+        logger.info("partition_clustering completed successfully (distributed over " + std::to_string(size) +
+                   " ranks). " + std::to_string(index.num_clusters()) + " clusters written to " +
+                   std::to_string(created_clusters.size()) + " batches in " + PACK_DATA_FILE);
+    }
+
+    return created_clusters;
+}
@@ -0,0 +1,65 @@
+#include <slot_index.hpp>
+#include <algorithm>
+
+uint32_t SlotIndex::find(int64_t cluster_id) const {
+    if (entries.empty()) return NONE;
+    for (size_t i = home(cluster_id);; i = (i + 1) & mask) {
+        if (entries[i].cluster_id == cluster_id) return entries[i].slot;
+        if (entries[i].cluster_id == EMPTY_KEY) return NONE;
+    }
+}
+
+bool SlotIndex::insert(int64_t cluster_id, uint32_t slot) {
+    // Keep the load factor under 1/2
+    if (2 * (count + 1) > entries.size()) rehash(std::max<size_t>(16, 2 * entries.size()));
+    size_t i = home(cluster_id);
+    for (; entries[i].cluster_id != EMPTY_KEY; i = (i + 1) & mask) {
+        if (entries[i].cluster_id == cluster_id) return false;
+    }
+    entries[i] = {cluster_id, slot};
+    ++count;
+    return true;
+}
+
+bool SlotIndex::erase(int64_t cluster_id) {
+    if (entries.empty()) return false;
+    size_t hole = home(cluster_id);
+    for (; entries[hole].cluster_id != cluster_id; hole = (hole + 1) & mask) {
+        if (entries[hole].cluster_id == EMPTY_KEY) return false;
+    }
+    // Backward-shift the entries after the hole that probed past it
+    for (size_t i = (hole + 1) & mask; entries[i].cluster_id != EMPTY_KEY; i = (i + 1) & mask) {
+        size_t entry_home = home(entries[i].cluster_id);
+        if (((i - entry_home) & mask) >= ((i - hole) & mask)) {
+            entries[hole] = entries[i];
+            hole = i;
+        }
+    }
+    entries[hole].cluster_id = EMPTY_KEY;
+    --count;
+    return true;
+}
+
+void SlotIndex::rehash(size_t capacity) {
+    std::vector<Entry> previous(capacity, Entry{EMPTY_KEY, 0});
+    previous.swap(entries);
+    mask = capacity - 1;
+    for (const Entry& entry : previous) {
+        if (entry.cluster_id == EMPTY_KEY) continue;
+        size_t i = home(entry.cluster_id);
+        while (entries[i].cluster_id != EMPTY_KEY) i = (i + 1) & mask;
+        entries[i] = entry;
+    }
+}
+
+void SlotIndex::reserve(size_t capacity) {
+    size_t table_size = 16;
+    while (table_size < 2 * capacity) table_size *= 2;
+    if (table_size > entries.size()) rehash(table_size);
+}
+
+void SlotIndex::clear() {
+    entries.clear();
+    mask = 0;
+    count = 0;
+}
@@ -1,11 +1,14 @@
 #include <mpi.h>
 #include <worker.hpp>
 #include <constants.hpp>
+#include <mapped_file.hpp>
+#include <parser.hpp>
 #include <cm.h>
 #include <mincut_only.h>
 #include <constrained.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <fstream>
 #include <sstream>
@@ -18,6 +21,21 @@
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Memory available to this job on the node: physical memory, capped by a cgroup limit
+int64_t detect_node_memory_mb() {
+    int64_t bytes = static_cast<int64_t>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+    for (const char* limit_file : {"/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes"}) {
+        std::ifstream in(limit_file);
+        int64_t limit;
+        if (in >> limit && limit > 0 && limit < bytes) bytes = limit;    // "max" = unlimited fails to parse
+    }
+    return bytes / (1024 * 1024);
+}
+
+}  // namespace
+
 // Constructor
 Worker::Worker(const std::string& method, Logger& logger, const std::string& work_dir,
                const std::string& clusters_dir,
@@ -27,7 +45,9 @@ Worker::Worker(const std::string& method, Logger& logger, const std::string& wor
                int time_limit_per_cluster,
                int report_interval,
                int num_processors,
-               int yield_node_threshold)
+               int yield_node_threshold,
+               int64_t node_memory_mb,
+               int prefetch_depth)
     : method(method), logger(logger), work_dir(work_dir), clusters_dir(clusters_dir),
       algorithm(algorithm), clustering_parameter(clustering_parameter),
       log_level(log_level), connectedness_criterion(connectedness_criterion),
@@ -35,12 +55,9 @@ Worker::Worker(const std::string& method, Logger& logger, const std::string& wor
       time_limit_per_cluster(time_limit_per_cluster),
       report_interval(report_interval),
       num_processors(num_processors),
-      yield_node_threshold(yield_node_threshold) {
-    // Use rank-based offset for yield IDs to avoid collisions between workers
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    yield_id_counter = rank * 10000000; // TODO: find a better way to name yielded sub-clusters
-}
+      yield_node_threshold(yield_node_threshold),
+      node_memory_mb(node_memory_mb),
+      prefetch_depth(prefetch_depth) {}
 
 // Main run function
 void Worker::run() {
@@ -54,62 +71,99 @@ void Worker::run() {
     fs::create_directories(work_dir + "/history/worker_" + std::to_string(rank) + "/");
     fs::create_directories(work_dir + "/yield/");
 
-    // Worker main loop
+    send_worker_info();
+
+    // Worker main loop. With --prefetch-depth, requests for the next batches go out while a
+    // batch runs, so their assignments are waiting when it finishes. Every request is answered
+    // (possibly with NO_MORE_JOBS) and every answer is received before the loop ends.
     int request_count = 0;
-    while (true) {
+    int outstanding_requests = 0;
+    bool no_more_jobs = false;
+    std::deque<std::vector<int64_t>> ready_batches;     // [cluster_id, is_yielded, ...] per batch
+
+    auto request_work = [&]() {
         // Send work request to load balancer (rank 0)
         logger.info("Requesting cluster from the load balancer");
-        int request_msg = to_int(MessageType::WORK_REQUEST);
-        MPI_Send(&request_msg, 1, MPI_INT, 0, to_int(MessageType::WORK_REQUEST), MPI_COMM_WORLD);
+        int64_t request_msg = used_yield_ids;
+        MPI_Send(&request_msg, 1, MPI_INT64_T, 0, to_int(MessageType::WORK_REQUEST), MPI_COMM_WORLD);
+        ++outstanding_requests;
 
         // Send cumulative report periodically (best-effort)
         if (report_interval > 0 && ++request_count % report_interval == 0) {
             int report_data[3] = {report.oom_count, report.timeout_count, report.peak_memory_mb};
             MPI_Send(report_data, 3, MPI_INT, 0, to_int(MessageType::WORKER_REPORT), MPI_COMM_WORLD);
         }
+    };
 
+    auto receive_work = [&]() {
         // Receive cluster IDs from load balancer
         MPI_Status status;
         MPI_Probe(0, to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD, &status);
 
         // Learn how many assigned clusters there are
         int count;
-        MPI_Get_count(&status, MPI_INT, &count);
+        MPI_Get_count(&status, MPI_INT64_T, &count);
 
-        // Receive [cluster_id, is_yielded] pairs from load balancer
-        std::vector<int> assigned_clusters(count);
-        MPI_Recv(assigned_clusters.data(), count, MPI_INT, 0, to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        // Receive a block of yield IDs (if any) and [cluster_id, is_yielded] pairs from load balancer
+        std::vector<int64_t> assigned_clusters(count);
+        MPI_Recv(assigned_clusters.data(), count, MPI_INT64_T, 0, to_int(MessageType::DISTRIBUTE_WORK), MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        --outstanding_requests;
 
         // Check for termination signal
         if (assigned_clusters[0] == NO_MORE_JOBS) {
-            logger.info("No more jobs available, terminating worker");
-            break;
+            if (!no_more_jobs) logger.info("No more jobs available, terminating worker");
+            no_more_jobs = true;
+            return;
+        }
+
+        if (assigned_clusters[1] > 0) {
+            yield_id_blocks.emplace_back(assigned_clusters[0], assigned_clusters[0] + assigned_clusters[1]);
+            logger.debug("Received yield IDs " + std::to_string(assigned_clusters[0]) + "-" +
+                std::to_string(assigned_clusters[0] + assigned_clusters[1] - 1));
+        }
+        ready_batches.emplace_back(assigned_clusters.begin() + 2, assigned_clusters.end());
+    };
+
+    while (true) {
+        if (ready_batches.empty()) {
+            if (outstanding_requests == 0) {
+                if (no_more_jobs) break;
+                request_work();
+            }
+            receive_work();
+            continue;
         }
 
-        for (int i = 0; i < count; i += 2) {
-            int cluster = assigned_clusters[i];
-            bool is_yielded = assigned_clusters[i + 1] != 0;
+        std::vector<int64_t> batch = std::move(ready_batches.front());
+        ready_batches.pop_front();
+
+        // Ask for the batches after this one before running it
+        while (!no_more_jobs && outstanding_requests + static_cast<int>(ready_batches.size()) < prefetch_depth) {
+            request_work();
+        }
+
+        for (size_t i = 0; i < batch.size(); i += 2) {
+            int64_t cluster = batch[i];
+            bool is_yielded = batch[i + 1] != 0;
             logger.info("Received cluster " + std::to_string(cluster) +
                 (is_yielded ? " (yielded)" : ""));
 
             // Process the cluster
-            auto [success, yield_count] = process_cluster(cluster, is_yielded);
+            ClusterResult result = process_cluster(cluster, is_yielded);
 
-            // Send completion status: [cluster_id, yield_count]
+            // Send completion status with the measured run time
             // yield_count lets the LB know whether YIELD_REPORTs are in transit
             // (they are always fully sent before this message, but may arrive out of order
             // due to MPI cross-tag reordering).
-            MessageType status_type = success ? MessageType::WORK_DONE : MessageType::WORK_ABORTED;
-            int done_data[2] = {cluster, yield_count};
-            MPI_Send(done_data, 2, MPI_INT, 0, to_int(status_type), MPI_COMM_WORLD);
-
-            if (success) {
-                logger.info("Completed cluster " + std::to_string(cluster) +
-                    " (yield_count=" + std::to_string(yield_count) + ")");
-            } else {
-                logger.info("Aborted cluster " + std::to_string(cluster) +
-                    " (yield_count=" + std::to_string(yield_count) + ")");
-            }
+            MessageType status_type = result.success ? MessageType::WORK_DONE : MessageType::WORK_ABORTED;
+            WorkDone done_data = {cluster, result.yield_count, result.wall_seconds, result.cpu_seconds,
+                                  result.peak_memory_mb, result.oom_killed ? 1 : 0};
+            MPI_Send(&done_data, sizeof(done_data), MPI_BYTE, 0, to_int(status_type), MPI_COMM_WORLD);
+
+            logger.info(std::string(result.success ? "Completed" : "Aborted") + " cluster " + std::to_string(cluster) +
+                " (yield_count=" + std::to_string(result.yield_count) +
+                ", wall " + std::to_string(result.wall_seconds) + " s, CPU " + std::to_string(result.cpu_seconds) + " s" +
+                ", peak " + std::to_string(result.peak_memory_mb) + " MB)");
         }
     }
 
@@ -141,31 +195,24 @@ void Worker::run() {
         for (const auto& entry : fs::directory_iterator(worker_subdir)) {
             if (entry.is_regular_file()) {
                 std::string input_file = entry.path().string();
-                std::ifstream in(input_file);
+                MappedFile in(input_file, "cluster output");
 
-                std::string line;
-                std::getline(in, line);  // Skip header
+                // Skip header
+                const char* data = in.data();
+                const char* end = in.end();
+                while (data < end && *data != '\n') ++data;
+                if (data < end) ++data;
 
                 std::unordered_map<int, int> cluster_mapping;  // per-file mapping
 
-                while (std::getline(in, line)) {
-                    std::stringstream ss(line);
-                    std::string node_str, cluster_str;
-                    std::getline(ss, node_str, ',');
-                    std::getline(ss, cluster_str, ',');
-
-                    int node_id = std::stoi(node_str);
-                    int cluster_id = std::stoi(cluster_str);
-
+                parse_pairs(data, end, ',', [&](int node_id, int cluster_id) {
                     // Assign new global ID if this cluster_id hasn't been seen in this file
                     if (cluster_mapping.find(cluster_id) == cluster_mapping.end()) {
                         cluster_mapping[cluster_id] = next_cluster_id++;
                     }
 
                     out << node_id << "," << cluster_mapping[cluster_id] << "\n";
-                }
-
-                in.close();
+                });
             }
         }
 
@@ -183,31 +230,106 @@ void Worker::run() {
     MPI_Send(&aggregate_msg, 1, MPI_INT, 0, to_int(MessageType::AGGREGATE_DONE), MPI_COMM_WORLD);
     logger.info("Sent AGGREGATE_DONE signal to load balancer");
 
+    if (!scratch_dir.empty()) {
+        std::error_code ec;
+        fs::remove_all(scratch_dir, ec);
+    }
+
     logger.info("Worker runtime phase ended");
 }
 
+// Declare this worker's node and memory budget to the load balancer
+void Worker::send_worker_info() {
+    WorkerInfo info{};
+    int name_length;
+    MPI_Get_processor_name(info.node_name, &name_length);
+    info.memory_budget_mb = node_memory_mb > 0 ? node_memory_mb : detect_node_memory_mb();
+    logger.info("Node " + std::string(info.node_name) + ", memory budget " +
+                std::to_string(info.memory_budget_mb) + " MB" + (node_memory_mb > 0 ? "" : " (detected)"));
+    MPI_Send(&info, sizeof(info), MPI_BYTE, 0, to_int(MessageType::WORKER_INFO), MPI_COMM_WORLD);
+}
+
+// Resolve (and for packed clusters, extract) the input files of a cluster
+void Worker::locate_cluster_files(int64_t cluster_id, bool is_yielded, std::string& edgelist,
+                                  std::string& clustering_file, bool& staged) {
+    staged = false;
+    if (is_yielded) {
+        // Yielded clusters live in work_dir/yield/ (ephemeral, not checkpointed)
+        edgelist = work_dir + "/yield/" + std::to_string(cluster_id) + ".bedgelist";
+        clustering_file = work_dir + "/yield/" + std::to_string(cluster_id) + ".bcluster";
+        return;
+    }
+
+    // Phase 1 has finished by the time work is handed out, so the pack is checked for once
+    if (!pack_checked) {
+        pack_checked = true;
+        if (ClusterPackReader::exists(clusters_dir)) {
+            pack = std::make_unique<ClusterPackReader>(clusters_dir);
+            int rank;
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            scratch_dir = (fs::temp_directory_path() /
+                           ("dcc_" + std::to_string(getpid()) + "_" + std::to_string(rank))).string();
+            fs::create_directories(scratch_dir);
+            logger.info("Reading clusters from " + clusters_dir + "/" + PACK_DATA_FILE +
+                        " (scratch: " + scratch_dir + ")");
+        }
+    }
+
+    if (pack) {
+        const PackIndexEntry* entry = pack->find(static_cast<int>(cluster_id));    // input IDs are 32-bit
+        if (entry == nullptr) {
+            throw std::runtime_error("cluster " + std::to_string(cluster_id) + " is not in " + PACK_INDEX_FILE);
+        }
+        edgelist = scratch_dir + "/" + std::to_string(cluster_id) + ".bedgelist";
+        clustering_file = scratch_dir + "/" + std::to_string(cluster_id) + ".bcluster";
+        staged = true;
+        pack->extract(*entry, edgelist, clustering_file);
+        return;
+    }
+
+    // Per-file clusters from older partitioned dirs
+    edgelist = clusters_dir + "/" + std::to_string(cluster_id) + ".bedgelist";
+    if (!fs::exists(edgelist)) {
+        edgelist = clusters_dir + "/" + std::to_string(cluster_id) + ".edgelist";
+    }
+    clustering_file = clusters_dir + "/" + std::to_string(cluster_id) + ".bcluster";
+    if (!fs::exists(clustering_file)) {
+        clustering_file = clusters_dir + "/" + std::to_string(cluster_id) + ".cluster";
+    }
+}
+
+// Take the next yield ID, asking the load balancer for a block if none is left
+int64_t Worker::next_yield_id() {
+    while (!yield_id_blocks.empty() && yield_id_blocks.front().first == yield_id_blocks.front().second) {
+        yield_id_blocks.pop_front();
+    }
+    if (yield_id_blocks.empty()) {
+        logger.info("Out of yield IDs, requesting a block from the load balancer");
+        int request_msg = to_int(MessageType::YIELD_ID_REQUEST);
+        MPI_Send(&request_msg, 1, MPI_INT, 0, to_int(MessageType::YIELD_ID_REQUEST), MPI_COMM_WORLD);
+        int64_t block[2];
+        MPI_Recv(block, 2, MPI_INT64_T, 0, to_int(MessageType::YIELD_IDS), MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        yield_id_blocks.emplace_back(block[0], block[0] + block[1]);
+    }
+    ++used_yield_ids;
+    return yield_id_blocks.front().first++;
+}
+
 // Process a single cluster
-std::pair<bool, int> Worker::process_cluster(int cluster_id, bool is_yielded) {
+ClusterResult Worker::process_cluster(int64_t cluster_id, bool is_yielded) {
     // TODO: implement actual cluster processing
     // For now, this is a placeholder that simulates work
 
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    std::string cluster_edgelist = clusters_dir + "/" + std::to_string(cluster_id) + ".bedgelist";
-    if (!std::filesystem::exists(cluster_edgelist)) {
-        cluster_edgelist = clusters_dir + "/" + std::to_string(cluster_id) + ".edgelist";
-    }
-    if (!std::filesystem::exists(cluster_edgelist)) {
-        // Yielded clusters live in work_dir/yield/ (ephemeral, not checkpointed)
-        cluster_edgelist = work_dir + "/yield/" + std::to_string(cluster_id) + ".bedgelist";
-    }
-    std::string cluster_clustering_file = clusters_dir + "/" + std::to_string(cluster_id) + ".bcluster";
-    if (!std::filesystem::exists(cluster_clustering_file)) {
-        cluster_clustering_file = clusters_dir + "/" + std::to_string(cluster_id) + ".cluster";
-    }
-    if (!std::filesystem::exists(cluster_clustering_file)) {
-        cluster_clustering_file = work_dir + "/yield/" + std::to_string(cluster_id) + ".bcluster";
+    std::string cluster_edgelist, cluster_clustering_file;
+    bool staged = false;
+    try {
+        locate_cluster_files(cluster_id, is_yielded, cluster_edgelist, cluster_clustering_file, staged);
+    } catch (const std::exception& e) {
+        logger.error("Failed to stage cluster " + std::to_string(cluster_id) + ": " + e.what());
+        return {};
     }
     logger.debug("Processing cluster file: " + cluster_edgelist);
 
@@ -225,6 +347,7 @@ std::pair<bool, int> Worker::process_cluster(int cluster_id, bool is_yielded) {
     }
 
     logger.flush(); // to avoid duplicate logs after fork()
+    auto start_time = std::chrono::steady_clock::now();
 
     // Spawn a child process and call CM processing logic on it
     // This is to gracefully handle OOM kills
@@ -286,7 +409,7 @@ std::pair<bool, int> Worker::process_cluster(int cluster_id, bool is_yielded) {
                     int local_yield_id = record.yield_id;
                     int node_count = record.node_count;
                     int64_t edge_count = record.edge_count;
-                    int global_id = yield_id_counter++;
+                    int64_t global_id = next_yield_id();
                     yield_count++;
 
                     // Rename yield files to flat yield dir with global ID (ephemeral)
@@ -306,8 +429,7 @@ std::pair<bool, int> Worker::process_cluster(int cluster_id, bool is_yielded) {
                     }
 
                     // Send YIELD_REPORT to LB as raw bytes
-                    struct { int parent_id; int child_id; int node_count; int64_t edge_count; } yield_data =
-                        {cluster_id, global_id, node_count, edge_count};
+                    YieldReport yield_data = {cluster_id, global_id, node_count, edge_count};
                     MPI_Send(&yield_data, sizeof(yield_data), MPI_BYTE, 0,
                              to_int(MessageType::YIELD_REPORT), MPI_COMM_WORLD);
 
@@ -368,28 +490,51 @@ std::pair<bool, int> Worker::process_cluster(int cluster_id, bool is_yielded) {
             fs::remove_all(yield_dir);
         }
 
+        // Remove the extracted pack payload
+        if (staged) {
+            std::error_code ec;
+            fs::remove(cluster_edgelist, ec);
+            fs::remove(cluster_clustering_file, ec);
+        }
+
+        ClusterResult result;
+        result.yield_count = yield_count;
+        result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        result.cpu_seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                             (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+
         // Log and track peak memory usage
         int memory_mb = static_cast<int>(usage.ru_maxrss / 1024);
         logger.log("Cluster " + std::to_string(cluster_id) + " peak memory: " + std::to_string(memory_mb) + " MB");
+        result.peak_memory_mb = memory_mb;
         if (memory_mb > report.peak_memory_mb)
             report.peak_memory_mb = memory_mb;
 
         if (timed_out) {
             logger.log("Timeout. Child was killed after " + std::to_string(time_limit_per_cluster) + " seconds");
             ++report.timeout_count;
-            return {false, yield_count};
+            return result;
         }
 
         // Check how child terminated
-        bool success;
         if (WIFEXITED(status)) {
             logger.log("Child exited with code: " + std::to_string(WEXITSTATUS(status)));
-            success = (WEXITSTATUS(status) == 0);
+            result.success = (WEXITSTATUS(status) == 0);
         } else {
             logger.log("Child killed by signal: " + std::to_string(WTERMSIG(status)));
-            if (WTERMSIG(status) == SIGKILL)
+            if (WTERMSIG(status) == SIGKILL) {
                 ++report.oom_count;  // SIGKILL without timeout is likely OOM
-            success = false;
+                result.oom_killed = true;
+            }
+            result.success = false;
+        }
+
+        // The load balancer may retry an OOM-killed cluster on another worker, so drop any
+        // partial output that worker-level aggregation would otherwise pick up
+        if (result.oom_killed && yield_count == 0) {
+            std::error_code ec;
+            fs::remove(work_dir + "/yield/" + std::to_string(cluster_id) + ".output", ec);
+            fs::remove(work_dir + "/output/worker_" + std::to_string(rank) + "/" + std::to_string(cluster_id) + ".output", ec);
         }
 
         // If a yield-eligible root didn't actually yield, move its output back
@@ -403,10 +548,10 @@ std::pair<bool, int> Worker::process_cluster(int cluster_id, bool is_yielded) {
             }
         }
 
-        return {success, yield_count};
+        return result;
     } else {
         logger.log("Fork failed");  // TODO: this is serious. Need explicit handling
     }
 
-    return {false, 0};   // fallback
+    return {};   // fallback
 }
\ No newline at end of file
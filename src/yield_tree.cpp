@@ -0,0 +1,97 @@
+#include <yield_tree.hpp>
+#include <stdexcept>
+#include <string>
+
+uint32_t YieldTree::allocate(const YieldNode& node) {
+    uint32_t slot;
+    if (free_slots.empty()) {
+        slot = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(node);
+    } else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+        nodes[slot] = node;
+    }
+    index.insert(node.cluster_id, slot);
+    return slot;
+}
+
+void YieldTree::unlink(uint32_t slot) {
+    YieldNode& node = nodes[slot];
+    if (node.parent == NONE) return;
+    if (node.prev_sibling != NONE) {
+        nodes[node.prev_sibling].next_sibling = node.next_sibling;
+    } else {
+        nodes[node.parent].first_child = node.next_sibling;
+    }
+    if (node.next_sibling != NONE) nodes[node.next_sibling].prev_sibling = node.prev_sibling;
+    node.parent = node.prev_sibling = node.next_sibling = NONE;
+}
+
+uint32_t YieldTree::find_or_add_root(int64_t cluster_id) {
+    uint32_t slot = find(cluster_id);
+    if (slot != NONE) return slot;
+    YieldNode root{};
+    root.cluster_id = cluster_id;
+    root.parent_id = -1;
+    root.root_id = cluster_id;
+    return allocate(root);
+}
+
+uint32_t YieldTree::add_child(uint32_t parent, int64_t cluster_id) {
+    if (contains(cluster_id)) {
+        throw std::runtime_error("Yielded cluster " + std::to_string(cluster_id) + " is already in the yield tree");
+    }
+    YieldNode child{};
+    child.cluster_id = cluster_id;
+    child.parent_id = nodes[parent].cluster_id;
+    child.root_id = nodes[parent].root_id;
+    child.under_abort = nodes[parent].under_abort;
+    child.parent = parent;
+    child.next_sibling = nodes[parent].first_child;
+    uint32_t slot = allocate(child);
+
+    if (nodes[slot].next_sibling != NONE) nodes[nodes[slot].next_sibling].prev_sibling = slot;
+    nodes[parent].first_child = slot;
+    return slot;
+}
+
+void YieldTree::mark_aborted(uint32_t slot) {
+    nodes[slot].aborted = true;
+    if (nodes[slot].under_abort) return;    // already propagated from an ancestor
+
+    // Pre-order walk of the subtree, using the parent links to climb back up
+    uint32_t current = slot;
+    while (true) {
+        nodes[current].under_abort = true;
+        if (nodes[current].first_child != NONE) {
+            current = nodes[current].first_child;
+            continue;
+        }
+        while (current != slot && nodes[current].next_sibling == NONE) current = nodes[current].parent;
+        if (current == slot) return;
+        current = nodes[current].next_sibling;
+    }
+}
+
+void YieldTree::erase_subtree(uint32_t slot) {
+    unlink(slot);
+
+    // Post-order: free the leftmost leaf, then continue from its parent
+    uint32_t current = slot;
+    while (true) {
+        while (nodes[current].first_child != NONE) current = nodes[current].first_child;
+        uint32_t parent = nodes[current].parent;
+        index.erase(nodes[current].cluster_id);
+        free_slots.push_back(current);
+        if (current == slot) return;
+        nodes[parent].first_child = nodes[current].next_sibling;
+        current = parent;
+    }
+}
+
+void YieldTree::clear() {
+    nodes.clear();
+    free_slots.clear();
+    index.clear();
+}